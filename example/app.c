@@ -41,12 +41,31 @@ const REX __APP = {
     app
 };
 
+static void app_ready_stub()
+{
+    //never running - lower priority than app
+    for (;;) {}
+}
+
+static const REX __READY_STUB = {
+    //name
+    "Ready stub",
+    //size
+    256,
+    //priority
+    201,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app_ready_stub
+};
 
 static inline void stat()
 {
     SYSTIME uptime;
     int i;
     unsigned int diff;
+    HANDLE ready[TEST_READY_PROCESSES];
 
     get_uptime(&uptime);
     for (i = 0; i < TEST_ROUNDS; ++i)
@@ -60,6 +79,17 @@ static inline void stat()
     diff = systime_elapsed_us(&uptime);
     printf("average switch time: %d.%dus\n", diff / TEST_ROUNDS, (diff / (TEST_ROUNDS / 10)) % 10);
 
+    //wakeup cost with long ready list
+    for (i = 0; i < TEST_READY_PROCESSES; ++i)
+        ready[i] = process_create(&__READY_STUB);
+    get_uptime(&uptime);
+    for (i = 0; i < TEST_ROUNDS; ++i)
+        process_switch_test();
+    diff = systime_elapsed_us(&uptime);
+    printf("average switch time, %d ready: %d.%dus\n", TEST_READY_PROCESSES, diff / TEST_ROUNDS, (diff / (TEST_ROUNDS / 10)) % 10);
+    for (i = 0; i < TEST_READY_PROCESSES; ++i)
+        process_destroy(ready[i]);
+
     printf("core clock: %d\n", power_get_core_clock());
     process_info();
 }
@@ -42,5 +42,7 @@
 #define DBG_CONSOLE_TX_PIN                          D5
 
 #define TEST_ROUNDS                                 10000
+//ready processes for scheduler wakeup test
+#define TEST_READY_PROCESSES                        20
 
 #endif // CONFIG_H
@@ -14,6 +14,9 @@
 #define KERNEL_MARKS                                0
 //check range of dynamic objects in pools
 #define KERNEL_RANGE_CHECKING                       0
+//cache freed small objects per size class (16..256 bytes) in front of pool first-fit. O(1) malloc/free for
+//small objects. Cached objects are returned to pool on out of memory
+#define KERNEL_POOL_SLABS                           0
 //check kernel handles. Require few tacts, but making kernel calls much safer
 #define KERNEL_HANDLE_CHECKING                      1
 //check user adresses. Require few tacts, but making kernel calls much safer
@@ -25,8 +28,18 @@
 //Kernel halt on fatal error, disable power save mode
 //Don't forget to turn off in production.
 #define KERNEL_DEVELOPER_MODE                       1
+//soft timers in seconds wheel instead of sorted list: O(1) start/stop, only current second timers are scanned.
+//Costs 4 bytes of RAM per wheel slot
+#define KERNEL_TIMER_WHEEL                          0
+//wheel size in seconds, power of 2. Longer timers are kept in overflow list, cascaded once per wheel turn
+#define KERNEL_TIMER_WHEEL_SIZE                     64
 //enable this only if you have problems with system timer. May decrease perfomance
 #define KERNEL_TIMER_DEBUG                          0
+//O(1) scheduler: per-priority ready lists with CLZ-indexed bitmap instead of sorted list walk on every wakeup.
+//Costs 4 bytes of RAM per priority level. Priorities above KERNEL_PRIORITY_LEVELS - 1 are scheduled as lowest level
+#define KERNEL_READY_BITMAP                         0
+//number of priority levels for ready bitmap. Max 1024
+#define KERNEL_PRIORITY_LEVELS                      256
 //size of IPC queue per process
 #define KERNEL_IPC_COUNT                            7
 //enable this only if you have problems with IPC oferflow.
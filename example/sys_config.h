@@ -106,6 +106,8 @@
 #define SCSI_VERIFY_SUPPORTED                               0
 //send PASS before data was written
 #define SCSI_WRITE_CACHE                                    1
+//IO buffers per LUN. Storage and USB are working in parallel, if 2 or more
+#define SCSI_IO_DEPTH                                       2
 //SATA over SCSI. Just stub for more verbose error processing
 //Found on some linux recent kernels
 #define SCSI_SAT                                            0
@@ -146,6 +148,8 @@
 #define ARP_DEBUG_FLOW                                      1
 
 #define ARP_CACHE_SIZE_MAX                                  10
+//open addressing hash slots for cache lookup. Power of 2, greater than ARP_CACHE_SIZE_MAX
+#define ARP_HASH_SIZE                                       16
 //in seconds
 #define ARP_CACHE_INCOMPLETE_TIMEOUT                        5
 #define ARP_CACHE_TIMEOUT                                   600
@@ -193,6 +197,15 @@
 #define TCP_TIMEOUT                                         30000
 //0 - don't limit
 #define TCP_HANDLES_LIMIT                                   10
+//RX demux hash buckets: connections by remote ip/port and local port, listeners by port. Power of 2
+#define TCP_HASH_SIZE                                       16
+#define TCP_LISTEN_HASH_SIZE                                4
+//user write requests, queued per connection. Data of all queued requests is sent up to peer window
+#define TCP_TX_QUEUE_SIZE                                   4
+//out of order segments, held per connection for reassembly. Taken from tcpip IO pool
+#define TCP_OOO_SIZE                                        4
+//out of order segments, held by all connections. Must be less than TCPIP_MAX_FRAMES_COUNT
+#define TCP_OOO_FRAMES_MAX                                  4
 //Low-level debug. only for development
 #define TCP_DEBUG_FLOW                                      0
 #define TCP_DEBUG_PACKETS                                   0
@@ -212,10 +225,22 @@
 #define WEBS_IO_SIZE                                        1460
 //Maximum request size. If request is bigger, it will be responded with "payload too large"
 #define WEBS_MAX_PAYLOAD                                    8192
+//Requests, dispatched to handlers at same time. Others are waiting in queue. 1 means serialized processing
+#define WEBS_DISPATCH_WINDOW                                2
+//Handler processes per node. Node requests are round-robined between them. Without handlers, requests are sent to server owner
+#define WEBS_NODE_HANDLERS_MAX                              2
+//Per node request count and latency counters
+#define WEBS_NODE_STAT                                      1
+//URL routing hash buckets, shared by all nodes. Power of 2
+#define WEBS_NODE_HASH_SIZE                                 32
+//Static files nodes, served from vfs folder without application. Requires vfs
+#define WEBS_FILES                                          1
+//Served on folder request
+#define WEBS_INDEX_FILE                                     "index.html"
 
 //---------------------------- TLS server---------------------------------------------
 //cryptography can take much space.
-#define TLS_PROCESS_SIZE                                    3048
+#define TLS_PROCESS_SIZE                                    7168
 #define TLS_PROCESS_PRIORITY                                160
 
 #define TLS_DEBUG_REQUESTS                                  1
@@ -223,10 +248,23 @@
 //DON'T FORGET TO REMOVE IN PRODUCTION!!!
 #define TLS_DEBUG_SECRETS                                   0
 #define TLS_IO_SIZE                                         1460
+//concurrent sessions. Each session has own records rx/tx IO of TLS_IO_SIZE
+#define TLS_SESSIONS_MAX                                    4
+//resumable sessions cache (session ID based). 0 to disable. Master secret is kept in RAM
+#define TLS_SESSION_CACHE_SIZE                              4
+//resumable session lifetime in seconds
+#define TLS_SESSION_CACHE_TTL                               3600
 
 //at least one must be selected
 #define TLS_RSA_WITH_AES_128_CBC_SHA_CIPHER_SUITE           1
 #define TLS_RSA_WITH_AES_128_CBC_SHA256_CIPHER_SUITE        1
+
+//---------------------------------- CRYPTO -------------------------------------------
+//AES backend. 0 - T-tables: fastest, 8KB of tables in flash
+//1 - compact byte oriented: 512 bytes of tables, for small parts
+//2 - bitsliced: constant time, no tables. CBC decrypt is processing 2 blocks at once
+//3 - AES-NI: POSIX host core only
+#define AES_IMPLEMENTATION                                  0
 //--------------------------------- SDMMC ---------------------------------------------
 #define SDMMC_DEBUG                                         1
 
@@ -244,6 +282,12 @@
 #define VFS_CLUSTER_ALIGN                                   1
 //update modify/access time (recommended to disable for flash storage)
 #define VFS_FILE_ATTRIBUTES_UPDATE                          0
+//LRU write-back cache of single sector accesses (FAT, folders). Sectors count, 0 to disable
+#define VFS_CACHE_SECTORS                                   4
+//in-RAM FAT16 free clusters bitmap, 1 bit per cluster. Build on mount
+#define VFS_FAT16_FREE_BITMAP                               1
+//FAT16 cluster runs, mapped per open file for fast seek. 0 to disable
+#define VFS_FAT16_EXTENTS                                   8
 
 //01.09.2016 as default if not rtc used
 #define VFS_BASE_DATE                                       736207
@@ -0,0 +1,143 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//host benchmarks. Running on POSIX core, results are printed to host stdout
+
+#include "../userspace/stdio.h"
+#include "../userspace/stdlib.h"
+#include "../userspace/process.h"
+#include "../userspace/systime.h"
+#include "../userspace/stream.h"
+#include "../userspace/object.h"
+#include "../userspace/sys.h"
+#include "../kernel/core/posix_host.h"
+#include "app.h"
+#include "bench_stream.h"
+#include "bench_scsi.h"
+#include "bench_tcp.h"
+#include "config.h"
+
+void app();
+void console();
+
+const REX __APP = {
+    //name
+    "App main",
+    //size
+    HOST_PROCESS_SIZE,
+    //priority
+    200,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app
+};
+
+static const REX __CONSOLE = {
+    //name
+    "Host console",
+    //size
+    HOST_PROCESS_SIZE,
+    //priority - lower than app, so benchmarks are not interrupted by output
+    210,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    console
+};
+
+static void app_ready_stub()
+{
+    //never running - lower priority than app
+    for (;;) {}
+}
+
+static const REX __READY_STUB = {
+    //name
+    "Ready stub",
+    //size
+    HOST_PROCESS_SIZE,
+    //priority
+    201,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    app_ready_stub
+};
+
+void console()
+{
+    HANDLE handle;
+    char buf[HOST_CONSOLE_STREAM_SIZE];
+    unsigned int size;
+    handle = stream_open(object_get(SYS_OBJ_STDOUT));
+    for (;;)
+    {
+        //wait for first char, then flush all
+        stream_read(handle, buf, 1);
+        size = stream_read_no_block(handle, buf + 1, sizeof(buf) - 1);
+        posix_host_write(buf, size + 1);
+    }
+}
+
+static inline void stat()
+{
+    SYSTIME uptime;
+    int i;
+    unsigned int diff;
+    HANDLE ready[TEST_READY_PROCESSES];
+
+    get_uptime(&uptime);
+    for (i = 0; i < TEST_ROUNDS; ++i)
+        svc_test();
+    diff = systime_elapsed_us(&uptime);
+    printf("average kernel call time: %d.%dus\n", diff / TEST_ROUNDS, (diff / (TEST_ROUNDS / 10)) % 10);
+
+    get_uptime(&uptime);
+    for (i = 0; i < TEST_ROUNDS; ++i)
+        process_switch_test();
+    diff = systime_elapsed_us(&uptime);
+    printf("average switch time: %d.%dus\n", diff / TEST_ROUNDS, (diff / (TEST_ROUNDS / 10)) % 10);
+
+    //wakeup cost with long ready list
+    for (i = 0; i < TEST_READY_PROCESSES; ++i)
+        ready[i] = process_create(&__READY_STUB);
+    get_uptime(&uptime);
+    for (i = 0; i < TEST_ROUNDS; ++i)
+        process_switch_test();
+    diff = systime_elapsed_us(&uptime);
+    printf("average switch time, %d ready: %d.%dus\n", TEST_READY_PROCESSES, diff / TEST_ROUNDS, (diff / (TEST_ROUNDS / 10)) % 10);
+    for (i = 0; i < TEST_READY_PROCESSES; ++i)
+        process_destroy(ready[i]);
+}
+
+static inline void app_init(APP* app)
+{
+    app->stdout = stream_create(HOST_CONSOLE_STREAM_SIZE);
+    object_set(SYS_OBJ_STDOUT, app->stdout);
+    open_stdout();
+    process_create(&__CONSOLE);
+}
+
+static inline void app_exit(APP* app)
+{
+    //let console flush output
+    while (stream_get_size(app->stdout))
+        sleep_ms(1);
+    posix_host_exit(0);
+}
+
+void app()
+{
+    APP app;
+
+    app_init(&app);
+    stat();
+    bench_stream();
+    bench_scsi();
+    bench_tcp();
+    app_exit(&app);
+}
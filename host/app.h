@@ -0,0 +1,16 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef APP_H
+#define APP_H
+
+#include "../userspace/types.h"
+
+typedef struct {
+    HANDLE stdout;
+} APP;
+
+#endif // APP_H
@@ -0,0 +1,240 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#include "bench_scsi.h"
+#include "../userspace/stdio.h"
+#include "../userspace/stdlib.h"
+#include "../userspace/process.h"
+#include "../userspace/systime.h"
+#include "../userspace/ipc.h"
+#include "../userspace/io.h"
+#include "../userspace/storage.h"
+#include "../userspace/endian.h"
+#include "../userspace/error.h"
+//command opcodes
+#include "../midware/scsis/scsis_private.h"
+#include "config.h"
+#include <string.h>
+
+#define SCSI_BENCH_SECTORS                          (SCSI_BENCH_DISK_SIZE / SCSI_BENCH_SECTOR_SIZE)
+
+void ram_disk();
+
+//sectors per command
+static const unsigned int __SCSI_BENCH_COUNTS[] = {8, 64, 128};
+
+static const REX __RAM_DISK = {
+    //name
+    "RAM disk",
+    //size
+    SCSI_BENCH_DISK_SIZE + HOST_PROCESS_SIZE,
+    //priority - higher than app, like storage driver
+    199,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    ram_disk
+};
+
+typedef struct {
+    SCSIS* scsis;
+    IO* io;
+    HANDLE timer;
+    unsigned int host_size;
+    bool busy, failed;
+} SCSI_BENCH;
+
+static bool ram_disk_check(STORAGE_STACK* stack, unsigned int size)
+{
+    if ((size == 0) || (size % SCSI_BENCH_SECTOR_SIZE) || (stack->sector + size / SCSI_BENCH_SECTOR_SIZE > SCSI_BENCH_SECTORS))
+    {
+        error(ERROR_INVALID_PARAMS);
+        return false;
+    }
+    return true;
+}
+
+static inline void ram_disk_read(uint8_t* disk, HANDLE process, HAL hal, HANDLE user, IO* io, unsigned int size)
+{
+    STORAGE_STACK* stack = io_stack(io);
+    io_pop(io, sizeof(STORAGE_STACK));
+    if (!ram_disk_check(stack, size))
+        return;
+    memcpy(io_data(io), disk + stack->sector * SCSI_BENCH_SECTOR_SIZE, size);
+    io->data_size = size;
+    sleep_us(SCSI_BENCH_STORAGE_US);
+    io_complete(process, HAL_IO_CMD(hal, IPC_READ), user, io);
+    error(ERROR_SYNC);
+}
+
+static inline void ram_disk_write(uint8_t* disk, HANDLE process, HAL hal, HANDLE user, IO* io)
+{
+    STORAGE_STACK* stack = io_stack(io);
+    io_pop(io, sizeof(STORAGE_STACK));
+    if (!ram_disk_check(stack, io->data_size))
+        return;
+    memcpy(disk + stack->sector * SCSI_BENCH_SECTOR_SIZE, io_data(io), io->data_size);
+    sleep_us(SCSI_BENCH_STORAGE_US);
+    io_complete(process, HAL_IO_CMD(hal, IPC_WRITE), user, io);
+    error(ERROR_SYNC);
+}
+
+static inline void ram_disk_get_media_descriptor(HANDLE process, HAL hal, HANDLE user, IO* io)
+{
+    STORAGE_MEDIA_DESCRIPTOR* media = io_data(io);
+    media->num_sectors = SCSI_BENCH_SECTORS;
+    media->num_sectors_hi = 0;
+    media->sector_size = SCSI_BENCH_SECTOR_SIZE;
+    strcpy(STORAGE_MEDIA_SERIAL(media), "RAMDISK");
+    io->data_size = sizeof(STORAGE_MEDIA_DESCRIPTOR) + strlen(STORAGE_MEDIA_SERIAL(media)) + 1;
+    io_complete(process, HAL_IO_CMD(hal, STORAGE_GET_MEDIA_DESCRIPTOR), user, io);
+    error(ERROR_SYNC);
+}
+
+void ram_disk()
+{
+    IPC ipc;
+    uint8_t* disk = malloc(SCSI_BENCH_DISK_SIZE);
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (HAL_ITEM(ipc.cmd))
+        {
+        case IPC_READ:
+            ram_disk_read(disk, ipc.process, HAL_GROUP(ipc.cmd), (HANDLE)ipc.param1, (IO*)ipc.param2, ipc.param3);
+            break;
+        case IPC_WRITE:
+            ram_disk_write(disk, ipc.process, HAL_GROUP(ipc.cmd), (HANDLE)ipc.param1, (IO*)ipc.param2);
+            break;
+        case STORAGE_GET_MEDIA_DESCRIPTOR:
+            ram_disk_get_media_descriptor(ipc.process, HAL_GROUP(ipc.cmd), (HANDLE)ipc.param1, (IO*)ipc.param2);
+            break;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+        }
+        ipc_write(&ipc);
+    }
+}
+
+static void scsi_bench_cb(void* param, unsigned int id, SCSIS_RESPONSE response, unsigned int size)
+{
+    SCSI_BENCH* bench = param;
+    switch (response)
+    {
+    case SCSIS_RESPONSE_READ:
+        //host to device data. Storage is working, while bus is transferring
+        scsis_get_host_io(bench->scsis)->data_size = size;
+        bench->host_size = size;
+        timer_start_us(bench->timer, SCSI_BENCH_HOST_US);
+        break;
+    case SCSIS_RESPONSE_WRITE:
+        //device to host data is dropped
+        bench->host_size = size;
+        timer_start_us(bench->timer, SCSI_BENCH_HOST_US);
+        break;
+    case SCSIS_RESPONSE_FAIL:
+        bench->failed = true;
+        break;
+    case SCSIS_RESPONSE_NEED_IO:
+        scsis_host_give_io(bench->scsis, bench->io);
+        break;
+    case SCSIS_RESPONSE_RELEASE_IO:
+        //with write cache PASS is sent before last storage write. Command is over only on IO release
+        bench->busy = false;
+        break;
+    default:
+        break;
+    }
+}
+
+static void scsi_bench_wait(SCSI_BENCH* bench)
+{
+    IPC ipc;
+    while (bench->busy)
+    {
+        ipc_read(&ipc);
+        //host transfer timeout
+        if (HAL_GROUP(ipc.cmd) == HAL_USBD)
+            scsis_host_io_complete(bench->scsis, (int)bench->host_size);
+        else
+            scsis_request(bench->scsis, &ipc);
+    }
+}
+
+static void scsi_bench_cmd(SCSI_BENCH* bench, uint8_t opcode, unsigned int lba, unsigned int count)
+{
+    uint8_t req[10];
+    memset(req, 0, sizeof(req));
+    req[0] = opcode;
+    int2be(req + 2, lba);
+    short2be(req + 7, count);
+    bench->busy = true;
+    scsis_request_cmd(bench->scsis, bench->io, req);
+    scsi_bench_wait(bench);
+}
+
+static void scsi_bench_run(SCSI_BENCH* bench, uint8_t opcode, unsigned int count, unsigned int depth)
+{
+    SYSTIME uptime;
+    unsigned int lba, bytes, us;
+
+    bench->failed = false;
+    get_uptime(&uptime);
+    for (lba = bytes = 0; bytes < SCSI_BENCH_BYTES; bytes += count * SCSI_BENCH_SECTOR_SIZE)
+    {
+        scsi_bench_cmd(bench, opcode, lba, count);
+        lba = (lba + count) % SCSI_BENCH_SECTORS;
+    }
+    us = systime_elapsed_us(&uptime);
+
+    printf("SCSI %s(10), %d sectors, IO depth %d: ", opcode == SCSI_SBC_CMD_READ10 ? "READ" : "WRITE", count, depth);
+    if (bench->failed)
+        printf("failed\n");
+    else
+        printf("%d KB/s\n", us ? (unsigned int)((unsigned long long)(SCSI_BENCH_BYTES / 1024) * 1000000 / us) : 0);
+}
+
+void bench_scsi()
+{
+    SCSI_STORAGE_DESCRIPTOR descriptor;
+    SCSI_BENCH bench;
+    unsigned int i, depth;
+
+    descriptor.storage = process_create(&__RAM_DISK);
+    descriptor.user = 0;
+    descriptor.vendor = "RExOS";
+    descriptor.product = "RAM disk";
+    descriptor.revision = "1.0";
+    descriptor.hidden_sectors = 0;
+    descriptor.flags = 0;
+    descriptor.hal = HAL_SDMMC;
+    descriptor.scsi_device_type = SCSI_PERIPHERAL_DEVICE_TYPE_DIRECT_ACCESS;
+
+    bench.io = io_create(SCSI_BENCH_IO_SIZE);
+    bench.timer = timer_create(0, HAL_USBD);
+    bench.scsis = scsis_create(scsi_bench_cb, &bench, 0, &descriptor);
+    //non-removable media is requested on init
+    bench.busy = true;
+    bench.failed = false;
+    scsis_init(bench.scsis);
+    scsi_bench_wait(&bench);
+
+    //depth 1 is serial storage and host transfers
+    for (depth = 1; depth <= SCSI_IO_DEPTH; ++depth)
+    {
+        scsis_set_io_depth(bench.scsis, depth);
+        for (i = 0; i < sizeof(__SCSI_BENCH_COUNTS) / sizeof(__SCSI_BENCH_COUNTS[0]); ++i)
+        {
+            scsi_bench_run(&bench, SCSI_SBC_CMD_WRITE10, __SCSI_BENCH_COUNTS[i], depth);
+            scsi_bench_run(&bench, SCSI_SBC_CMD_READ10, __SCSI_BENCH_COUNTS[i], depth);
+        }
+    }
+
+    scsis_destroy(bench.scsis);
+    timer_destroy(bench.timer);
+    io_destroy(bench.io);
+    process_destroy(descriptor.storage);
+}
@@ -0,0 +1,13 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef BENCH_SCSI_H
+#define BENCH_SCSI_H
+
+//SCSI READ(10)/WRITE(10) throughput over RAM disk storage, with and without storage/host overlap
+void bench_scsi();
+
+#endif // BENCH_SCSI_H
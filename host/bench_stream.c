@@ -0,0 +1,89 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#include "bench_stream.h"
+#include "../userspace/stdio.h"
+#include "../userspace/process.h"
+#include "../userspace/systime.h"
+#include "../userspace/stream.h"
+#include "../userspace/ipc.h"
+#include "kernel_config.h"
+#include "../kernel/core/kposix.h"
+#include "config.h"
+
+void stream_reader();
+
+static const unsigned int __STREAM_CHUNKS[] = {1, 16, 64, STREAM_BENCH_CHUNK_MAX};
+
+static const REX __STREAM_READER = {
+    //name
+    "Stream reader",
+    //size
+    HOST_PROCESS_SIZE,
+    //priority - higher than app, so each write is passed to blocked reader
+    199,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    stream_reader
+};
+
+void stream_reader()
+{
+    IPC ipc;
+    HANDLE handle;
+    unsigned int left;
+    char buf[STREAM_BENCH_CHUNK_MAX];
+    for (;;)
+    {
+        //param1: stream, param2: bytes to read, param3: chunk size
+        ipc_read(&ipc);
+        handle = stream_open(ipc.param1);
+        for (left = ipc.param2; left; left -= ipc.param3)
+            stream_read(handle, buf, ipc.param3);
+        stream_close(handle);
+        ipc_post_inline(ipc.process, HAL_CMD(HAL_APP, IPC_READ), ipc.param1, ipc.param2, 0);
+    }
+}
+
+void bench_stream()
+{
+    HANDLE reader, stream, handle;
+    IPC ipc;
+    SYSTIME uptime;
+    POSIX_IRQ_OFF irq_off;
+    unsigned int i, left, chunk, us;
+    char buf[STREAM_BENCH_CHUNK_MAX];
+
+    for (i = 0; i < STREAM_BENCH_CHUNK_MAX; ++i)
+        buf[i] = i;
+    reader = process_create(&__STREAM_READER);
+    for (i = 0; i < sizeof(__STREAM_CHUNKS) / sizeof(__STREAM_CHUNKS[0]); ++i)
+    {
+        chunk = __STREAM_CHUNKS[i];
+        stream = stream_create(STREAM_BENCH_STREAM_SIZE);
+        handle = stream_open(stream);
+        //reset
+        posix_irq_off_stat(&irq_off);
+        get_uptime(&uptime);
+
+        ipc_post_inline(reader, HAL_CMD(HAL_APP, IPC_READ), stream, STREAM_BENCH_BYTES, chunk);
+        for (left = STREAM_BENCH_BYTES; left; left -= chunk)
+            stream_write(handle, buf, chunk);
+        ipc_read_ex(&ipc, reader, HAL_CMD(HAL_APP, IPC_READ), stream);
+
+        us = systime_elapsed_us(&uptime);
+        posix_irq_off_stat(&irq_off);
+        stream_close(handle);
+        stream_destroy(stream);
+
+        printf("stream, %d bytes chunks: %d KB/s", chunk, us ? (STREAM_BENCH_BYTES / 1024) * 1000000 / us : 0);
+        if (irq_off.count)
+            printf(", IRQ off max %dns, average %dns", irq_off.max_ns, (unsigned int)(irq_off.total_ns / irq_off.count));
+        printf("\n");
+    }
+    process_destroy(reader);
+}
@@ -0,0 +1,13 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef BENCH_STREAM_H
+#define BENCH_STREAM_H
+
+//stream throughput and interrupts disabled time
+void bench_stream();
+
+#endif // BENCH_STREAM_H
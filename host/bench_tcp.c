@@ -0,0 +1,420 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#include "bench_tcp.h"
+#include "../userspace/stdio.h"
+#include "../userspace/stdlib.h"
+#include "../userspace/process.h"
+#include "../userspace/systime.h"
+#include "../userspace/ipc.h"
+#include "../userspace/io.h"
+#include "../userspace/error.h"
+#include "../userspace/eth.h"
+#include "../userspace/mac.h"
+#include "../userspace/ip.h"
+#include "../userspace/tcp.h"
+#include "../userspace/tcpip.h"
+#include "sys_config.h"
+#include "config.h"
+#include <string.h>
+
+#define WIRE_FRAME_SIZE                             (TCPIP_MTU + sizeof(MAC_HEADER))
+#if (ETH_DOUBLE_BUFFERING)
+#define WIRE_RX_DEPTH                               2
+#else
+#define WIRE_RX_DEPTH                               1
+#endif //ETH_DOUBLE_BUFFERING
+
+typedef enum {
+    TCP_BENCH_SET_DELAY = IPC_USER
+} TCP_BENCH_IPCS;
+
+typedef struct {
+    unsigned int due, size;
+    uint8_t data[WIRE_FRAME_SIZE];
+} WIRE_FRAME;
+
+//frames, sent to port, are waiting for wire delay and port rx IO
+typedef struct {
+    HANDLE tcpip;
+    IO* rx[WIRE_RX_DEPTH];
+    unsigned int rx_count, head, count;
+    WIRE_FRAME frames[TCP_BENCH_WIRE_QUEUE];
+} WIRE_PORT;
+
+typedef struct {
+    WIRE_PORT ports[2];
+    SYSTIME start;
+    HANDLE timer;
+    unsigned int delay_us;
+    bool timer_active;
+} WIRE;
+
+void eth_wire();
+void tcp_sink();
+
+static const unsigned int __TCP_BENCH_RTT_US[] = {0, 1000, 5000, 20000};
+
+static const REX __ETH_WIRE = {
+    //name
+    "ETH wire",
+    //size
+    sizeof(WIRE) + HOST_PROCESS_SIZE,
+    //priority - higher than stacks, like ETH driver
+    196,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    eth_wire
+};
+
+static const REX __TCP_SINK = {
+    //name
+    "TCP sink",
+    //size
+    HOST_PROCESS_SIZE,
+    //priority
+    198,
+    //flags
+    PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME,
+    //function
+    tcp_sink
+};
+
+static void wire_deliver(WIRE* wire)
+{
+    WIRE_PORT* port;
+    WIRE_FRAME* frame;
+    IO* io;
+    unsigned int i, now;
+    unsigned int wait_us = 0;
+    int left;
+    bool wait = false;
+
+    now = systime_elapsed_us(&wire->start);
+    for (i = 0; i < 2; ++i)
+    {
+        port = &wire->ports[i];
+        while (port->count && port->rx_count)
+        {
+            frame = &port->frames[port->head];
+            left = (int)(frame->due - now);
+            if (left > 0)
+            {
+                if (!wait || ((unsigned int)left < wait_us))
+                    wait_us = left;
+                wait = true;
+                break;
+            }
+            io = port->rx[0];
+            memmove(port->rx, port->rx + 1, --port->rx_count * sizeof(IO*));
+            memcpy(io_data(io), frame->data, frame->size);
+            io->data_size = frame->size;
+            port->head = (port->head + 1) % TCP_BENCH_WIRE_QUEUE;
+            --port->count;
+            io_complete(port->tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), i, io);
+        }
+    }
+    if (wait && !wire->timer_active)
+    {
+        wire->timer_active = true;
+        timer_start_us(wire->timer, wait_us);
+    }
+}
+
+static inline void wire_open(WIRE* wire, HANDLE tcpip, unsigned int port)
+{
+    if (wire->ports[port].tcpip != INVALID_HANDLE)
+    {
+        error(ERROR_ALREADY_CONFIGURED);
+        return;
+    }
+    wire->ports[port].tcpip = tcpip;
+    //link is up as soon as port is opened
+    ipc_post_inline(tcpip, HAL_CMD(HAL_ETH, ETH_NOTIFY_LINK_CHANGED), port, ETH_100_FULL, 0);
+}
+
+static inline void wire_close(WIRE* wire, unsigned int port)
+{
+    WIRE_PORT* p = &wire->ports[port];
+    if (p->tcpip == INVALID_HANDLE)
+    {
+        error(ERROR_NOT_CONFIGURED);
+        return;
+    }
+    while (p->rx_count)
+        io_complete_ex(p->tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), port, p->rx[--p->rx_count], ERROR_IO_CANCELLED);
+    p->tcpip = INVALID_HANDLE;
+    p->count = 0;
+}
+
+static inline void wire_read(WIRE* wire, unsigned int port, IO* io)
+{
+    WIRE_PORT* p = &wire->ports[port];
+    if (p->rx_count >= WIRE_RX_DEPTH)
+    {
+        error(ERROR_IN_PROGRESS);
+        return;
+    }
+    p->rx[p->rx_count++] = io;
+    error(ERROR_SYNC);
+    wire_deliver(wire);
+}
+
+static inline void wire_write(WIRE* wire, HANDLE tcpip, unsigned int port, IO* io)
+{
+    WIRE_PORT* peer = &wire->ports[port ^ 1];
+    WIRE_FRAME* frame;
+    //dropped on overflow, as by real NIC
+    if ((peer->tcpip != INVALID_HANDLE) && (peer->count < TCP_BENCH_WIRE_QUEUE) && (io->data_size <= WIRE_FRAME_SIZE))
+    {
+        frame = &peer->frames[(peer->head + peer->count++) % TCP_BENCH_WIRE_QUEUE];
+        frame->due = systime_elapsed_us(&wire->start) + wire->delay_us;
+        frame->size = io->data_size;
+        memcpy(frame->data, io_data(io), io->data_size);
+    }
+    io_complete(tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), port, io);
+    error(ERROR_SYNC);
+    wire_deliver(wire);
+}
+
+static inline void wire_eth_request(WIRE* wire, IPC* ipc)
+{
+    MAC mac;
+    if (ipc->param1 > 1)
+    {
+        error(ERROR_INVALID_PARAMS);
+        return;
+    }
+    switch (HAL_ITEM(ipc->cmd))
+    {
+    case ETH_GET_MAC:
+        //locally administered, one per port
+        memset(&mac, 0, sizeof(MAC));
+        mac.u8[0] = 0x02;
+        mac.u8[5] = ipc->param1 + 1;
+        ipc->param2 = mac.u32.hi;
+        ipc->param3 = mac.u32.lo;
+        break;
+    case ETH_GET_HEADER_SIZE:
+        ipc->param2 = 0;
+        break;
+    case IPC_OPEN:
+        wire_open(wire, ipc->process, ipc->param1);
+        break;
+    case IPC_CLOSE:
+        wire_close(wire, ipc->param1);
+        break;
+    case IPC_READ:
+        wire_read(wire, ipc->param1, (IO*)ipc->param2);
+        break;
+    case IPC_WRITE:
+        wire_write(wire, ipc->process, ipc->param1, (IO*)ipc->param2);
+        break;
+    default:
+        error(ERROR_NOT_SUPPORTED);
+    }
+}
+
+static inline void wire_app_request(WIRE* wire, IPC* ipc)
+{
+    switch (HAL_ITEM(ipc->cmd))
+    {
+    case IPC_TIMEOUT:
+        wire->timer_active = false;
+        wire_deliver(wire);
+        break;
+    case TCP_BENCH_SET_DELAY:
+        wire->delay_us = ipc->param2;
+        break;
+    default:
+        error(ERROR_NOT_SUPPORTED);
+    }
+}
+
+void eth_wire()
+{
+    IPC ipc;
+    WIRE* wire = malloc(sizeof(WIRE));
+    unsigned int i;
+    for (i = 0; i < 2; ++i)
+    {
+        wire->ports[i].tcpip = INVALID_HANDLE;
+        wire->ports[i].rx_count = wire->ports[i].head = wire->ports[i].count = 0;
+    }
+    get_uptime(&wire->start);
+    wire->timer = timer_create(0, HAL_APP);
+    wire->delay_us = 0;
+    wire->timer_active = false;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (HAL_GROUP(ipc.cmd))
+        {
+        case HAL_ETH:
+            wire_eth_request(wire, &ipc);
+            break;
+        case HAL_APP:
+            wire_app_request(wire, &ipc);
+            break;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+        }
+        ipc_write(&ipc);
+    }
+}
+
+void tcp_sink()
+{
+    IPC ipc;
+    HANDLE app, tcpip;
+    unsigned int received = 0;
+    IO* io = io_create(TCP_BENCH_RX_SIZE + sizeof(TCP_STACK));
+    app = tcpip = INVALID_HANDLE;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        switch (ipc.cmd)
+        {
+        case HAL_REQ(HAL_APP, IPC_OPEN):
+            //param1: stack to listen on
+            app = ipc.process;
+            tcpip = ipc.param1;
+            tcp_listen(tcpip, TCP_BENCH_PORT);
+            break;
+        case HAL_CMD(HAL_TCP, IPC_OPEN):
+            tcp_read(tcpip, ipc.param1, io, TCP_BENCH_RX_SIZE);
+            break;
+        case HAL_IO_CMD(HAL_TCP, IPC_READ):
+            //connection closed
+            if ((int)ipc.param3 < 0)
+                break;
+            received += ipc.param3;
+            if (received >= TCP_BENCH_BYTES)
+            {
+                received -= TCP_BENCH_BYTES;
+                ipc_post_inline(app, HAL_CMD(HAL_APP, IPC_READ), TCP_BENCH_BYTES, 0, 0);
+            }
+            tcp_read(tcpip, ipc.param1, io, TCP_BENCH_RX_SIZE);
+            break;
+        case HAL_CMD(HAL_TCP, IPC_CLOSE):
+            tcp_close(tcpip, ipc.param1);
+            break;
+        default:
+            break;
+        }
+        ipc_write(&ipc);
+    }
+}
+
+static unsigned int tcp_bench_write(HANDLE tcpip, HANDLE conn, IO* io)
+{
+    TCP_STACK* tcp_stack;
+    io_reset(io);
+    io->data_size = TCP_BENCH_TX_SIZE;
+    tcp_stack = io_push(io, sizeof(TCP_STACK));
+    tcp_stack->flags = TCP_PSH;
+    tcp_stack->urg_len = 0;
+    tcp_write(tcpip, conn, io);
+    return TCP_BENCH_TX_SIZE;
+}
+
+static void tcp_bench_run(HANDLE wire, HANDLE tcpip, HANDLE conn, HANDLE sink, IO** ios, unsigned int rtt_us)
+{
+    IPC ipc;
+    SYSTIME uptime;
+    unsigned int i, sent, pending, us;
+    bool done, failed;
+
+    //each direction is half of round-trip
+    ack(wire, HAL_REQ(HAL_APP, TCP_BENCH_SET_DELAY), 0, rtt_us / 2, 0);
+    get_uptime(&uptime);
+    //keep full TCP tx queue
+    for (i = sent = pending = 0; (i < TCP_TX_QUEUE_SIZE) && (sent < TCP_BENCH_BYTES); ++i, ++pending)
+        sent += tcp_bench_write(tcpip, conn, ios[i]);
+    us = 0;
+    done = failed = false;
+    while (!done || pending)
+    {
+        ipc_read(&ipc);
+        if ((ipc.cmd == HAL_CMD(HAL_APP, IPC_READ)) && (ipc.process == sink))
+        {
+            us = systime_elapsed_us(&uptime);
+            done = true;
+        }
+        else if ((ipc.cmd == HAL_IO_CMD(HAL_TCP, IPC_WRITE)) && (ipc.process == tcpip) && (ipc.param1 == conn))
+        {
+            --pending;
+            if ((int)ipc.param3 < 0)
+            {
+                failed = done = true;
+                continue;
+            }
+            if (!failed && (sent < TCP_BENCH_BYTES))
+            {
+                sent += tcp_bench_write(tcpip, conn, (IO*)ipc.param2);
+                ++pending;
+            }
+        }
+    }
+
+    printf("TCP loopback, RTT %dus: ", rtt_us);
+    if (failed)
+        printf("failed\n");
+    else
+        printf("%d KB/s\n", us ? (unsigned int)((unsigned long long)(TCP_BENCH_BYTES / 1024) * 1000000 / us) : 0);
+}
+
+void bench_tcp()
+{
+    HANDLE wire, client, server, sink, conn;
+    IO* ios[TCP_TX_QUEUE_SIZE];
+    IP ip;
+    IPC ipc;
+    unsigned int i;
+
+    wire = process_create(&__ETH_WIRE);
+    client = tcpip_create(TCP_BENCH_STACK_SIZE, 197, 0);
+    server = tcpip_create(TCP_BENCH_STACK_SIZE, 197, 1);
+    ip.u32.ip = TCP_BENCH_CLIENT_IP;
+    ip_set(client, &ip);
+    ip.u32.ip = TCP_BENCH_SERVER_IP;
+    ip_set(server, &ip);
+    tcpip_open(client, wire, 0, ETH_AUTO);
+    tcpip_open(server, wire, 1, ETH_AUTO);
+    sink = process_create(&__TCP_SINK);
+    ack(sink, HAL_REQ(HAL_APP, IPC_OPEN), server, 0, 0);
+    for (i = 0; i < TCP_TX_QUEUE_SIZE; ++i)
+        ios[i] = io_create(TCP_BENCH_TX_SIZE + sizeof(TCP_STACK));
+
+    //ip is server address now
+    conn = tcp_create_tcb(client, &ip, TCP_BENCH_PORT);
+    if ((conn != INVALID_HANDLE) && tcp_open(client, conn))
+    {
+        ipc_read_ex(&ipc, client, HAL_CMD(HAL_TCP, IPC_OPEN), conn);
+        conn = ipc.param2;
+    }
+    else
+        conn = INVALID_HANDLE;
+
+    if (conn != INVALID_HANDLE)
+    {
+        for (i = 0; i < sizeof(__TCP_BENCH_RTT_US) / sizeof(__TCP_BENCH_RTT_US[0]); ++i)
+            tcp_bench_run(wire, client, conn, sink, ios, __TCP_BENCH_RTT_US[i]);
+        tcp_close(client, conn);
+    }
+    else
+        printf("TCP loopback: connection failed\n");
+
+    tcpip_close(client);
+    tcpip_close(server);
+    for (i = 0; i < TCP_TX_QUEUE_SIZE; ++i)
+        io_destroy(ios[i]);
+    process_destroy(sink);
+    process_destroy(server);
+    process_destroy(client);
+    process_destroy(wire);
+}
@@ -0,0 +1,13 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef BENCH_TCP_H
+#define BENCH_TCP_H
+
+//TCP throughput between two TCP/IP stacks, joined by wire with configurable round-trip time
+void bench_tcp();
+
+#endif // BENCH_TCP_H
@@ -0,0 +1,46 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//host frames are much bigger, than on target
+#define HOST_PROCESS_SIZE                           16384
+#define HOST_CONSOLE_STREAM_SIZE                    1024
+
+#define TEST_ROUNDS                                 10000
+//ready processes for scheduler wakeup test
+#define TEST_READY_PROCESSES                        20
+
+//stream benchmark. Bytes, transferred for each chunk size
+#define STREAM_BENCH_BYTES                          (1024 * 1024)
+#define STREAM_BENCH_STREAM_SIZE                    512
+#define STREAM_BENCH_CHUNK_MAX                      256
+
+//SCSI benchmark. Bytes, transferred for each command size and IO depth
+#define SCSI_BENCH_BYTES                            (1024 * 1024)
+#define SCSI_BENCH_DISK_SIZE                        (512 * 1024)
+#define SCSI_BENCH_SECTOR_SIZE                      512
+//host IO, as on USB mass storage class
+#define SCSI_BENCH_IO_SIZE                          4096
+//latency of each storage and host transfer. Without it storage and host can't overlap
+#define SCSI_BENCH_STORAGE_US                       500
+#define SCSI_BENCH_HOST_US                          500
+
+//TCP benchmark. Bytes, transferred for each round-trip time
+#define TCP_BENCH_BYTES                             (512 * 1024)
+#define TCP_BENCH_STACK_SIZE                        (4 * HOST_PROCESS_SIZE)
+#define TCP_BENCH_PORT                              5001
+#define TCP_BENCH_CLIENT_IP                         IP_MAKE(192, 168, 0, 1)
+#define TCP_BENCH_SERVER_IP                         IP_MAKE(192, 168, 0, 2)
+//user write size. Must divide TCP_BENCH_BYTES
+#define TCP_BENCH_TX_SIZE                           1024
+//receiver read size, defines TCP window
+#define TCP_BENCH_RX_SIZE                           4096
+//frames on wire, each direction
+#define TCP_BENCH_WIRE_QUEUE                        16
+
+#endif // CONFIG_H
@@ -0,0 +1,38 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef TEST_H
+#define TEST_H
+
+//common part of host unit tests. Native build, no POSIX core required
+
+#include <stdio.h>
+//not <time.h>: it collides with RExOS timer_create()
+#include <sys/time.h>
+
+static int failed = 0;
+
+typedef struct timeval TEST_TIME;
+
+static inline void test_time(TEST_TIME* start)
+{
+    gettimeofday(start, NULL);
+}
+
+static inline unsigned int elapsed_us(const TEST_TIME* start)
+{
+    TEST_TIME now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) * 1000000 + (now.tv_usec - start->tv_usec);
+}
+
+static inline int test_result(const char* name)
+{
+    printf("%s: %s\n", name, failed ? "FAILED" : "OK");
+    return failed;
+}
+
+#endif // TEST_H
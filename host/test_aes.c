@@ -0,0 +1,134 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//AES known answer test and benchmark. Native build, one binary per AES_IMPLEMENTATION
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "../midware/crypto/aes.h"
+
+#define AES_BENCH_BLOCKS                    100000
+#define AES_BENCH_CBC_SIZE                  4096
+#define AES_BENCH_CBC_ROUNDS                1000
+
+static const char* const __AES_NAMES[] = {"T-tables", "compact", "bitsliced", "AES-NI"};
+
+//FIPS-197 appendix C
+static const unsigned char __FIPS197_PLAIN[16] =    {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const unsigned char __FIPS197_CIPHER[3][16] = {
+    {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a},
+    {0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91},
+    {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89}
+};
+
+//SP 800-38A F.2.1, CBC-AES128
+static const unsigned char __CBC_KEY[16] =          {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const unsigned char __CBC_PLAIN[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+static const unsigned char __CBC_CIPHER[64] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+
+static void check(const char* name, const unsigned char* res, const unsigned char* expected, unsigned int size)
+{
+    if (memcmp(res, expected, size))
+    {
+        printf("FAIL: %s\n", name);
+        ++failed;
+    }
+}
+
+static unsigned int kb_per_s(unsigned long long bytes, unsigned int us)
+{
+    return us ? bytes * 1000000 / 1024 / us : 0;
+}
+
+static void kat()
+{
+    unsigned char key[32], buf[64], iv[16];
+    AES_KEY aes_key;
+    int i;
+
+    for (i = 0; i < 32; ++i)
+        key[i] = i;
+    for (i = 0; i < 3; ++i)
+    {
+        AES_set_encrypt_key(key, 128 + i * 64, &aes_key);
+        AES_encrypt(__FIPS197_PLAIN, buf, &aes_key);
+        check("FIPS-197 encrypt", buf, __FIPS197_CIPHER[i], 16);
+        AES_set_decrypt_key(key, 128 + i * 64, &aes_key);
+        AES_decrypt(__FIPS197_CIPHER[i], buf, &aes_key);
+        check("FIPS-197 decrypt", buf, __FIPS197_PLAIN, 16);
+    }
+
+    for (i = 0; i < 16; ++i)
+        iv[i] = i;
+    AES_set_encrypt_key(__CBC_KEY, 128, &aes_key);
+    AES_cbc_encrypt(__CBC_PLAIN, buf, sizeof(buf), &aes_key, iv, AES_ENCRYPT);
+    check("CBC encrypt", buf, __CBC_CIPHER, sizeof(buf));
+
+    for (i = 0; i < 16; ++i)
+        iv[i] = i;
+    AES_set_decrypt_key(__CBC_KEY, 128, &aes_key);
+    AES_cbc_encrypt(__CBC_CIPHER, buf, sizeof(buf), &aes_key, iv, AES_DECRYPT);
+    check("CBC decrypt", buf, __CBC_PLAIN, sizeof(buf));
+}
+
+static void bench()
+{
+    static unsigned char buf[AES_BENCH_CBC_SIZE];
+    unsigned char iv[16];
+    AES_KEY aes_key;
+    TEST_TIME start;
+    unsigned int us;
+    int i;
+
+    memset(buf, 0x5a, sizeof(buf));
+    memset(iv, 0, sizeof(iv));
+    AES_set_encrypt_key(__CBC_KEY, 128, &aes_key);
+    test_time(&start);
+    for (i = 0; i < AES_BENCH_BLOCKS; ++i)
+        AES_encrypt(buf, buf, &aes_key);
+    us = elapsed_us(&start);
+    printf("  block encrypt: %u ns/block\n", us * 1000 / AES_BENCH_BLOCKS);
+
+    test_time(&start);
+    for (i = 0; i < AES_BENCH_CBC_ROUNDS; ++i)
+        AES_cbc_encrypt(buf, buf, sizeof(buf), &aes_key, iv, AES_ENCRYPT);
+    us = elapsed_us(&start);
+    printf("  CBC encrypt: %u KB/s\n", kb_per_s(AES_BENCH_CBC_SIZE * AES_BENCH_CBC_ROUNDS, us));
+
+    AES_set_decrypt_key(__CBC_KEY, 128, &aes_key);
+    test_time(&start);
+    for (i = 0; i < AES_BENCH_CBC_ROUNDS; ++i)
+        AES_cbc_encrypt(buf, buf, sizeof(buf), &aes_key, iv, AES_DECRYPT);
+    us = elapsed_us(&start);
+    printf("  CBC decrypt: %u KB/s\n", kb_per_s(AES_BENCH_CBC_SIZE * AES_BENCH_CBC_ROUNDS, us));
+}
+
+int main()
+{
+#if (AES_IMPLEMENTATION == AES_IMPLEMENTATION_AESNI)
+    if (!__builtin_cpu_supports("aes"))
+    {
+        printf("aes %s: not supported by CPU, skipped\n", __AES_NAMES[AES_IMPLEMENTATION]);
+        return 0;
+    }
+#endif //AES_IMPLEMENTATION_AESNI
+    kat();
+    printf("aes %s: %s\n", __AES_NAMES[AES_IMPLEMENTATION], failed ? "FAILED" : "OK");
+    if (!failed)
+        bench();
+    return failed;
+}
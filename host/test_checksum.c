@@ -0,0 +1,128 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//internet checksum test and benchmark on ethernet frame sizes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "../userspace/ip.h"
+
+#define CHECKSUM_BENCH_BYTES                (64 * 1024 * 1024)
+#define CHECKSUM_BUF_SIZE                   2048
+
+static const unsigned int __FRAME_SIZES[] = {20, 64, 128, 256, 576, 1024, 1460, 1500};
+
+//ip.c config calls are not used by test
+void ack(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3) {}
+unsigned int get(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3) { return 0; }
+
+//RFC 1071 reference, byte at a time. Result in same host order as ip_checksum
+static uint16_t checksum_ref(const uint8_t* buf, unsigned int size)
+{
+    uint32_t sum = 0;
+    unsigned int i;
+    for (i = 0; i + 1 < size; i += 2)
+        sum += (buf[i] << 8) | buf[i + 1];
+    if (size & 1)
+        sum += buf[size - 1] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum & 0xffff;
+}
+
+static uint16_t be16(const uint8_t* buf)
+{
+    return (buf[0] << 8) | buf[1];
+}
+
+static void test(uint8_t* buf)
+{
+    unsigned int align, size, split;
+    uint16_t ref, res, field;
+    uint32_t sum;
+
+    //all alignments and odd sizes
+    for (align = 0; align < 4; ++align)
+        for (size = 0; size <= 100; ++size)
+        {
+            ref = checksum_ref(buf + align, size);
+            res = ip_checksum(buf + align, size);
+            if (res != ref)
+            {
+                printf("FAIL: ip_checksum align %u, size %u: %04x != %04x\n", align, size, res, ref);
+                ++failed;
+            }
+        }
+
+    //partial sums of pseudo header and payload, split on even offset
+    ref = checksum_ref(buf, 1500);
+    for (split = 0; split <= 64; split += 2)
+    {
+        sum = ip_checksum_add(0, buf, split);
+        sum = ip_checksum_add(sum, buf + split, 1500 - split);
+        res = ip_checksum_fold(sum);
+        if (res != ref)
+        {
+            printf("FAIL: ip_checksum_add split %u: %04x != %04x\n", split, res, ref);
+            ++failed;
+        }
+    }
+
+    //RFC 1624 update of one 16 bit field, TTL/protocol word
+    field = be16(buf + 8);
+    res = ip_checksum_update(ip_checksum(buf, 20), field, 0x1234);
+    buf[8] = 0x12;
+    buf[9] = 0x34;
+    if (res != checksum_ref(buf, 20))
+    {
+        printf("FAIL: ip_checksum_update\n");
+        ++failed;
+    }
+    buf[8] = field >> 8;
+    buf[9] = field & 0xff;
+}
+
+static void bench(uint8_t* buf)
+{
+    unsigned int i, j, rounds, us, us_ref;
+    TEST_TIME start;
+    volatile uint16_t res;
+
+    for (i = 0; i < sizeof(__FRAME_SIZES) / sizeof(__FRAME_SIZES[0]); ++i)
+    {
+        rounds = CHECKSUM_BENCH_BYTES / __FRAME_SIZES[i];
+        test_time(&start);
+        for (j = 0; j < rounds; ++j)
+            res = ip_checksum(buf, __FRAME_SIZES[i]);
+        us = elapsed_us(&start);
+        test_time(&start);
+        for (j = 0; j < rounds; ++j)
+            res = checksum_ref(buf, __FRAME_SIZES[i]);
+        us_ref = elapsed_us(&start);
+        printf("  %4u bytes: %u ns, %u MB/s, bytewise %u MB/s\n", __FRAME_SIZES[i], (unsigned int)((unsigned long long)us * 1000 / rounds),
+               us ? CHECKSUM_BENCH_BYTES / us : 0, us_ref ? CHECKSUM_BENCH_BYTES / us_ref : 0);
+    }
+    (void)res;
+}
+
+int main()
+{
+    uint8_t* buf;
+    unsigned int i;
+
+    buf = malloc(CHECKSUM_BUF_SIZE);
+    srand(1);
+    for (i = 0; i < CHECKSUM_BUF_SIZE; ++i)
+        buf[i] = rand();
+
+    test(buf);
+    if (!test_result("checksum"))
+        bench(buf);
+    free(buf);
+    return failed;
+}
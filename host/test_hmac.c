@@ -0,0 +1,128 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//HMAC known answer test and TLS record MAC benchmark
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "../midware/crypto/sha1.h"
+#include "../midware/crypto/sha256.h"
+
+#define HMAC_BENCH_BYTES                    (16 * 1024 * 1024)
+#define HMAC_BENCH_MAX_RECORD               16384
+//TLS MAC pseudo header: seq_num, type, version, length
+#define HMAC_TLS_HEADER_SIZE                13
+
+static const unsigned int __RECORD_SIZES[] = {64, 256, 1024, 4096, 16384};
+
+typedef struct {
+    const char* name;
+    const HMAC_HASH_STRUCT* hash_struct;
+    //RFC 2202/RFC 4231 test case 1, 2 and 6
+    uint8_t digest[3][32];
+} HMAC_KAT;
+
+static const HMAC_KAT __HMAC_KAT[] = {
+    {"HMAC-SHA1", &__HMAC_SHA1, {
+        {0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64, 0xe2, 0x8b, 0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e, 0xf1, 0x46, 0xbe, 0x00},
+        {0xef, 0xfc, 0xdf, 0x6a, 0xe5, 0xeb, 0x2f, 0xa2, 0xd2, 0x74, 0x16, 0xd5, 0xf1, 0x84, 0xdf, 0x9c, 0x25, 0x9a, 0x7c, 0x79},
+        {0xaa, 0x4a, 0xe5, 0xe1, 0x52, 0x72, 0xd0, 0x0e, 0x95, 0x70, 0x56, 0x37, 0xce, 0x8a, 0x3b, 0x55, 0xed, 0x40, 0x21, 0x12}
+    }},
+    {"HMAC-SHA256", &__HMAC_SHA256, {
+        {0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53, 0x5c, 0xa8, 0xaf, 0xce, 0xaf, 0x0b, 0xf1, 0x2b,
+         0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7, 0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7},
+        {0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+         0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43},
+        {0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f, 0x0d, 0x8a, 0x26, 0xaa, 0xcb, 0xf5, 0xb7, 0x7f,
+         0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14, 0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54}
+    }}
+};
+
+static void kat(const HMAC_KAT* kat, void* hash_ctx, unsigned int long_key_size)
+{
+    HMAC_CTX ctx;
+    uint8_t key[131], digest[32];
+    const char* data[3] = {"Hi There", "what do ya want for nothing?", "Test Using Larger Than Block-Size Key - Hash Key First"};
+    const uint8_t* keys[3] = {key, (const uint8_t*)"Jefe", key};
+    unsigned int key_sizes[3] = {20, 4, long_key_size};
+    int i;
+
+    for (i = 0; i < 3; ++i)
+    {
+        memset(key, i ? 0xaa : 0x0b, sizeof(key));
+        hmac_setup(&ctx, kat->hash_struct, hash_ctx, keys[i], key_sizes[i]);
+        //twice, midstate must be reusable
+        hmac_init(&ctx);
+        hmac_update(&ctx, "garbage", 7);
+        hmac_final(&ctx, digest);
+        hmac_init(&ctx);
+        hmac_update(&ctx, data[i], strlen(data[i]));
+        hmac_final(&ctx, digest);
+        if (memcmp(digest, kat->digest[i], kat->hash_struct->digest_size))
+        {
+            printf("FAIL: %s test case %d\n", kat->name, i == 2 ? 6 : i + 1);
+            ++failed;
+        }
+    }
+}
+
+static void bench(const HMAC_KAT* kat, void* hash_ctx)
+{
+    static uint8_t record[HMAC_BENCH_MAX_RECORD];
+    uint8_t header[HMAC_TLS_HEADER_SIZE], key[32], digest[32];
+    HMAC_CTX ctx;
+    TEST_TIME start;
+    unsigned int i, j, rounds, us, us_setup;
+
+    memset(record, 0x5a, sizeof(record));
+    memset(header, 0x17, sizeof(header));
+    memset(key, 0x0b, sizeof(key));
+    printf("%s records/s:\n", kat->name);
+    for (i = 0; i < sizeof(__RECORD_SIZES) / sizeof(__RECORD_SIZES[0]); ++i)
+    {
+        rounds = HMAC_BENCH_BYTES / __RECORD_SIZES[i];
+        hmac_setup(&ctx, kat->hash_struct, hash_ctx, key, kat->hash_struct->digest_size);
+        test_time(&start);
+        for (j = 0; j < rounds; ++j)
+        {
+            hmac_init(&ctx);
+            hmac_update(&ctx, header, HMAC_TLS_HEADER_SIZE);
+            hmac_update(&ctx, record, __RECORD_SIZES[i]);
+            hmac_final(&ctx, digest);
+        }
+        us = elapsed_us(&start);
+
+        //key schedule on each record, as without precomputed midstates
+        test_time(&start);
+        for (j = 0; j < rounds; ++j)
+        {
+            hmac_setup(&ctx, kat->hash_struct, hash_ctx, key, kat->hash_struct->digest_size);
+            hmac_init(&ctx);
+            hmac_update(&ctx, header, HMAC_TLS_HEADER_SIZE);
+            hmac_update(&ctx, record, __RECORD_SIZES[i]);
+            hmac_final(&ctx, digest);
+        }
+        us_setup = elapsed_us(&start);
+        printf("  %5u bytes: %u, with key setup %u\n", __RECORD_SIZES[i],
+               us ? (unsigned int)((unsigned long long)rounds * 1000000 / us) : 0,
+               us_setup ? (unsigned int)((unsigned long long)rounds * 1000000 / us_setup) : 0);
+    }
+}
+
+int main()
+{
+    SHA1_CTX sha1_ctx;
+    SHA256_CTX sha256_ctx;
+
+    kat(&__HMAC_KAT[0], &sha1_ctx, 80);
+    kat(&__HMAC_KAT[1], &sha256_ctx, 131);
+    if (test_result("hmac"))
+        return failed;
+    bench(&__HMAC_KAT[0], &sha1_ctx);
+    bench(&__HMAC_KAT[1], &sha256_ctx);
+    return 0;
+}
@@ -0,0 +1,374 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//TCP server unit test. Stack is cut below tcps: IP layer, timers and IPC are stubbed, peer is scripted by test
+
+#include <string.h>
+#include <sys/mman.h>
+#include "test.h"
+#include "../midware/tcpips/tcpips_private.h"
+#include "../userspace/process.h"
+#include "../userspace/tcp.h"
+#include "../userspace/endian.h"
+#include "../lib/lib_so.h"
+#include "../lib/lib_array.h"
+
+#define TEST_PROCESS                        1
+#define TEST_LOCAL_PORT                     80
+#define TEST_REMOTE_PORT                    1024
+#define TEST_REMOTE_ISN                     1000
+#define TEST_TEXT_SIZE                      100
+//few full sized segments and tail
+#define TEST_BURST_SIZE                     5000
+#define TEST_MSS                            (IP_FRAME_MAX_DATA_SIZE - TEST_TCP_HEADER_SIZE)
+#define TEST_FRAMES_UNLIMITED               1000
+#define TEST_OOO_TEXT_SIZE                  10
+#define TEST_TX_MAX                         16
+//all pointers are passed as unsigned int, so memory must be at SRAM_BASE, as in POSIX core
+#define TEST_HEAP_OFFSET                    0x1000
+
+//TCP header offsets
+#define TEST_TCP_SEQ                        4
+#define TEST_TCP_ACK                        8
+#define TEST_TCP_DATA_OFF                   12
+#define TEST_TCP_FLAGS                      13
+#define TEST_TCP_WINDOW                     14
+#define TEST_TCP_CHECKSUM                   16
+#define TEST_TCP_HEADER_SIZE                20
+
+static const void* __LIBS[LIB_ID_MAX];
+static uint8_t* __heap;
+static TCPIPS* __tcpips;
+static IP __local, __remote;
+static uint16_t __remote_port;
+//frames, that IP layer can allocate and frames, reported free by tcpips
+static unsigned int __frames, __frames_free;
+//segments sent by stack
+static IO* __tx[TEST_TX_MAX];
+static unsigned int __tx_count;
+//last IPC to user
+static unsigned int __ipc_cmd, __ipc_param1, __ipc_param2, __ipc_param3;
+
+static void* test_malloc(size_t size)
+{
+    size_t* ptr = (size_t*)__heap;
+    *ptr = size;
+    __heap += sizeof(size_t) + ((size + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1));
+    return ptr + 1;
+}
+
+static void* test_realloc(void* ptr, size_t size)
+{
+    void* res = test_malloc(size);
+    if (ptr != NULL)
+        memcpy(res, ptr, ((size_t*)ptr)[-1] < size ? ((size_t*)ptr)[-1] : size);
+    return res;
+}
+
+static void test_free(void* ptr)
+{
+    //heap is released on exit
+}
+
+const STD_MEM __STD_MEM = {
+    test_malloc,
+    test_realloc,
+    test_free
+};
+
+void error(int error)
+{
+}
+
+void get_uptime(SYSTIME* uptime)
+{
+    uptime->sec = 1;
+    uptime->usec = 0;
+}
+
+HANDLE timer_create(unsigned int param, HAL hal)
+{
+    return 1;
+}
+
+void timer_start_ms(HANDLE timer, unsigned int time_ms)
+{
+}
+
+void timer_stop(HANDLE timer, unsigned int param, HAL hal)
+{
+}
+
+void timer_destroy(HANDLE timer)
+{
+}
+
+void ipc_post_inline(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    __ipc_cmd = cmd;
+    __ipc_param1 = param1;
+    __ipc_param2 = param2;
+    __ipc_param3 = param3;
+}
+
+//io.c dependencies, not used by tcps
+void svc_call(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+}
+
+void ipc_read_ex(IPC* ipc, HANDLE process, unsigned int cmd, unsigned int param1)
+{
+}
+
+//tcp.c dependencies, not used by tcps
+void ack(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+}
+
+unsigned int get(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    return 0;
+}
+
+unsigned int get_handle(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    return 0;
+}
+
+static IO* test_io_create(unsigned int size)
+{
+    IO* io = test_malloc(sizeof(IO) + size);
+    io->size = sizeof(IO) + size;
+    io_reset(io);
+    return io;
+}
+
+IO* ips_allocate_io(TCPIPS* tcpips, unsigned int size, uint8_t proto)
+{
+    if (__frames == 0)
+        return NULL;
+    --__frames;
+    return test_io_create(size);
+}
+
+void ips_release_io(TCPIPS* tcpips, IO* io)
+{
+}
+
+void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst)
+{
+    if (__tx_count < TEST_TX_MAX)
+        __tx[__tx_count++] = io;
+}
+
+unsigned int tcpips_get_free_io_count(TCPIPS* tcpips)
+{
+    return __frames_free;
+}
+
+void icmps_tx_error(TCPIPS* tcpips, IO* original, ICMP_ERROR err, unsigned int offset)
+{
+}
+
+static void check(const char* name, bool res)
+{
+    if (!res)
+    {
+        printf("FAIL: %s\n", name);
+        ++failed;
+    }
+}
+
+static void request(unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    IPC ipc;
+    ipc.process = TEST_PROCESS;
+    ipc.cmd = cmd;
+    ipc.param1 = param1;
+    ipc.param2 = param2;
+    ipc.param3 = param3;
+    tcps_request(__tcpips, &ipc);
+}
+
+//segment from peer
+static void rx(uint8_t flags, uint32_t seq, uint32_t ack, const uint8_t* data, unsigned int size)
+{
+    IO* io = test_io_create(TEST_TCP_HEADER_SIZE + size);
+    uint8_t* tcp = io_data(io);
+    memset(tcp, 0, TEST_TCP_HEADER_SIZE);
+    short2be(tcp, __remote_port);
+    short2be(tcp + 2, TEST_LOCAL_PORT);
+    int2be(tcp + TEST_TCP_SEQ, seq);
+    int2be(tcp + TEST_TCP_ACK, ack);
+    tcp[TEST_TCP_DATA_OFF] = (TEST_TCP_HEADER_SIZE >> 2) << 4;
+    tcp[TEST_TCP_FLAGS] = flags;
+    short2be(tcp + TEST_TCP_WINDOW, 8192);
+    if (size)
+        memcpy(tcp + TEST_TCP_HEADER_SIZE, data, size);
+    io->data_size = TEST_TCP_HEADER_SIZE + size;
+    short2be(tcp + TEST_TCP_CHECKSUM, tcp_checksum(tcp, io->data_size, &__remote, &__local));
+    tcps_rx(__tcpips, io, &__remote);
+}
+
+static uint8_t* tx_data(unsigned int i)
+{
+    return io_data(__tx[i]);
+}
+
+static unsigned int tx_text_size(unsigned int i)
+{
+    return __tx[i]->data_size - ((tx_data(i)[TEST_TCP_DATA_OFF] >> 4) << 2);
+}
+
+static bool check_tx(const char* name, unsigned int i, uint32_t seq, unsigned int size)
+{
+    check(name, (__tx_count > i) && (be2int(tx_data(i) + TEST_TCP_SEQ) == seq) && (tx_text_size(i) == size));
+    return !failed;
+}
+
+//passive open from remote_port. Returns connection handle, ISN in isn
+static HANDLE test_open(uint16_t remote_port, uint32_t* isn)
+{
+    __remote_port = remote_port;
+    __tx_count = 0;
+    rx(TCP_FLAG_SYN, TEST_REMOTE_ISN, 0, NULL, 0);
+    check("SYN-ACK sent", __tx_count == 1 && tx_data(0)[TEST_TCP_FLAGS] == (TCP_FLAG_SYN | TCP_FLAG_ACK));
+    if (failed)
+        return INVALID_HANDLE;
+    *isn = be2int(tx_data(0) + TEST_TCP_SEQ);
+    check("SYN-ACK ack", be2int(tx_data(0) + TEST_TCP_ACK) == TEST_REMOTE_ISN + 1);
+
+    //pure ACK of SYN, no text
+    rx(TCP_FLAG_ACK, TEST_REMOTE_ISN + 1, *isn + 1, NULL, 0);
+    check("connection open", __ipc_cmd == HAL_CMD(HAL_TCP, IPC_OPEN));
+    __tx_count = 0;
+    return __ipc_param1;
+}
+
+static IO* test_write(HANDLE tcb, unsigned int size)
+{
+    TCP_STACK* tcp_stack;
+    unsigned int i;
+    IO* io = test_io_create(sizeof(TCP_STACK) + size);
+    uint8_t* text = io_data(io);
+    for (i = 0; i < size; ++i)
+        text[i] = i;
+    io->data_size = size;
+    tcp_stack = io_push(io, sizeof(TCP_STACK));
+    tcp_stack->flags = TCP_PSH;
+    tcp_stack->urg_len = 0;
+    request(HAL_IO_REQ(HAL_TCP, IPC_WRITE), tcb, (unsigned int)io, 0);
+    return io;
+}
+
+static void test_server_first()
+{
+    IO* io;
+    uint32_t isn;
+    HANDLE tcb = test_open(TEST_REMOTE_PORT, &isn);
+    if (failed)
+        return;
+
+    //server speaks first
+    io = test_write(tcb, TEST_TEXT_SIZE);
+    if (!check_tx("text sent", 0, isn + 1, TEST_TEXT_SIZE))
+        return;
+    check("text data", memcmp(tx_data(0) + TEST_TCP_HEADER_SIZE, io_data(io), TEST_TEXT_SIZE) == 0);
+
+    //all text acked: user block returned
+    rx(TCP_FLAG_ACK, TEST_REMOTE_ISN + 1, isn + 1 + TEST_TEXT_SIZE, NULL, 0);
+    check("write complete", __ipc_cmd == HAL_IO_CMD(HAL_TCP, IPC_WRITE) && __ipc_param2 == (unsigned int)io &&
+          __ipc_param3 == TEST_TEXT_SIZE);
+}
+
+static void test_burst()
+{
+    IO* io;
+    uint32_t isn;
+    HANDLE tcb = test_open(TEST_REMOTE_PORT + 1, &isn);
+    if (failed)
+        return;
+
+    //burst is limited by free frames, one is kept for rx
+    __frames_free = 3;
+    io = test_write(tcb, TEST_BURST_SIZE);
+    check("burst limited", __tx_count == 2);
+    if (!check_tx("burst first", 0, isn + 1, TEST_MSS) || !check_tx("burst second", 1, isn + 1 + TEST_MSS, TEST_MSS))
+        return;
+
+    //IP layer out of frames after first segment: unsent text is not lost
+    __frames_free = TEST_FRAMES_UNLIMITED;
+    __frames = 1;
+    rx(TCP_FLAG_ACK, TEST_REMOTE_ISN + 1, isn + 1 + 2 * TEST_MSS, NULL, 0);
+    check("burst out of frames", __tx_count == 3);
+    if (!check_tx("burst third", 2, isn + 1 + 2 * TEST_MSS, TEST_MSS))
+        return;
+    __frames = TEST_FRAMES_UNLIMITED;
+    rx(TCP_FLAG_ACK, TEST_REMOTE_ISN + 1, isn + 1 + 3 * TEST_MSS, NULL, 0);
+    if (!check_tx("burst tail", 3, isn + 1 + 3 * TEST_MSS, TEST_BURST_SIZE - 3 * TEST_MSS))
+        return;
+    check("burst data", memcmp(tx_data(3) + TEST_TCP_HEADER_SIZE, (uint8_t*)io_data(io) + 3 * TEST_MSS, TEST_BURST_SIZE - 3 * TEST_MSS) == 0);
+
+    rx(TCP_FLAG_ACK, TEST_REMOTE_ISN + 1, isn + 1 + TEST_BURST_SIZE, NULL, 0);
+    check("burst complete", __ipc_cmd == HAL_IO_CMD(HAL_TCP, IPC_WRITE) && __ipc_param2 == (unsigned int)io &&
+          __ipc_param3 == TEST_BURST_SIZE);
+}
+
+static void test_ooo()
+{
+    uint8_t text[TEST_OOO_TEXT_SIZE];
+    uint32_t isn;
+    unsigned int i, j;
+
+    memset(text, 0, sizeof(text));
+    //held segments are limited by all connections
+    for (i = 0; i < 2; ++i)
+    {
+        test_open(TEST_REMOTE_PORT + 2 + i, &isn);
+        if (failed)
+            return;
+        //every second segment lost
+        for (j = 0; j < TCP_OOO_SIZE; ++j)
+            rx(TCP_FLAG_ACK, TEST_REMOTE_ISN + 1 + (2 * j + 1) * sizeof(text), isn + 1, text, sizeof(text));
+    }
+    check("ooo limited", __tcpips->tcps.ooo_frames == TCP_OOO_FRAMES_MAX);
+
+    //released on close
+    for (i = 0; i < 2; ++i)
+    {
+        __remote_port = TEST_REMOTE_PORT + 2 + i;
+        rx(TCP_FLAG_RST, TEST_REMOTE_ISN + 1, 0, NULL, 0);
+    }
+    check("ooo released", __tcpips->tcps.ooo_frames == 0);
+}
+
+int main()
+{
+    if (mmap((void*)SRAM_BASE, SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != (void*)SRAM_BASE)
+    {
+        printf("tcp: SRAM mapping failed\n");
+        return 1;
+    }
+    __LIBS[LIB_ID_ARRAY] = &__LIB_ARRAY;
+    __LIBS[LIB_ID_SO] = &__LIB_SO;
+    __GLOBAL->lib = __LIBS;
+    __heap = (uint8_t*)SRAM_BASE + TEST_HEAP_OFFSET;
+
+    __tcpips = test_malloc(sizeof(TCPIPS));
+    memset(__tcpips, 0, sizeof(TCPIPS));
+    __tcpips->connected = true;
+    __local.u32.ip = IP_MAKE(192, 168, 0, 1);
+    __remote.u32.ip = IP_MAKE(192, 168, 0, 2);
+    __tcpips->ips.ip = __local;
+    tcps_init(__tcpips);
+    __frames = __frames_free = TEST_FRAMES_UNLIMITED;
+    request(HAL_REQ(HAL_TCP, TCP_LISTEN), TEST_LOCAL_PORT, 0, 0);
+
+    test_server_first();
+    test_burst();
+    test_ooo();
+    return test_result("tcp");
+}
@@ -0,0 +1,55 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//web parser unit test
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "../midware/http/web_parse.h"
+
+static void test_path(const char* path, bool expected)
+{
+    if (web_check_path(path) != expected)
+    {
+        printf("FAIL: web_check_path(\"%s\") != %d\n", path, expected);
+        ++failed;
+    }
+}
+
+static void test_url(const char* url, const char* expected)
+{
+    char buf[64];
+    char* cur = buf;
+    unsigned int size = strlen(url);
+    strcpy(buf, url);
+    if (!web_url_to_relative(&cur, &size) || (size != strlen(expected)) || strncmp(cur, expected, size))
+    {
+        printf("FAIL: web_url_to_relative(\"%s\") != \"%s\"\n", url, expected);
+        ++failed;
+    }
+}
+
+int main()
+{
+    test_url("/static/index.html", "/static/index.html");
+    test_url("/static//secret.txt", "/static//secret.txt");
+    //folder request
+    test_url("/static/sub/", "/static/sub");
+    test_url("/", "/");
+
+    //node tail, relative to node folder
+    test_path("index.html", true);
+    test_path("sub/index.html", true);
+    test_path("sub", true);
+    //GET /static//secret.txt
+    test_path("/secret.txt", false);
+    test_path("sub//secret.txt", false);
+    test_path("..", false);
+    test_path("sub/../../secret.txt", false);
+
+    return test_result("web");
+}
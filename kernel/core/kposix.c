@@ -0,0 +1,251 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    Host core. Build kernel, lib, userspace and midware with -m32 -DPOSIX, posix_host.c without
+    RExOS include folders, link with -lrt.
+    Userspace malloc/free overrides libc, so only non-allocating libc calls are used by core.
+*/
+
+#include "kposix.h"
+#include "posix_host.h"
+#include "kernel_config.h"
+#include "../kernel.h"
+#include "../kprocess.h"
+#include "../kirq.h"
+#include "../ksystime.h"
+#include "../dbg.h"
+#include "../../userspace/svc.h"
+#include <signal.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+extern void kprocess_abnormal_exit();
+
+#define POSIX_ALTSTACK_SIZE                         0x4000
+
+typedef struct {
+    //svc/IRQ nesting. Process context if 0
+    int kernel_depth;
+    bool switch_pending;
+    volatile unsigned int irq_pending;
+    unsigned int hpet_value;
+#if (POSIX_IRQ_OFF_STAT)
+    int irq_off_depth;
+    unsigned long long irq_off_start;
+    POSIX_IRQ_OFF irq_off;
+#endif //POSIX_IRQ_OFF_STAT
+    char altstack[POSIX_ALTSTACK_SIZE];
+} POSIX_CORE;
+
+static POSIX_CORE __POSIX;
+
+void posix_irq_pend(int vector)
+{
+    __sync_fetch_and_or(&__POSIX.irq_pending, 1u << vector);
+}
+
+#if (POSIX_IRQ_OFF_STAT)
+void posix_irq_off_enter(void)
+{
+    if (__POSIX.irq_off_depth++ == 0)
+        __POSIX.irq_off_start = posix_host_clock_ns();
+}
+
+void posix_irq_off_leave(void)
+{
+    unsigned int ns;
+    if (--__POSIX.irq_off_depth)
+        return;
+    ns = (unsigned int)(posix_host_clock_ns() - __POSIX.irq_off_start);
+    ++__POSIX.irq_off.count;
+    __POSIX.irq_off.total_ns += ns;
+    if (ns > __POSIX.irq_off.max_ns)
+        __POSIX.irq_off.max_ns = ns;
+}
+#endif //POSIX_IRQ_OFF_STAT
+
+void posix_irq_off_stat(POSIX_IRQ_OFF* stat)
+{
+#if (POSIX_IRQ_OFF_STAT)
+    *stat = __POSIX.irq_off;
+    __POSIX.irq_off.count = __POSIX.irq_off.max_ns = 0;
+    __POSIX.irq_off.total_ns = 0;
+#else
+    stat->count = stat->max_ns = 0;
+    stat->total_ns = 0;
+#endif //POSIX_IRQ_OFF_STAT
+}
+
+static void posix_irq_dispatch()
+{
+    unsigned int pending;
+    int vector;
+    while ((pending = __sync_fetch_and_and(&__POSIX.irq_pending, 0)) != 0)
+    {
+        for (vector = 0; pending; ++vector, pending >>= 1)
+            if (pending & 1)
+                kirq_enter(vector);
+    }
+}
+
+static void posix_halt()
+{
+    sigset_t all, saved;
+    sigfillset(&all);
+    sigprocmask(SIG_BLOCK, &all, &saved);
+    if (__POSIX.irq_pending == 0)
+        sigsuspend(&saved);
+    sigprocmask(SIG_SETMASK, &saved, NULL);
+}
+
+void pend_switch_context(void)
+{
+    __POSIX.switch_pending = true;
+}
+
+//PendSV analogue. Called on kernel exit only
+static void posix_switch_context()
+{
+    KPROCESS* active;
+    KPROCESS* next;
+    while (__POSIX.switch_pending)
+    {
+        __POSIX.switch_pending = false;
+        //halt core if no tasks
+        while (__KERNEL->next_process == NULL)
+        {
+            posix_halt();
+            ++__POSIX.kernel_depth;
+            posix_irq_dispatch();
+            --__POSIX.kernel_depth;
+        }
+        active = __KERNEL->active_process;
+        next = __KERNEL->next_process;
+        __KERNEL->active_process = next;
+        __KERNEL->next_process = NULL;
+        __GLOBAL->process = next->process;
+        if (next == active)
+            continue;
+        //active_process will be NULL on startup/task destroy
+        if (active == NULL)
+            setcontext((ucontext_t*)next->sp);
+        else
+            swapcontext((ucontext_t*)active->sp, (ucontext_t*)next->sp);
+    }
+}
+
+static void posix_kernel_exit()
+{
+    posix_irq_dispatch();
+    if (--__POSIX.kernel_depth == 0)
+        posix_switch_context();
+}
+
+void svc_call(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    ++__POSIX.kernel_depth;
+    __GLOBAL->svc_irq(num, param1, param2, param3);
+    posix_kernel_exit();
+}
+
+void* posix_get_sp()
+{
+    //kernel pool is limited by MSP on target
+    if (__POSIX.kernel_depth)
+        return (void*)(SRAM_BASE + SRAM_SIZE - KERNEL_STACK_MAX);
+    return __builtin_frame_address(0);
+}
+
+static void posix_process_entry(void (*fn)(void))
+{
+    fn();
+    ++__POSIX.kernel_depth;
+    kprocess_abnormal_exit();
+    posix_kernel_exit();
+}
+
+void process_setup_context(KPROCESS* process, void (*fn)(void))
+{
+    //context is saved on top of process stack, 16 bytes aligned
+    ucontext_t* ctx = (ucontext_t*)(((unsigned int)process->sp - sizeof(ucontext_t)) & ~15);
+    getcontext(ctx);
+    ctx->uc_link = NULL;
+    ctx->uc_stack.ss_sp = process->process;
+    ctx->uc_stack.ss_size = (unsigned int)ctx - (unsigned int)process->process;
+    sigemptyset(&ctx->uc_sigmask);
+    makecontext(ctx, (void (*)(void))posix_process_entry, 1, fn);
+    process->sp = (unsigned int*)ctx;
+}
+
+static void hpet_start(unsigned int value, void* param)
+{
+    __POSIX.hpet_value = value;
+    posix_host_hpet_start(value);
+}
+
+static void hpet_stop(void* param)
+{
+    posix_host_hpet_stop();
+}
+
+static unsigned int hpet_elapsed(void* param)
+{
+    unsigned int left = posix_host_hpet_left();
+    return left < __POSIX.hpet_value ? __POSIX.hpet_value - left : 0;
+}
+
+static void hpet_isr(int vector, void* param)
+{
+    ksystime_hpet_timeout();
+}
+
+static void second_pulse_isr(int vector, void* param)
+{
+    ksystime_second_pulse();
+}
+
+static void posix_stdout(const char *const buf, unsigned int size, void* param)
+{
+    posix_host_write(buf, size);
+}
+
+static void posix_timer_init()
+{
+    CB_SVC_TIMER cb_svc_timer;
+    posix_host_timer_init(POSIX_HPET_VECTOR, POSIX_SECOND_PULSE_VECTOR);
+
+    kirq_register(KERNEL_HANDLE, POSIX_HPET_VECTOR, hpet_isr, NULL);
+    cb_svc_timer.start = hpet_start;
+    cb_svc_timer.stop = hpet_stop;
+    cb_svc_timer.elapsed = hpet_elapsed;
+    ksystime_hpet_setup(&cb_svc_timer, NULL);
+
+    kirq_register(KERNEL_HANDLE, POSIX_SECOND_PULSE_VECTOR, second_pulse_isr, NULL);
+    posix_host_second_pulse_start();
+}
+
+int main(int argc, char* argv[])
+{
+    stack_t ss;
+    //SRAM at fixed address
+    if (mmap((void*)SRAM_BASE, SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != (void*)SRAM_BASE)
+        return 1;
+    //signal handlers are not running on small process stacks
+    ss.ss_sp = __POSIX.altstack;
+    ss.ss_size = POSIX_ALTSTACK_SIZE;
+    ss.ss_flags = 0;
+    sigaltstack(&ss, NULL);
+
+    //reset handler is running in privileged mode
+    __POSIX.kernel_depth = 1;
+    startup();
+    kernel_setup_dbg(posix_stdout, NULL);
+    posix_timer_init();
+    posix_kernel_exit();
+    //never reach
+    return 0;
+}
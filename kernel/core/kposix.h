@@ -0,0 +1,86 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef KPOSIX_H
+#define KPOSIX_H
+
+/*
+    kposix.h - host (linux userspace) core. Used for off-target profiling and benchmarking.
+
+    Core model:
+    - SRAM is mapped at fixed SRAM_BASE, so __GLOBAL/__KERNEL are at the same place, as on target
+    - every process is ucontext, saved on top of process stack, like cortex-m context frame
+    - IRQ are POSIX signals. Signal handler only pends vector, like NVIC. Pending vectors are
+      dispatched on kernel exit (svc_call return) or in halt, so kernel is never preempted.
+      As a result, process is also never preempted by IRQ - only on svc_call.
+    - HPET and second pulse are POSIX timers on CLOCK_MONOTONIC
+*/
+
+#include "../../userspace/cc_macro.h"
+
+#if (__SIZEOF_POINTER__ != 4)
+#error POSIX core is 32 bit only. Please compile with -m32
+#endif
+
+#define POSIX_HPET_VECTOR                           0
+#define POSIX_SECOND_PULSE_VECTOR                   1
+//first vector, available for user simulated peripherals
+#define POSIX_USER_VECTOR                           2
+
+typedef struct {
+    unsigned int count, max_ns;
+    unsigned long long total_ns;
+} POSIX_IRQ_OFF;
+
+__STATIC_INLINE void fatal()
+{
+    __builtin_trap();
+}
+
+#if (POSIX_IRQ_OFF_STAT)
+void posix_irq_off_enter(void);
+void posix_irq_off_leave(void);
+#endif //POSIX_IRQ_OFF_STAT
+
+//IRQ are dispatched only on kernel exit, so nothing to do here, except of time measure
+__STATIC_INLINE void disable_interrupts(void)
+{
+#if (POSIX_IRQ_OFF_STAT)
+    posix_irq_off_enter();
+#endif //POSIX_IRQ_OFF_STAT
+}
+
+__STATIC_INLINE void enable_interrupts(void)
+{
+#if (POSIX_IRQ_OFF_STAT)
+    posix_irq_off_leave();
+#endif //POSIX_IRQ_OFF_STAT
+}
+
+//CMSIS names, used by some kernel modules directly
+__STATIC_INLINE void __disable_irq(void)
+{
+}
+
+__STATIC_INLINE void __enable_irq(void)
+{
+}
+
+/**
+    \brief pend simulated IRQ vector. Safe to call from signal handler or another host thread
+    \param vector: IRQ vector. Must be less than IRQ_VECTORS_COUNT
+    \retval none
+*/
+void posix_irq_pend(int vector);
+
+/**
+    \brief get and reset interrupts disabled time stat. Zero, if POSIX_IRQ_OFF_STAT is not set
+    \param stat: time, measured with host clock since last call
+    \retval none
+*/
+void posix_irq_off_stat(POSIX_IRQ_OFF* stat);
+
+#endif // KPOSIX_H
@@ -0,0 +1,96 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#include "posix_host.h"
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+extern void posix_irq_pend(int vector);
+
+//RExOS userspace timer_create() is overriding libc one, so timers are created by system calls
+static int __HPET;
+static int __SECOND_PULSE;
+
+static void posix_host_signal(int signo, siginfo_t* info, void* uctx)
+{
+    posix_irq_pend(info->si_value.sival_int);
+}
+
+static int posix_host_timer_create(int signo, int vector)
+{
+    int timer;
+    struct sigevent sev;
+    struct sigaction sa;
+
+    sa.sa_sigaction = posix_host_signal;
+    //handler is running on core altstack, not on small process stack
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(signo, &sa, NULL);
+
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = signo;
+    sev.sigev_value.sival_int = vector;
+    syscall(SYS_timer_create, CLOCK_MONOTONIC, &sev, &timer);
+    return timer;
+}
+
+void posix_host_timer_init(int hpet_vector, int second_pulse_vector)
+{
+    __HPET = posix_host_timer_create(SIGRTMIN, hpet_vector);
+    __SECOND_PULSE = posix_host_timer_create(SIGRTMIN + 1, second_pulse_vector);
+}
+
+void posix_host_hpet_start(unsigned int us)
+{
+    struct itimerspec its = {{0, 0}, {us / 1000000, (us % 1000000) * 1000}};
+    syscall(SYS_timer_settime, __HPET, 0, &its, NULL);
+}
+
+void posix_host_hpet_stop()
+{
+    struct itimerspec its = {{0, 0}, {0, 0}};
+    syscall(SYS_timer_settime, __HPET, 0, &its, NULL);
+}
+
+unsigned int posix_host_hpet_left()
+{
+    struct itimerspec its;
+    syscall(SYS_timer_gettime, __HPET, &its);
+    return its.it_value.tv_sec * 1000000 + its.it_value.tv_nsec / 1000;
+}
+
+void posix_host_second_pulse_start()
+{
+    struct itimerspec its = {{1, 0}, {1, 0}};
+    syscall(SYS_timer_settime, __SECOND_PULSE, 0, &its, NULL);
+}
+
+void posix_host_write(const char *const buf, unsigned int size)
+{
+    ssize_t res;
+    unsigned int offset;
+    for (offset = 0; offset < size; offset += res)
+    {
+        res = write(STDOUT_FILENO, buf + offset, size - offset);
+        if (res <= 0)
+            break;
+    }
+}
+
+unsigned long long posix_host_clock_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void posix_host_exit(int code)
+{
+    _exit(code);
+}
@@ -0,0 +1,29 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef POSIX_HOST_H
+#define POSIX_HOST_H
+
+/*
+    posix_host.h - libc services for host core.
+    Userspace headers (time.h, stdio.h, stdlib.h) are shadowing libc ones, so posix_host.c must be
+    compiled without RExOS include folders.
+*/
+
+//create HPET and second pulse POSIX timers. Signals are pended as IRQ vectors with posix_irq_pend
+void posix_host_timer_init(int hpet_vector, int second_pulse_vector);
+void posix_host_hpet_start(unsigned int us);
+void posix_host_hpet_stop();
+//us left before HPET timeout
+unsigned int posix_host_hpet_left();
+void posix_host_second_pulse_start();
+void posix_host_write(const char *const buf, unsigned int size);
+//monotonic host clock. Used for measures below systime resolution
+unsigned long long posix_host_clock_ns();
+//terminate host program. Used by benchmarks on completion
+void posix_host_exit(int code);
+
+#endif // POSIX_HOST_H
@@ -193,6 +193,22 @@ void svc(unsigned int num, unsigned int param1, unsigned int param2, unsigned in
         CHECK_ADDRESS(process, (char*)param2, *((unsigned int*)param3));
         *((unsigned int*)param3) = kstream_read_no_block(param1, (char*)param2, *((unsigned int*)param3));
         break;
+    case SVC_STREAM_RESERVE:
+        CHECK_ADDRESS(process, (char**)param2, sizeof(char*));
+        CHECK_ADDRESS(process, (unsigned int*)param3, sizeof(unsigned int));
+        *((unsigned int*)param3) = kstream_reserve(param1, (char**)param2);
+        break;
+    case SVC_STREAM_COMMIT:
+        kstream_commit(param1, param2);
+        break;
+    case SVC_STREAM_PEEK:
+        CHECK_ADDRESS(process, (char**)param2, sizeof(char*));
+        CHECK_ADDRESS(process, (unsigned int*)param3, sizeof(unsigned int));
+        *((unsigned int*)param3) = kstream_peek(param1, (char**)param2);
+        break;
+    case SVC_STREAM_CONSUME:
+        kstream_consume(param1, param2);
+        break;
     case SVC_STREAM_FLUSH:
         kstream_flush(param1);
         break;
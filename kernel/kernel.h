@@ -49,10 +49,23 @@
 #error IRQ_VECTORS_COUNT is not decoded. Please specify it manually in Makefile
 #endif
 
+#if (KERNEL_TIMER_WHEEL) && (KERNEL_TIMER_WHEEL_SIZE & (KERNEL_TIMER_WHEEL_SIZE - 1))
+#error KERNEL_TIMER_WHEEL_SIZE must be power of 2
+#endif
+
+#if (KERNEL_READY_BITMAP)
+#if (KERNEL_PRIORITY_LEVELS > 1024)
+#error KERNEL_PRIORITY_LEVELS is limited to 1024
+#endif
+#define KERNEL_READY_GROUPS                                 ((KERNEL_PRIORITY_LEVELS + 31) / 32)
+#endif //KERNEL_READY_BITMAP
+
 #ifdef ARM7
 #include "core/arm7/core_arm7.h"
 #elif defined(CORTEX_M)
 #include "kcortexm.h"
+#elif defined(POSIX)
+#include "kposix.h"
 #else
 #error MCU core is not defined or not supported
 #endif
@@ -68,7 +81,7 @@ typedef struct {
     void* next_process;
 
     int kerror;
-    //active processes
+    //active processes. With KERNEL_READY_BITMAP only head (running process) is valid
     KPROCESS* processes;
 #if (KERNEL_PROCESS_STAT)
     KPROCESS* wait_processes;
@@ -98,11 +111,26 @@ typedef struct {
     //callback param for HPET timer
     void* cb_ktimer_param;
 
+#if (KERNEL_TIMER_WHEEL)
+    //current wheel second. All slots before are drained
+    unsigned int timer_sec;
+    //timers, that are not fit in wheel
+    KTIMER* timers;
+    KTIMER* timer_wheel[KERNEL_TIMER_WHEEL_SIZE];
+#else
     KTIMER* timers;
+#endif //KERNEL_TIMER_WHEEL
     //HPET value, set before call
     unsigned int hpet_value;
     //--------------------------- memory pools -------------------------
     ARRAY* pools;
+#if (KERNEL_READY_BITMAP)
+    //-------------------------- ready queue ---------------------------
+    //bit 31 - group/level 0 (highest priority), so CLZ is index
+    unsigned int ready_groups;
+    unsigned int ready_mask[KERNEL_READY_GROUPS];
+    KPROCESS* ready[KERNEL_PRIORITY_LEVELS];
+#endif //KERNEL_READY_BITMAP
     //-------------------------- kernel objects ------------------------
     HANDLE objects[KERNEL_OBJECTS_COUNT];
 } KERNEL;
@@ -36,6 +36,79 @@ static inline void switch_to_process(KPROCESS* kprocess)
     pend_switch_context();
 }
 
+#if (KERNEL_READY_BITMAP)
+#define READY_BIT(idx)                                  (1u << (31 - ((idx) & 31)))
+
+static inline unsigned int kprocess_level(KPROCESS* kprocess)
+{
+    return kprocess->base_priority < KERNEL_PRIORITY_LEVELS ? kprocess->base_priority : KERNEL_PRIORITY_LEVELS - 1;
+}
+
+static inline KPROCESS* kprocess_ready_highest()
+{
+    unsigned int group;
+    if (__KERNEL->ready_groups == 0)
+        return NULL;
+    group = __builtin_clz(__KERNEL->ready_groups);
+    return __KERNEL->ready[(group << 5) + __builtin_clz(__KERNEL->ready_mask[group])];
+}
+
+static inline void kprocess_ready_add(KPROCESS* kprocess, unsigned int level)
+{
+    dlist_add_tail((DLIST**)&__KERNEL->ready[level], (DLIST*)kprocess);
+    __KERNEL->ready_mask[level >> 5] |= READY_BIT(level);
+    __KERNEL->ready_groups |= READY_BIT(level >> 5);
+}
+
+static inline void kprocess_ready_remove(KPROCESS* kprocess, unsigned int level)
+{
+    dlist_remove((DLIST**)&__KERNEL->ready[level], (DLIST*)kprocess);
+    if (__KERNEL->ready[level] == NULL)
+    {
+        __KERNEL->ready_mask[level >> 5] &= ~READY_BIT(level);
+        if (__KERNEL->ready_mask[level >> 5] == 0)
+            __KERNEL->ready_groups &= ~READY_BIT(level >> 5);
+    }
+}
+
+void kprocess_add_to_active_list(KPROCESS* kprocess)
+{
+    KPROCESS* active = __KERNEL->processes;
+    unsigned int level = kprocess_level(kprocess);
+#if (KERNEL_PROCESS_STAT)
+    ksystime_get_uptime_internal(&kprocess->uptime_start);
+    dlist_remove((DLIST**)&__KERNEL->wait_processes, (DLIST*)kprocess);
+#endif
+    kprocess_ready_add(kprocess, level);
+    //return from core HALT or preemption
+    if (active == NULL || level < kprocess_level(active))
+    {
+        //preempted process goes to tail of it's priority level
+        if (active != NULL)
+            dlist_next((DLIST**)&__KERNEL->ready[kprocess_level(active)]);
+        __KERNEL->processes = kprocess;
+        switch_to_process(kprocess);
+    }
+}
+
+void kprocess_remove_from_active_list(KPROCESS* kprocess)
+{
+    kprocess_ready_remove(kprocess, kprocess_level(kprocess));
+    //freeze active task
+    if (kprocess == __KERNEL->processes)
+    {
+        __KERNEL->processes = kprocess_ready_highest();
+        switch_to_process(__KERNEL->processes);
+    }
+#if (KERNEL_PROCESS_STAT)
+    dlist_add_tail((DLIST**)&__KERNEL->wait_processes, (DLIST*)kprocess);
+    SYSTIME time;
+    ksystime_get_uptime_internal(&time);
+    systime_sub(&(kprocess->uptime_start), &time, &time);
+    systime_add(&time, &(kprocess->uptime), &(kprocess->uptime));
+#endif
+}
+#else
 void kprocess_add_to_active_list(KPROCESS* kprocess)
 {
     bool found = false;
@@ -92,6 +165,7 @@ void kprocess_remove_from_active_list(KPROCESS* kprocess)
     systime_add(&time, &(kprocess->uptime), &(kprocess->uptime));
 #endif
 }
+#endif //KERNEL_READY_BITMAP
 
 void kprocess_wakeup(HANDLE p)
 {
@@ -232,12 +306,15 @@ void kprocess_set_priority(HANDLE p, unsigned int priority)
     disable_interrupts();
     if (process->base_priority != priority)
     {
-        process->base_priority = priority;
+        //ready list of old priority must be updated first
         if ((process->flags & PROCESS_MODE_MASK) == PROCESS_MODE_ACTIVE)
         {
             kprocess_remove_from_active_list(process);
+            process->base_priority = priority;
             kprocess_add_to_active_list(process);
         }
+        else
+            process->base_priority = priority;
     }
     enable_interrupts();
 }
@@ -343,6 +420,11 @@ void kprocess_init(const REX* rex)
     __KERNEL->active_process = NULL;
     __KERNEL->kerror = ERROR_OK;
     dlist_clear((DLIST**)&__KERNEL->processes);
+#if (KERNEL_READY_BITMAP)
+    __KERNEL->ready_groups = 0;
+    memset(__KERNEL->ready_mask, 0, sizeof(__KERNEL->ready_mask));
+    memset(__KERNEL->ready, 0, sizeof(__KERNEL->ready));
+#endif //KERNEL_READY_BITMAP
 #if (KERNEL_PROCESS_STAT)
     dlist_clear((DLIST**)&__KERNEL->wait_processes);
 #endif
@@ -401,6 +483,9 @@ void process_stat(KPROCESS* kprocess)
 static inline void kernel_stat()
 {
     int i;
+#if (KERNEL_POOL_SLABS)
+    int cls;
+#endif //KERNEL_POOL_SLABS
     KPOOL* kpool;
     unsigned int total_size;
     bool damaged;
@@ -440,6 +525,13 @@ static inline void kernel_stat()
         total.free_slots += stat.free_slots;
         if (stat.largest_free > total.largest_free)
             total.largest_free = stat.largest_free;
+#if (KERNEL_POOL_SLABS)
+        for (cls = 0; cls < POOL_SLAB_CLASSES; ++cls)
+        {
+            total.slab_used[cls] += stat.slab_used[cls];
+            total.slab_free[cls] += stat.slab_free[cls];
+        }
+#endif //KERNEL_POOL_SLABS
     }
 
     printk("%-20.20s         ", __KERNEL_NAME);
@@ -460,6 +552,16 @@ static inline void kernel_stat()
     printk("%3d:%02d.%03d", uptime.sec / 60, uptime.sec % 60, uptime.usec / 1000);
 #endif
     printk("\n");
+#if (KERNEL_POOL_SLABS)
+    if (!damaged)
+    {
+        //kernel small objects per size class: used/cached
+        printk("    slabs:");
+        for (cls = 0; cls < POOL_SLAB_CLASSES; ++cls)
+            printk(" %d: %d/%d", POOL_SLAB_MIN << cls, total.slab_used[cls], total.slab_free[cls]);
+        printk("\n");
+    }
+#endif //KERNEL_POOL_SLABS
     __GLOBAL->process = saved;
 }
 
@@ -468,6 +570,9 @@ void kprocess_info()
     int cnt = 0;
     DLIST_ENUM de;
     KPROCESS* cur;
+#if (KERNEL_READY_BITMAP)
+    unsigned int level;
+#endif //KERNEL_READY_BITMAP
 #if (KERNEL_PROCESS_STAT)
     printk("\n    name           priority  stack  size   used       free        uptime\n");
 #else
@@ -475,12 +580,24 @@ void kprocess_info()
 #endif
     printk(STAT_LINE);
     disable_interrupts();
+#if (KERNEL_READY_BITMAP)
+    for (level = 0; level < KERNEL_PRIORITY_LEVELS; ++level)
+    {
+        dlist_enum_start((DLIST**)&__KERNEL->ready[level], &de);
+        while (dlist_enum(&de, (DLIST**)&cur))
+        {
+            process_stat(cur);
+            ++cnt;
+        }
+    }
+#else
     dlist_enum_start((DLIST**)&__KERNEL->processes, &de);
     while (dlist_enum(&de, (DLIST**)&cur))
     {
         process_stat(cur);
         ++cnt;
     }
+#endif //KERNEL_READY_BITMAP
 #if (KERNEL_PROCESS_STAT)
     dlist_enum_start((DLIST**)&__KERNEL->wait_processes, &de);
     while (dlist_enum(&de, (DLIST**)&cur))
@@ -24,6 +24,10 @@ typedef struct _KTIMER {
     void (*callback)(void*);
     void* param;
     bool active;
+#if (KERNEL_TIMER_WHEEL)
+    //wheel slot or overflow list, timer is queued in
+    struct _KTIMER** slot;
+#endif //KERNEL_TIMER_WHEEL
 } KTIMER;
 
 typedef struct {
@@ -190,6 +190,71 @@ void kstream_stop_listen(HANDLE process, HANDLE s)
     stream->listener = INVALID_HANDLE;
 }
 
+//copy to rb with at most 2 memcpy. Interrupts must be disabled
+static unsigned int kstream_put(STREAM* stream, char* buf, unsigned int size)
+{
+    unsigned int chunk, res;
+    for (res = 0; res < size && (chunk = rb_put_span(&stream->rb)) != 0; res += chunk)
+    {
+        if (chunk > size - res)
+            chunk = size - res;
+        memcpy(stream->data + rb_put_n(&stream->rb, chunk), buf + res, chunk);
+    }
+    return res;
+}
+
+//copy from rb with at most 2 memcpy. Interrupts must be disabled
+static unsigned int kstream_get(STREAM* stream, char* buf, unsigned int size)
+{
+    unsigned int chunk, res;
+    for (res = 0; res < size && (chunk = rb_get_span(&stream->rb)) != 0; res += chunk)
+    {
+        if (chunk > size - res)
+            chunk = size - res;
+        memcpy(buf + res, stream->data + rb_get_n(&stream->rb, chunk), chunk);
+    }
+    return res;
+}
+
+//push blocked writers data to stream. Interrupts must be disabled
+static void kstream_push_writers(STREAM* stream)
+{
+    register STREAM_HANDLE* writer;
+    unsigned int pushed;
+    while ((writer = stream->write_waiters) != NULL && !rb_is_full(&stream->rb))
+    {
+        pushed = kstream_put(stream, writer->buf, writer->size);
+        writer->buf += pushed;
+        writer->size -= pushed;
+        //writed all from waiter? Wake him up.
+        if (!writer->size)
+        {
+            dlist_remove_head((DLIST**)&stream->write_waiters);
+            kprocess_wakeup(writer->process);
+            writer->mode = STREAM_MODE_IDLE;
+        }
+    }
+}
+
+//pass stream data to blocked readers. Interrupts must be disabled
+static void kstream_pop_readers(STREAM* stream)
+{
+    register STREAM_HANDLE* reader;
+    unsigned int popped;
+    while ((reader = stream->read_waiters) != NULL && !rb_is_empty(&stream->rb))
+    {
+        popped = kstream_get(stream, reader->buf, reader->size);
+        reader->buf += popped;
+        reader->size -= popped;
+        if (!reader->size)
+        {
+            dlist_remove_head((DLIST**)&stream->read_waiters);
+            kprocess_wakeup(reader->process);
+            reader->mode = STREAM_MODE_IDLE;
+        }
+    }
+}
+
 unsigned int kstream_write_no_block_internal(STREAM_HANDLE *handle, char* buf, unsigned int size_max)
 {
     register STREAM_HANDLE* reader;
@@ -219,8 +284,8 @@ unsigned int kstream_write_no_block_internal(STREAM_HANDLE *handle, char* buf, u
         }
     }
     //write rest to stream
-    for(; to_write && !rb_is_full(&handle->stream->rb); --to_write)
-        handle->stream->data[rb_put(&handle->stream->rb)] = *buf++;
+    if (to_write)
+        to_write -= kstream_put(handle->stream, buf, to_write);
     enable_interrupts();
     return size_max - to_write;
 }
@@ -255,13 +320,14 @@ void kstream_write(HANDLE process, HANDLE h, char* buf, unsigned int size)
 unsigned int kstream_read_no_block(HANDLE h, char* buf, unsigned int size_max)
 {
     register STREAM_HANDLE* writer;
-    register unsigned int to_read, to_push;
+    register unsigned int to_read;
     STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
     CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
     //read from stream
     disable_interrupts();
-    for(to_read = size_max; to_read && !rb_is_empty(&handle->stream->rb); --to_read)
-        *buf++ = handle->stream->data[rb_get(&handle->stream->rb)];
+    to_read = kstream_get(handle->stream, buf, size_max);
+    buf += to_read;
+    to_read = size_max - to_read;
     //read directly from input
     while (to_read && (writer = handle->stream->write_waiters) != NULL)
     {
@@ -288,21 +354,7 @@ unsigned int kstream_read_no_block(HANDLE h, char* buf, unsigned int size_max)
     }
     //push data to stream internally after read
     if (to_read < size_max)
-    {
-        to_push = rb_free(&handle->stream->rb);
-        while ((writer = handle->stream->write_waiters) != NULL && to_push)
-        {
-            for(; to_push && writer->size; --writer->size, --to_push)
-                handle->stream->data[rb_put(&handle->stream->rb)] = *writer->buf++;
-            //writed all from waiter? Wake him up.
-            if (!writer->size)
-            {
-                dlist_remove_head((DLIST**)&handle->stream->write_waiters);
-                kprocess_wakeup(writer->process);
-                writer->mode = STREAM_MODE_IDLE;
-            }
-        }
-    }
+        kstream_push_writers(handle->stream);
     enable_interrupts();
     return size_max - to_read;
 }
@@ -323,6 +375,63 @@ void kstream_read(HANDLE process, HANDLE h, char* buf, unsigned int size)
     }
 }
 
+unsigned int kstream_reserve(HANDLE h, char** buf)
+{
+    unsigned int size;
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    size = rb_put_span(&handle->stream->rb);
+    *buf = handle->stream->data + handle->stream->rb.head;
+    enable_interrupts();
+    return size;
+}
+
+void kstream_commit(HANDLE h, unsigned int size)
+{
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    if (size > rb_put_span(&handle->stream->rb))
+    {
+        enable_interrupts();
+        error(ERROR_INVALID_PARAMS);
+        return;
+    }
+    rb_put_n(&handle->stream->rb, size);
+    kstream_pop_readers(handle->stream);
+    enable_interrupts();
+    kstream_check_inform(handle->stream);
+}
+
+unsigned int kstream_peek(HANDLE h, char** buf)
+{
+    unsigned int size;
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    size = rb_get_span(&handle->stream->rb);
+    *buf = handle->stream->data + handle->stream->rb.tail;
+    enable_interrupts();
+    return size;
+}
+
+void kstream_consume(HANDLE h, unsigned int size)
+{
+    STREAM_HANDLE* handle = (STREAM_HANDLE*)h;
+    CHECK_MAGIC(handle, MAGIC_STREAM_HANDLE);
+    disable_interrupts();
+    if (size > rb_get_span(&handle->stream->rb))
+    {
+        enable_interrupts();
+        error(ERROR_INVALID_PARAMS);
+        return;
+    }
+    rb_get_n(&handle->stream->rb, size);
+    kstream_push_writers(handle->stream);
+    enable_interrupts();
+}
+
 void kstream_flush(HANDLE s)
 {
     STREAM* stream = (STREAM*)s;
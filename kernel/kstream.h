@@ -25,6 +25,10 @@ unsigned int kstream_write_no_block(HANDLE h, char* buf, unsigned int size_max);
 void kstream_write(HANDLE process, HANDLE h, char* buf, unsigned int size);
 unsigned int kstream_read_no_block(HANDLE h, char* buf, unsigned int size_max);
 void kstream_read(HANDLE process, HANDLE h, char* buf, unsigned int size);
+unsigned int kstream_reserve(HANDLE h, char** buf);
+void kstream_commit(HANDLE h, unsigned int size);
+unsigned int kstream_peek(HANDLE h, char** buf);
+void kstream_consume(HANDLE h, unsigned int size);
 void kstream_flush(HANDLE s);
 void kstream_destroy(HANDLE s);
 
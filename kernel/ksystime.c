@@ -61,6 +61,92 @@ void ksystime_get_uptime(SYSTIME* res)
     enable_interrupts();
 }
 
+#if (KERNEL_TIMER_WHEEL)
+#define TIMER_SLOT(sec)                                 (&__KERNEL->timer_wheel[(sec) & (KERNEL_TIMER_WHEEL_SIZE - 1)])
+
+static inline void ksystime_timer_queue(KTIMER* timer)
+{
+    if (timer->time.sec < __KERNEL->timer_sec)
+        timer->slot = TIMER_SLOT(__KERNEL->timer_sec);
+    else if (timer->time.sec - __KERNEL->timer_sec < KERNEL_TIMER_WHEEL_SIZE)
+        timer->slot = TIMER_SLOT(timer->time.sec);
+    else
+        timer->slot = &__KERNEL->timers;
+    dlist_add_tail((DLIST**)timer->slot, (DLIST*)timer);
+}
+
+//move overflow timers, that are now fit in wheel. Called once per wheel turn
+static inline void ksystime_timer_cascade()
+{
+    DLIST_ENUM de;
+    KTIMER* cur;
+    dlist_enum_start((DLIST**)&__KERNEL->timers, &de);
+    while (dlist_enum(&de, (DLIST**)&cur))
+    {
+        if (cur->time.sec - __KERNEL->timer_sec < KERNEL_TIMER_WHEEL_SIZE)
+        {
+            dlist_remove_current_inside_enum((DLIST**)&__KERNEL->timers, &de, (DLIST*)cur);
+            ksystime_timer_queue(cur);
+        }
+    }
+}
+
+static inline void find_shoot_next()
+{
+    KTIMER* timers_to_shoot = NULL;
+    KTIMER* cur;
+    KTIMER* next;
+    KTIMER** slot;
+    DLIST_ENUM de;
+    SYSTIME uptime;
+
+    disable_interrupts();
+    ksystime_get_uptime_internal(&uptime);
+    //whole slots of passed seconds are expired
+    while (__KERNEL->timer_sec != uptime.sec)
+    {
+        slot = TIMER_SLOT(__KERNEL->timer_sec);
+        while (*slot)
+        {
+            cur = *slot;
+            cur->active = false;
+            dlist_remove_head((DLIST**)slot);
+            dlist_add_tail((DLIST**)&timers_to_shoot, (DLIST*)cur);
+        }
+        if ((++__KERNEL->timer_sec & (KERNEL_TIMER_WHEEL_SIZE - 1)) == 0)
+            ksystime_timer_cascade();
+    }
+    //this second events
+    next = NULL;
+    slot = TIMER_SLOT(uptime.sec);
+    dlist_enum_start((DLIST**)slot, &de);
+    while (dlist_enum(&de, (DLIST**)&cur))
+    {
+        if (systime_compare(&cur->time, &uptime) >= 0)
+        {
+            cur->active = false;
+            dlist_remove_current_inside_enum((DLIST**)slot, &de, (DLIST*)cur);
+            dlist_add_tail((DLIST**)&timers_to_shoot, (DLIST*)cur);
+        }
+        else if (next == NULL || cur->time.usec < next->time.usec)
+            next = cur;
+    }
+    if (next != NULL)
+    {
+        __KERNEL->uptime.usec += __KERNEL->cb_ktimer.elapsed(__KERNEL->cb_ktimer_param);
+        __KERNEL->cb_ktimer.stop(__KERNEL->cb_ktimer_param);
+        __KERNEL->hpet_value = next->time.usec - __KERNEL->uptime.usec;
+        __KERNEL->cb_ktimer.start(__KERNEL->hpet_value, __KERNEL->cb_ktimer_param);
+    }
+    enable_interrupts();
+    while (timers_to_shoot)
+    {
+        cur = timers_to_shoot;
+        dlist_remove_head((DLIST**)&timers_to_shoot);
+        cur->callback(cur->param);
+    }
+}
+#else
 static inline void find_shoot_next()
 {
     volatile KTIMER* timers_to_shoot = NULL;
@@ -98,6 +184,7 @@ static inline void find_shoot_next()
         cur->callback(cur->param);
     }
 }
+#endif //KERNEL_TIMER_WHEEL
 
 void ksystime_second_pulse()
 {
@@ -144,14 +231,19 @@ void ksystime_hpet_setup(const CB_SVC_TIMER *cb_ktimer, void *cb_ktimer_param)
 void ksystime_timer_start_internal(KTIMER* timer, SYSTIME *time)
 {
     SYSTIME uptime;
+#if !(KERNEL_TIMER_WHEEL)
     DLIST_ENUM de;
     KTIMER* cur;
     bool found = false;
+#endif //KERNEL_TIMER_WHEEL
     ksystime_get_uptime(&uptime);
     timer->time.sec = time->sec;
     timer->time.usec = time->usec;
     systime_add(&uptime, &timer->time, &timer->time);
     disable_interrupts();
+#if (KERNEL_TIMER_WHEEL)
+    ksystime_timer_queue(timer);
+#else
     dlist_enum_start((DLIST**)&__KERNEL->timers, &de);
     while (dlist_enum(&de, (DLIST**)&cur))
         if (systime_compare(&cur->time, &timer->time) < 0)
@@ -162,6 +254,7 @@ void ksystime_timer_start_internal(KTIMER* timer, SYSTIME *time)
         }
     if (!found)
         dlist_add_tail((DLIST**)&__KERNEL->timers, (DLIST*)timer);
+#endif //KERNEL_TIMER_WHEEL
     timer->active = true;
     enable_interrupts();
     find_shoot_next();
@@ -171,7 +264,11 @@ void ksystime_timer_stop_internal(KTIMER* timer)
 {
     if (timer->active)
     {
+#if (KERNEL_TIMER_WHEEL)
+        dlist_remove((DLIST**)timer->slot, (DLIST*)timer);
+#else
         dlist_remove((DLIST**)&__KERNEL->timers, (DLIST*)timer);
+#endif //KERNEL_TIMER_WHEEL
         timer->active = false;
     }
 }
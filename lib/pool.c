@@ -53,6 +53,55 @@ static const unsigned int RANGE_MARK_POOL_END =                   0xeeeeeeee;
 
 #endif //(KERNEL_RANGE_CHECKING)
 
+#if (KERNEL_POOL_SLABS)
+
+#define SLAB_SIZE(cls)                                            (POOL_SLAB_MIN << (cls))
+#define SLAB_MAX                                                  SLAB_SIZE(POOL_SLAB_CLASSES - 1)
+#define SLAB_MIN_BITS                                             __builtin_ctz(POOL_SLAB_MIN)
+
+static void slot_free(POOL* pool, void* ptr);
+
+//smallest class, fitting len
+static inline int slab_class(size_t len)
+{
+    if (len <= POOL_SLAB_MIN)
+        return 0;
+    return 32 - __builtin_clz(len - 1) - SLAB_MIN_BITS;
+}
+
+//class, served by slot of size, or -1
+static inline int slab_slot_class(size_t size)
+{
+    int cls;
+    if (size < POOL_SLAB_MIN || size >= SLAB_MAX + POOL_SLAB_MIN)
+        return -1;
+    cls = 31 - __builtin_clz(size) - SLAB_MIN_BITS;
+    return cls < POOL_SLAB_CLASSES ? cls : POOL_SLAB_CLASSES - 1;
+}
+
+//return cached objects to pool
+static bool slab_flush(POOL* pool)
+{
+    int cls;
+    void* cur;
+    bool res = false;
+    for (cls = 0; cls < POOL_SLAB_CLASSES; ++cls)
+    {
+        while ((cur = pool->slab[cls]) != NULL)
+        {
+            pool->slab[cls] = NEXT_FREE(cur);
+            slot_free(pool, cur);
+            res = true;
+        }
+    }
+    return res;
+}
+
+#else
+
+#define slot_free                                                 pool_free
+
+#endif //KERNEL_POOL_SLABS
 
 /*
         malloc
@@ -62,6 +111,9 @@ static const unsigned int RANGE_MARK_POOL_END =                   0xeeeeeeee;
         <data>            <--- returned pointer
         <align to sizeof(int)>
 
+        small objects (KERNEL_POOL_SLABS) are allocated as data slots, rounded to size class. On free
+        they are not merged, but cached in per class free list (pool->slab) and reused in O(1).
+
         free slot:
         SLOT_HEADER        <--- next slot (pointing to data AFTER SLOT_HEADER)
         <free bytes>    <--- pointer to next free slot or NULL
@@ -79,6 +131,7 @@ void pool_init(POOL* pool, void* data)
     NEXT_SLOT(pool->first_slot) = NULL;
     SET_MARK(pool->first_slot);
     pool->free_slot = NULL;
+    memset(pool->slab, 0, sizeof(pool->slab));
 }
 
 static bool grow(POOL* pool, size_t size, void* sp)
@@ -94,6 +147,11 @@ static bool grow(POOL* pool, size_t size, void* sp)
     //check uint overflow and compare with stack
     if (NUM(new_last) < NUM(pool->last_slot) || NUM(new_last) >= NUM(sp))
     {
+#if (KERNEL_POOL_SLABS)
+        //give cached small objects back and retry
+        if (slab_flush(pool))
+            return true;
+#endif //KERNEL_POOL_SLABS
         error(ERROR_OUT_OF_MEMORY);
         return false;
     }
@@ -104,7 +162,7 @@ static bool grow(POOL* pool, size_t size, void* sp)
     SET_MARK(pool->last_slot);
     SET_MARK(new_last);
 
-    pool_free(pool, pool->last_slot);
+    slot_free(pool, pool->last_slot);
     pool->last_slot = new_last;
     return true;
 }
@@ -113,19 +171,40 @@ void* pool_malloc(POOL* pool, size_t size, void* sp)
 {
     size_t len;
     register void *free_before, *next_slot, *new_slot, *cur;
+#if (KERNEL_POOL_SLABS)
+    int cls;
+#else
     int i;
+#endif //KERNEL_POOL_SLABS
 
-    //optimize for ARM 32bit align
-    len = ALIGN(size);
     if (size == 0)
         return NULL;
+#if (KERNEL_POOL_SLABS)
+    if (size <= SLAB_MAX)
+    {
+        cls = slab_class(size);
+        if ((cur = pool->slab[cls]) != NULL)
+        {
+            pool->slab[cls] = NEXT_FREE(cur);
+            return cur;
+        }
+        size = SLAB_SIZE(cls);
+    }
+#endif //KERNEL_POOL_SLABS
+    //optimize for ARM 32bit align
+    len = ALIGN(size);
     if (NUM(pool->last_slot) + len < NUM(pool->last_slot))
     {
         error(ERROR_OUT_OF_MEMORY);
         return NULL;
     }
 
+#if (KERNEL_POOL_SLABS)
+    //grow can also return cached objects to pool
+    for (;;)
+#else
     for (i = 0; i < 2; ++i)
+#endif //KERNEL_POOL_SLABS
     {
         //forward thru empty slots
         for (free_before = NULL, cur = pool->free_slot; cur != NULL; free_before = cur, cur = NEXT_FREE(cur))
@@ -174,9 +253,16 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
     register void *next, *p, *n;
     void *res;
     unsigned int cur_size;
-    unsigned int len = ALIGN(size);
+    unsigned int len;
     int i;
 
+#if (KERNEL_POOL_SLABS)
+    //keep small slots in size classes
+    if (size && size <= SLAB_MAX)
+        size = SLAB_SIZE(slab_class(size));
+#endif //KERNEL_POOL_SLABS
+    len = ALIGN(size);
+
     if (ptr == NULL)
         return pool_malloc(pool, len, sp);
     next = NEXT_SLOT(ptr);
@@ -226,7 +312,7 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
             NEXT_SLOT(ptr) = n;
             SET_MARK(ptr);
             SET_MARK(n);
-            pool_free(pool, n);
+            slot_free(pool, n);
         }
         return ptr;
     }
@@ -241,7 +327,32 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
     return res;
 }
 
+#if (KERNEL_POOL_SLABS)
+void pool_free(POOL* pool, void* ptr)
+{
+    int cls;
+    if (ptr == NULL)
+        return;
+    cls = slab_slot_class(pool_slot_size(pool, ptr));
+    if (cls < 0)
+    {
+        slot_free(pool, ptr);
+        return;
+    }
+    //simple double free check
+    if (pool->slab[cls] == ptr)
+    {
+        error(ERROR_POOL_CORRUPTED);
+        return;
+    }
+    NEXT_FREE(ptr) = pool->slab[cls];
+    pool->slab[cls] = ptr;
+}
+
+static void slot_free(POOL* pool, void* ptr)
+#else
 void pool_free(POOL* pool, void* ptr)
+#endif //KERNEL_POOL_SLABS
 {
     register void* free_before;
     register void* free_after;
@@ -305,6 +416,9 @@ void* pool_free_ptr(POOL* pool)
 bool pool_check(POOL* pool, void* sp)
 {
     register void *before, *cur;
+#if (KERNEL_POOL_SLABS)
+    int i;
+#endif //KERNEL_POOL_SLABS
     //basic check
     if (pool->first_slot == NULL || pool->last_slot == NULL ||
          NUM(pool->first_slot) > NUM(pool->last_slot) ||
@@ -391,6 +505,20 @@ bool pool_check(POOL* pool, void* sp)
         }
 #endif //(KERNEL_RANGE_CHECKING)
     }
+#if (KERNEL_POOL_SLABS)
+    //check cached objects
+    for (i = 0; i < POOL_SLAB_CLASSES; ++i)
+    {
+        for (cur = pool->slab[i]; cur != NULL; cur = NEXT_FREE(cur))
+        {
+            if (NUM(cur) < NUM(pool->first_slot) || NUM(cur) >= NUM(pool->last_slot) || slab_slot_class(pool_slot_size(pool, cur)) != i)
+            {
+                error(ERROR_POOL_CORRUPTED);
+                return false;
+            }
+        }
+    }
+#endif //KERNEL_POOL_SLABS
     return true;
 }
 
@@ -398,6 +526,9 @@ void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
 {
     void *cur, *cur_free;
     unsigned int size;
+#if (KERNEL_POOL_SLABS)
+    int cls;
+#endif //KERNEL_POOL_SLABS
     memset(stat, 0, sizeof(POOL_STAT));
     if (pool_check(pool, sp))
     {
@@ -418,8 +549,25 @@ void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
             {
                 ++stat->used_slots;
                 stat->used += size;
+#if (KERNEL_POOL_SLABS)
+                if ((cls = slab_slot_class(size)) >= 0)
+                    ++stat->slab_used[cls];
+#endif //KERNEL_POOL_SLABS
+            }
+        }
+#if (KERNEL_POOL_SLABS)
+        //cached objects are neither used, nor free for large allocations
+        for (cls = 0; cls < POOL_SLAB_CLASSES; ++cls)
+        {
+            for (cur = pool->slab[cls]; cur != NULL; cur = NEXT_FREE(cur))
+            {
+                --stat->used_slots;
+                stat->used -= pool_slot_size(pool, cur);
+                --stat->slab_used[cls];
+                ++stat->slab_free[cls];
             }
         }
+#endif //KERNEL_POOL_SLABS
     }
     //space between last_slot and sp possibly can grow
     if (NUM(sp) >= NUM(pool->last_slot) + sizeof(unsigned int) + MIN_SLOT_FULL_SIZE)
@@ -55,6 +55,7 @@
 #define AES_H
 
 #include <stddef.h>
+#include "sys_config.h"
 
 # define AES_ENCRYPT     1
 # define AES_DECRYPT     0
@@ -66,13 +67,24 @@
 # define AES_MAXNR 14
 # define AES_BLOCK_SIZE 16
 
+//AES_IMPLEMENTATION in sys_config.h. T-tables is default
+#define AES_IMPLEMENTATION_TTABLE                       0
+#define AES_IMPLEMENTATION_COMPACT                      1
+#define AES_IMPLEMENTATION_BITSLICED                    2
+#define AES_IMPLEMENTATION_AESNI                        3
+
 #ifdef  __cplusplus
 extern "C" {
 #endif
 
 /* This should be a hidden type, but EVP requires that the size be known */
 typedef struct {
+#if (AES_IMPLEMENTATION == AES_IMPLEMENTATION_BITSLICED)
+    //round keys are expanded for both bitsliced blocks
+    unsigned int rd_key[8 * (AES_MAXNR + 1)];
+#else
     unsigned int rd_key[4 * (AES_MAXNR + 1)];
+#endif //AES_IMPLEMENTATION_BITSLICED
     int rounds;
 } AES_KEY;
 
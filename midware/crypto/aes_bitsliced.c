@@ -0,0 +1,587 @@
+/* BearSSL src/symcipher/aes_ct.c, aes_ct_enc.c, aes_ct_dec.c */
+/*
+ * Copyright (c) 2016 Thomas Pornin <pornin@bolet.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+//Note: modified for RExOS. br_aes_ct_ortho, br_aes_ct_skey_expand and Boyar-Peralta S-box
+//(br_aes_ct_bitslice_Sbox) are ported to OpenSSL-compatible AES_KEY interface
+
+/*
+    Bitsliced constant time AES. No tables, no data dependent branches or memory access.
+    Two blocks are processed at once in 8 x 32 bit words: bit i of byte j of each block is in word i.
+    Block 0 is in even bits, block 1 in odd bits. CBC decrypt is using both, single block - only one.
+    S-box is Boyar-Peralta circuit. Key schedule is stored expanded for both blocks (8 words per round) in AES_KEY.
+*/
+
+#include "sys_config.h"
+#include "aes.h"
+#include <stdint.h>
+#include <string.h>
+
+#if (AES_IMPLEMENTATION == AES_IMPLEMENTATION_BITSLICED)
+
+#define AES_SWAPN(cl, ch, s, x, y)          do { \
+                                                uint32_t a, b; \
+                                                a = (x); \
+                                                b = (y); \
+                                                (x) = (a & (uint32_t)(cl)) | ((b & (uint32_t)(cl)) << (s)); \
+                                                (y) = ((a & (uint32_t)(ch)) >> (s)) | (b & (uint32_t)(ch)); \
+                                            } while (0)
+
+#define AES_SWAP2(x, y)                     AES_SWAPN(0x55555555, 0xaaaaaaaa, 1, x, y)
+#define AES_SWAP4(x, y)                     AES_SWAPN(0x33333333, 0xcccccccc, 2, x, y)
+#define AES_SWAP8(x, y)                     AES_SWAPN(0x0f0f0f0f, 0xf0f0f0f0, 4, x, y)
+
+static const uint8_t __AES_RCON[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+
+static inline uint32_t aes_dec32le(const uint8_t* src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static inline void aes_enc32le(uint8_t* dst, uint32_t x)
+{
+    dst[0] = (uint8_t)x;
+    dst[1] = (uint8_t)(x >> 8);
+    dst[2] = (uint8_t)(x >> 16);
+    dst[3] = (uint8_t)(x >> 24);
+}
+
+static inline uint32_t aes_rotr16(uint32_t x)
+{
+    return (x << 16) | (x >> 16);
+}
+
+//transpose to bitsliced representation and back (involution)
+static void aes_ortho(uint32_t* q)
+{
+    AES_SWAP2(q[0], q[1]);
+    AES_SWAP2(q[2], q[3]);
+    AES_SWAP2(q[4], q[5]);
+    AES_SWAP2(q[6], q[7]);
+
+    AES_SWAP4(q[0], q[2]);
+    AES_SWAP4(q[1], q[3]);
+    AES_SWAP4(q[4], q[6]);
+    AES_SWAP4(q[5], q[7]);
+
+    AES_SWAP8(q[0], q[4]);
+    AES_SWAP8(q[1], q[5]);
+    AES_SWAP8(q[2], q[6]);
+    AES_SWAP8(q[3], q[7]);
+}
+
+static void aes_sbox(uint32_t* q)
+{
+    uint32_t x0, x1, x2, x3, x4, x5, x6, x7;
+    uint32_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    uint32_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    uint32_t y20, y21;
+    uint32_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    uint32_t z10, z11, z12, z13, z14, z15, z16, z17;
+    uint32_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    uint32_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    uint32_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    uint32_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    uint32_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    uint32_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    uint32_t t60, t61, t62, t63, t64, t65, t66, t67;
+    uint32_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    //top linear transformation
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    //non-linear section
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    //bottom linear transformation
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+//inverse of S-box affine transform, with 0x63 constant
+static void aes_inv_affine(uint32_t* q)
+{
+    uint32_t q0, q1, q2, q3, q4, q5, q6, q7;
+    q0 = ~q[0];
+    q1 = ~q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = ~q[5];
+    q6 = ~q[6];
+    q7 = q[7];
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+//S(x) = A(I(x)) ^ 0x63, so InvS(x) = B(S(B(x ^ 0x63)) ^ 0x63), where B is inverse of A
+static void aes_inv_sbox(uint32_t* q)
+{
+    aes_inv_affine(q);
+    aes_sbox(q);
+    aes_inv_affine(q);
+}
+
+static inline void aes_add_round_key(uint32_t* q, const uint32_t* sk)
+{
+    int i;
+    for (i = 0; i < 8; ++i)
+        q[i] ^= sk[i];
+}
+
+static void aes_shift_rows(uint32_t* q)
+{
+    int i;
+    uint32_t x;
+    for (i = 0; i < 8; ++i)
+    {
+        x = q[i];
+        q[i] = (x & 0x000000ff) | ((x & 0x0000fc00) >> 2) | ((x & 0x00000300) << 6) | ((x & 0x00f00000) >> 4) |
+               ((x & 0x000f0000) << 4) | ((x & 0xc0000000) >> 6) | ((x & 0x3f000000) << 2);
+    }
+}
+
+static void aes_inv_shift_rows(uint32_t* q)
+{
+    int i;
+    uint32_t x;
+    for (i = 0; i < 8; ++i)
+    {
+        x = q[i];
+        q[i] = (x & 0x000000ff) | ((x & 0x00003f00) << 2) | ((x & 0x0000c000) >> 6) | ((x & 0x000f0000) << 4) |
+               ((x & 0x00f00000) >> 4) | ((x & 0x03000000) << 6) | ((x & 0xfc000000) >> 2);
+    }
+}
+
+static void aes_mix_columns(uint32_t* q)
+{
+    uint32_t q0, q1, q2, q3, q4, q5, q6, q7;
+    uint32_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = (q0 >> 8) | (q0 << 24);
+    r1 = (q1 >> 8) | (q1 << 24);
+    r2 = (q2 >> 8) | (q2 << 24);
+    r3 = (q3 >> 8) | (q3 << 24);
+    r4 = (q4 >> 8) | (q4 << 24);
+    r5 = (q5 >> 8) | (q5 << 24);
+    r6 = (q6 >> 8) | (q6 << 24);
+    r7 = (q7 >> 8) | (q7 << 24);
+
+    q[0] = q7 ^ r7 ^ r0 ^ aes_rotr16(q0 ^ r0);
+    q[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ aes_rotr16(q1 ^ r1);
+    q[2] = q1 ^ r1 ^ r2 ^ aes_rotr16(q2 ^ r2);
+    q[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ aes_rotr16(q3 ^ r3);
+    q[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ aes_rotr16(q4 ^ r4);
+    q[5] = q4 ^ r4 ^ r5 ^ aes_rotr16(q5 ^ r5);
+    q[6] = q5 ^ r5 ^ r6 ^ aes_rotr16(q6 ^ r6);
+    q[7] = q6 ^ r6 ^ r7 ^ aes_rotr16(q7 ^ r7);
+}
+
+static void aes_inv_mix_columns(uint32_t* q)
+{
+    uint32_t q0, q1, q2, q3, q4, q5, q6, q7;
+    uint32_t r0, r1, r2, r3, r4, r5, r6, r7;
+
+    q0 = q[0];
+    q1 = q[1];
+    q2 = q[2];
+    q3 = q[3];
+    q4 = q[4];
+    q5 = q[5];
+    q6 = q[6];
+    q7 = q[7];
+    r0 = (q0 >> 8) | (q0 << 24);
+    r1 = (q1 >> 8) | (q1 << 24);
+    r2 = (q2 >> 8) | (q2 << 24);
+    r3 = (q3 >> 8) | (q3 << 24);
+    r4 = (q4 >> 8) | (q4 << 24);
+    r5 = (q5 >> 8) | (q5 << 24);
+    r6 = (q6 >> 8) | (q6 << 24);
+    r7 = (q7 >> 8) | (q7 << 24);
+
+    q[0] = q5 ^ q6 ^ q7 ^ r0 ^ r5 ^ r7 ^ aes_rotr16(q0 ^ q5 ^ q6 ^ r0 ^ r5);
+    q[1] = q0 ^ q5 ^ r0 ^ r1 ^ r5 ^ r6 ^ r7 ^ aes_rotr16(q1 ^ q5 ^ q7 ^ r1 ^ r5 ^ r6);
+    q[2] = q0 ^ q1 ^ q6 ^ r1 ^ r2 ^ r6 ^ r7 ^ aes_rotr16(q0 ^ q2 ^ q6 ^ r2 ^ r6 ^ r7);
+    q[3] = q0 ^ q1 ^ q2 ^ q5 ^ q6 ^ r0 ^ r2 ^ r3 ^ r5 ^ aes_rotr16(q0 ^ q1 ^ q3 ^ q5 ^ q6 ^ q7 ^ r0 ^ r3 ^ r5 ^ r7);
+    q[4] = q1 ^ q2 ^ q3 ^ q5 ^ r1 ^ r3 ^ r4 ^ r5 ^ r6 ^ r7 ^ aes_rotr16(q1 ^ q2 ^ q4 ^ q5 ^ q7 ^ r1 ^ r4 ^ r5 ^ r6);
+    q[5] = q2 ^ q3 ^ q4 ^ q6 ^ r2 ^ r4 ^ r5 ^ r6 ^ r7 ^ aes_rotr16(q2 ^ q3 ^ q5 ^ q6 ^ r2 ^ r5 ^ r6 ^ r7);
+    q[6] = q3 ^ q4 ^ q5 ^ q7 ^ r3 ^ r5 ^ r6 ^ r7 ^ aes_rotr16(q3 ^ q4 ^ q6 ^ q7 ^ r3 ^ r6 ^ r7);
+    q[7] = q4 ^ q5 ^ q6 ^ r4 ^ r6 ^ r7 ^ aes_rotr16(q4 ^ q5 ^ q7 ^ r4 ^ r7);
+}
+
+static uint32_t aes_sub_word(uint32_t x)
+{
+    uint32_t q[8];
+    memset(q, 0x00, sizeof(q));
+    q[0] = x;
+    aes_ortho(q);
+    aes_sbox(q);
+    aes_ortho(q);
+    return q[0];
+}
+
+static void aes_load(uint32_t* q, const unsigned char* in0, const unsigned char* in1)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+    {
+        q[(i << 1) + 0] = aes_dec32le(in0 + (i << 2));
+        q[(i << 1) + 1] = aes_dec32le(in1 + (i << 2));
+    }
+    aes_ortho(q);
+}
+
+static void aes_store(uint32_t* q, unsigned char* out0, unsigned char* out1)
+{
+    int i;
+    aes_ortho(q);
+    for (i = 0; i < 4; ++i)
+    {
+        aes_enc32le(out0 + (i << 2), q[(i << 1) + 0]);
+        if (out1 != NULL)
+            aes_enc32le(out1 + (i << 2), q[(i << 1) + 1]);
+    }
+}
+
+static void aes_bitslice_encrypt(int rounds, const uint32_t* sk, uint32_t* q)
+{
+    int r;
+    aes_add_round_key(q, sk);
+    for (r = 1; r < rounds; ++r)
+    {
+        aes_sbox(q);
+        aes_shift_rows(q);
+        aes_mix_columns(q);
+        aes_add_round_key(q, sk + (r << 3));
+    }
+    aes_sbox(q);
+    aes_shift_rows(q);
+    aes_add_round_key(q, sk + (rounds << 3));
+}
+
+static void aes_bitslice_decrypt(int rounds, const uint32_t* sk, uint32_t* q)
+{
+    int r;
+    aes_add_round_key(q, sk + (rounds << 3));
+    for (r = rounds - 1; r > 0; --r)
+    {
+        aes_inv_shift_rows(q);
+        aes_inv_sbox(q);
+        aes_add_round_key(q, sk + (r << 3));
+        aes_inv_mix_columns(q);
+    }
+    aes_inv_shift_rows(q);
+    aes_inv_sbox(q);
+    aes_add_round_key(q, sk);
+}
+
+/**
+ * Expand the cipher key into the encryption key schedule.
+ */
+int AES_set_encrypt_key(const unsigned char *userKey, const int bits,
+                        AES_KEY *key)
+{
+    int i, j, k, nk, nkf;
+    uint32_t tmp, x;
+    uint32_t w[4 * (AES_MAXNR + 1)];
+    uint32_t q[8];
+
+    if (!userKey || !key)
+        return -1;
+    if (bits != 128 && bits != 192 && bits != 256)
+        return -2;
+    nk = bits >> 5;
+    key->rounds = nk + 6;
+    nkf = (key->rounds + 1) << 2;
+
+    //regular key schedule, little endian words
+    for (i = 0; i < nk; ++i)
+        w[i] = aes_dec32le(userKey + (i << 2));
+    tmp = w[nk - 1];
+    for (i = nk, j = 0, k = 0; i < nkf; ++i)
+    {
+        if (j == 0)
+        {
+            tmp = (tmp << 24) | (tmp >> 8);
+            tmp = aes_sub_word(tmp) ^ __AES_RCON[k];
+        }
+        else if ((nk > 6) && (j == 4))
+            tmp = aes_sub_word(tmp);
+        tmp ^= w[i - nk];
+        w[i] = tmp;
+        if (++j == nk)
+        {
+            j = 0;
+            ++k;
+        }
+    }
+
+    //bitslice each round key. Same for both blocks, so odd and even bits are equal
+    for (i = 0; i < nkf; i += 4)
+    {
+        for (j = 0; j < 4; ++j)
+            q[(j << 1) + 0] = q[(j << 1) + 1] = w[i + j];
+        aes_ortho(q);
+        for (j = 0; j < 4; ++j)
+        {
+            x = q[(j << 1) + 0] & 0x55555555;
+            key->rd_key[((i + j) << 1) + 0] = x | (x << 1);
+            x = q[(j << 1) + 1] & 0xaaaaaaaa;
+            key->rd_key[((i + j) << 1) + 1] = x | (x >> 1);
+        }
+    }
+    memset(w, 0x00, sizeof(w));
+    memset(q, 0x00, sizeof(q));
+    return 0;
+}
+
+/**
+ * Expand the cipher key into the decryption key schedule.
+ * Straight inverse cipher is using same schedule in reverse order
+ */
+int AES_set_decrypt_key(const unsigned char *userKey, const int bits,
+                        AES_KEY *key)
+{
+    return AES_set_encrypt_key(userKey, bits, key);
+}
+
+/*
+ * Encrypt a single block
+ * in and out can overlap
+ */
+void AES_encrypt(const unsigned char *in, unsigned char *out,
+                 const AES_KEY *key)
+{
+    uint32_t q[8];
+    aes_load(q, in, in);
+    aes_bitslice_encrypt(key->rounds, (const uint32_t*)key->rd_key, q);
+    aes_store(q, out, NULL);
+}
+
+/*
+ * Decrypt a single block
+ * in and out can overlap
+ */
+void AES_decrypt(const unsigned char *in, unsigned char *out,
+                 const AES_KEY *key)
+{
+    uint32_t q[8];
+    aes_load(q, in, in);
+    aes_bitslice_decrypt(key->rounds, (const uint32_t*)key->rd_key, q);
+    aes_store(q, out, NULL);
+}
+
+//replaces generic aes_cbc.c. Decryption is processing 2 blocks in parallel
+void AES_cbc_encrypt(const unsigned char *in, unsigned char *out,
+                     size_t len, const AES_KEY *key,
+                     unsigned char *ivec, const int enc)
+{
+    const uint32_t* sk = (const uint32_t*)key->rd_key;
+    uint32_t q[8];
+    uint8_t buf[AES_BLOCK_SIZE << 1];
+    size_t i, size;
+
+    while (len)
+    {
+        //partial last block is padded with IV, as in CRYPTO_cbc128
+        if (enc)
+        {
+            //CBC encryption is sequential, only one block of two is used
+            size = len < AES_BLOCK_SIZE ? len : AES_BLOCK_SIZE;
+            for (i = 0; i < AES_BLOCK_SIZE; ++i)
+                buf[i] = (i < size ? in[i] : 0) ^ ivec[i];
+            aes_load(q, buf, buf);
+            aes_bitslice_encrypt(key->rounds, sk, q);
+            aes_store(q, ivec, NULL);
+            memcpy(out, ivec, AES_BLOCK_SIZE);
+        }
+        else
+        {
+            size = len < (AES_BLOCK_SIZE << 1) ? AES_BLOCK_SIZE : (AES_BLOCK_SIZE << 1);
+            //keep ciphertext, in and out can overlap
+            memcpy(buf, in, size);
+            aes_load(q, buf, buf + size - AES_BLOCK_SIZE);
+            aes_bitslice_decrypt(key->rounds, sk, q);
+            aes_store(q, out, size > AES_BLOCK_SIZE ? out + AES_BLOCK_SIZE : NULL);
+            for (i = 0; i < AES_BLOCK_SIZE; ++i)
+                out[i] ^= ivec[i];
+            for (i = AES_BLOCK_SIZE; i < size; ++i)
+                out[i] ^= buf[i - AES_BLOCK_SIZE];
+            memcpy(ivec, buf + size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+            if (len < size)
+                size = len;
+        }
+        len -= size;
+        in += size;
+        out += size;
+    }
+    memset(q, 0x00, sizeof(q));
+}
+
+#endif //AES_IMPLEMENTATION_BITSLICED
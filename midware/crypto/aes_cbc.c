@@ -51,9 +51,13 @@
 
 //Note: Minor interface modifications to support RExOS
 
+#include "sys_config.h"
 #include "aes.h"
 #include "openssl.h"
 
+//bitsliced backend has own CBC with parallel decryption
+#if (AES_IMPLEMENTATION != AES_IMPLEMENTATION_BITSLICED)
+
 void AES_cbc_encrypt(const unsigned char *in, unsigned char *out,
                      size_t len, const AES_KEY *key,
                      unsigned char *ivec, const int enc)
@@ -66,3 +70,5 @@ void AES_cbc_encrypt(const unsigned char *in, unsigned char *out,
         CRYPTO_cbc128_decrypt(in, out, len, key, ivec,
                               (block128_f) AES_decrypt);
 }
+
+#endif //AES_IMPLEMENTATION_BITSLICED
@@ -0,0 +1,270 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//Byte oriented AES (FIPS-197). 512 bytes of tables instead of 8KB T-tables, no data dependent branches
+
+#include "sys_config.h"
+#include "aes.h"
+#include <stdint.h>
+
+#if (AES_IMPLEMENTATION == AES_IMPLEMENTATION_COMPACT)
+
+static const uint8_t __AES_SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static const uint8_t __AES_INV_SBOX[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+    0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+    0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+    0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+    0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+    0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+    0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+    0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+    0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+    0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+    0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+};
+
+static inline uint8_t aes_xtime(uint8_t x)
+{
+    return (uint8_t)((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+static void aes_add_round_key(uint8_t* state, const uint8_t* rk)
+{
+    int i;
+    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+        state[i] ^= rk[i];
+}
+
+//state is column-major, as in FIPS-197: byte i is row (i & 3), column (i >> 2)
+static void aes_sub_bytes_shift_rows(uint8_t* state)
+{
+    uint8_t tmp;
+    state[0] = __AES_SBOX[state[0]];
+    state[4] = __AES_SBOX[state[4]];
+    state[8] = __AES_SBOX[state[8]];
+    state[12] = __AES_SBOX[state[12]];
+    //row 1: left by 1
+    tmp = state[1];
+    state[1] = __AES_SBOX[state[5]];
+    state[5] = __AES_SBOX[state[9]];
+    state[9] = __AES_SBOX[state[13]];
+    state[13] = __AES_SBOX[tmp];
+    //row 2: left by 2
+    tmp = state[2];
+    state[2] = __AES_SBOX[state[10]];
+    state[10] = __AES_SBOX[tmp];
+    tmp = state[6];
+    state[6] = __AES_SBOX[state[14]];
+    state[14] = __AES_SBOX[tmp];
+    //row 3: left by 3
+    tmp = state[15];
+    state[15] = __AES_SBOX[state[11]];
+    state[11] = __AES_SBOX[state[7]];
+    state[7] = __AES_SBOX[state[3]];
+    state[3] = __AES_SBOX[tmp];
+}
+
+static void aes_inv_sub_bytes_shift_rows(uint8_t* state)
+{
+    uint8_t tmp;
+    state[0] = __AES_INV_SBOX[state[0]];
+    state[4] = __AES_INV_SBOX[state[4]];
+    state[8] = __AES_INV_SBOX[state[8]];
+    state[12] = __AES_INV_SBOX[state[12]];
+    //row 1: right by 1
+    tmp = state[13];
+    state[13] = __AES_INV_SBOX[state[9]];
+    state[9] = __AES_INV_SBOX[state[5]];
+    state[5] = __AES_INV_SBOX[state[1]];
+    state[1] = __AES_INV_SBOX[tmp];
+    //row 2: right by 2
+    tmp = state[2];
+    state[2] = __AES_INV_SBOX[state[10]];
+    state[10] = __AES_INV_SBOX[tmp];
+    tmp = state[6];
+    state[6] = __AES_INV_SBOX[state[14]];
+    state[14] = __AES_INV_SBOX[tmp];
+    //row 3: right by 3
+    tmp = state[3];
+    state[3] = __AES_INV_SBOX[state[7]];
+    state[7] = __AES_INV_SBOX[state[11]];
+    state[11] = __AES_INV_SBOX[state[15]];
+    state[15] = __AES_INV_SBOX[tmp];
+}
+
+static void aes_mix_columns(uint8_t* state)
+{
+    int i;
+    uint8_t a0, a1, a2, a3, all;
+    for (i = 0; i < AES_BLOCK_SIZE; i += 4)
+    {
+        a0 = state[i];
+        a1 = state[i + 1];
+        a2 = state[i + 2];
+        a3 = state[i + 3];
+        all = a0 ^ a1 ^ a2 ^ a3;
+        state[i] ^= all ^ aes_xtime(a0 ^ a1);
+        state[i + 1] ^= all ^ aes_xtime(a1 ^ a2);
+        state[i + 2] ^= all ^ aes_xtime(a2 ^ a3);
+        state[i + 3] ^= all ^ aes_xtime(a3 ^ a0);
+    }
+}
+
+static void aes_inv_mix_columns(uint8_t* state)
+{
+    int i;
+    uint8_t u, v;
+    //InvMixColumns = MixColumns * {04}x^2 + {05}
+    for (i = 0; i < AES_BLOCK_SIZE; i += 4)
+    {
+        u = aes_xtime(aes_xtime(state[i] ^ state[i + 2]));
+        v = aes_xtime(aes_xtime(state[i + 1] ^ state[i + 3]));
+        state[i] ^= u;
+        state[i + 1] ^= v;
+        state[i + 2] ^= u;
+        state[i + 3] ^= v;
+    }
+    aes_mix_columns(state);
+}
+
+/**
+ * Expand the cipher key into the encryption key schedule.
+ */
+int AES_set_encrypt_key(const unsigned char *userKey, const int bits,
+                        AES_KEY *key)
+{
+    int i, nk, total;
+    uint8_t rcon, tmp;
+    uint8_t w[4];
+    uint8_t* rk;
+
+    if (!userKey || !key)
+        return -1;
+    if (bits != 128 && bits != 192 && bits != 256)
+        return -2;
+    nk = bits >> 5;
+    key->rounds = nk + 6;
+    total = (key->rounds + 1) << 4;
+    rk = (uint8_t*)key->rd_key;
+
+    for (i = 0; i < (nk << 2); ++i)
+        rk[i] = userKey[i];
+    rcon = 0x01;
+    for (i = nk << 2; i < total; i += 4)
+    {
+        w[0] = rk[i - 4];
+        w[1] = rk[i - 3];
+        w[2] = rk[i - 2];
+        w[3] = rk[i - 1];
+        if ((i >> 2) % nk == 0)
+        {
+            //RotWord, SubWord, Rcon
+            tmp = w[0];
+            w[0] = __AES_SBOX[w[1]] ^ rcon;
+            w[1] = __AES_SBOX[w[2]];
+            w[2] = __AES_SBOX[w[3]];
+            w[3] = __AES_SBOX[tmp];
+            rcon = aes_xtime(rcon);
+        }
+        else if ((nk > 6) && ((i >> 2) % nk == 4))
+        {
+            w[0] = __AES_SBOX[w[0]];
+            w[1] = __AES_SBOX[w[1]];
+            w[2] = __AES_SBOX[w[2]];
+            w[3] = __AES_SBOX[w[3]];
+        }
+        rk[i] = rk[i - (nk << 2)] ^ w[0];
+        rk[i + 1] = rk[i + 1 - (nk << 2)] ^ w[1];
+        rk[i + 2] = rk[i + 2 - (nk << 2)] ^ w[2];
+        rk[i + 3] = rk[i + 3 - (nk << 2)] ^ w[3];
+    }
+    return 0;
+}
+
+/**
+ * Expand the cipher key into the decryption key schedule.
+ * Straight inverse cipher is using same schedule in reverse order
+ */
+int AES_set_decrypt_key(const unsigned char *userKey, const int bits,
+                        AES_KEY *key)
+{
+    return AES_set_encrypt_key(userKey, bits, key);
+}
+
+/*
+ * Encrypt a single block
+ * in and out can overlap
+ */
+void AES_encrypt(const unsigned char *in, unsigned char *out,
+                 const AES_KEY *key)
+{
+    int i, r;
+    uint8_t state[AES_BLOCK_SIZE];
+    const uint8_t* rk = (const uint8_t*)key->rd_key;
+
+    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+        state[i] = in[i] ^ rk[i];
+    for (r = 1; r < key->rounds; ++r)
+    {
+        aes_sub_bytes_shift_rows(state);
+        aes_mix_columns(state);
+        aes_add_round_key(state, rk + (r << 4));
+    }
+    aes_sub_bytes_shift_rows(state);
+    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+        out[i] = state[i] ^ rk[(r << 4) + i];
+}
+
+/*
+ * Decrypt a single block
+ * in and out can overlap
+ */
+void AES_decrypt(const unsigned char *in, unsigned char *out,
+                 const AES_KEY *key)
+{
+    int i, r;
+    uint8_t state[AES_BLOCK_SIZE];
+    const uint8_t* rk = (const uint8_t*)key->rd_key;
+
+    r = key->rounds;
+    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+        state[i] = in[i] ^ rk[(r << 4) + i];
+    for (--r; r > 0; --r)
+    {
+        aes_inv_sub_bytes_shift_rows(state);
+        aes_add_round_key(state, rk + (r << 4));
+        aes_inv_mix_columns(state);
+    }
+    aes_inv_sub_bytes_shift_rows(state);
+    for (i = 0; i < AES_BLOCK_SIZE; ++i)
+        out[i] = state[i] ^ rk[i];
+}
+
+#endif //AES_IMPLEMENTATION_COMPACT
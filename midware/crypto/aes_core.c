@@ -30,9 +30,12 @@
 
 //Note: Minor interface modifications to support RExOS
 
+#include "sys_config.h"
 #include "openssl.h"
 #include "aes.h"
 
+#if (AES_IMPLEMENTATION == AES_IMPLEMENTATION_TTABLE)
+
 /*-
 Te0[x] = S [x].[02, 01, 01, 03];
 Te1[x] = S [x].[03, 02, 01, 01];
@@ -1000,3 +1003,4 @@ void AES_decrypt(const unsigned char *in, unsigned char *out,
     PUTU32(out + 12, s3);
 }
 
+#endif //AES_IMPLEMENTATION_TTABLE
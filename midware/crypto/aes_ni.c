@@ -0,0 +1,114 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//AES-NI backend for POSIX host core (x86). Round keys are stored as 128 bit blocks in AES_KEY
+
+#include "sys_config.h"
+#include "aes.h"
+
+#if (AES_IMPLEMENTATION == AES_IMPLEMENTATION_AESNI)
+
+#include <stdint.h>
+#include <string.h>
+#include <wmmintrin.h>
+
+#define AES_NI                              __attribute__((target("aes,sse2")))
+
+static const uint8_t __AES_RCON[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+
+static AES_NI uint32_t aes_sub_word(uint32_t x)
+{
+    //AESKEYGENASSIST lane 0 is SubWord(X1)
+    return (uint32_t)_mm_cvtsi128_si32(_mm_aeskeygenassist_si128(_mm_set_epi32(0, 0, (int)x, 0), 0));
+}
+
+/**
+ * Expand the cipher key into the encryption key schedule.
+ */
+int AES_NI AES_set_encrypt_key(const unsigned char *userKey, const int bits,
+                               AES_KEY *key)
+{
+    int i, nk, nkf;
+    uint32_t tmp;
+    uint32_t* w;
+
+    if (!userKey || !key)
+        return -1;
+    if (bits != 128 && bits != 192 && bits != 256)
+        return -2;
+    nk = bits >> 5;
+    key->rounds = nk + 6;
+    nkf = (key->rounds + 1) << 2;
+    //little endian words, same byte order, as in block
+    w = key->rd_key;
+    memcpy(w, userKey, nk << 2);
+    for (i = nk; i < nkf; ++i)
+    {
+        tmp = w[i - 1];
+        if (i % nk == 0)
+            tmp = aes_sub_word((tmp >> 8) | (tmp << 24)) ^ __AES_RCON[i / nk - 1];
+        else if ((nk > 6) && (i % nk == 4))
+            tmp = aes_sub_word(tmp);
+        w[i] = w[i - nk] ^ tmp;
+    }
+    return 0;
+}
+
+/**
+ * Expand the cipher key into the decryption key schedule.
+ * Equivalent inverse cipher: reversed order, InvMixColumns applied to middle round keys
+ */
+int AES_NI AES_set_decrypt_key(const unsigned char *userKey, const int bits,
+                               AES_KEY *key)
+{
+    int i, res;
+    __m128i* rk = (__m128i*)key->rd_key;
+    __m128i tmp;
+    res = AES_set_encrypt_key(userKey, bits, key);
+    if (res < 0)
+        return res;
+    for (i = 0; i < key->rounds >> 1; ++i)
+    {
+        tmp = _mm_loadu_si128(rk + i);
+        _mm_storeu_si128(rk + i, _mm_loadu_si128(rk + key->rounds - i));
+        _mm_storeu_si128(rk + key->rounds - i, tmp);
+    }
+    for (i = 1; i < key->rounds; ++i)
+        _mm_storeu_si128(rk + i, _mm_aesimc_si128(_mm_loadu_si128(rk + i)));
+    return 0;
+}
+
+/*
+ * Encrypt a single block
+ * in and out can overlap
+ */
+void AES_NI AES_encrypt(const unsigned char *in, unsigned char *out,
+                        const AES_KEY *key)
+{
+    int r;
+    const __m128i* rk = (const __m128i*)key->rd_key;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(rk));
+    for (r = 1; r < key->rounds; ++r)
+        s = _mm_aesenc_si128(s, _mm_loadu_si128(rk + r));
+    _mm_storeu_si128((__m128i*)out, _mm_aesenclast_si128(s, _mm_loadu_si128(rk + r)));
+}
+
+/*
+ * Decrypt a single block
+ * in and out can overlap
+ */
+void AES_NI AES_decrypt(const unsigned char *in, unsigned char *out,
+                        const AES_KEY *key)
+{
+    int r;
+    const __m128i* rk = (const __m128i*)key->rd_key;
+    __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128(rk));
+    for (r = 1; r < key->rounds; ++r)
+        s = _mm_aesdec_si128(s, _mm_loadu_si128(rk + r));
+    _mm_storeu_si128((__m128i*)out, _mm_aesdeclast_si128(s, _mm_loadu_si128(rk + r)));
+}
+
+#endif //AES_IMPLEMENTATION_AESNI
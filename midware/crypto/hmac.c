@@ -13,28 +13,36 @@
 void hmac_setup(HMAC_CTX* ctx, const HMAC_HASH_STRUCT* hash_struct, void* hash_ctx, const void* key, unsigned int key_size)
 {
     int i;
-    memset(ctx->ipad, 0x00, HMAC64_BLOCK_SIZE);
+    uint32_t pad[HMAC64_ROUNDS];
+    memset(pad, 0x00, HMAC64_BLOCK_SIZE);
     ctx->hash_struct = hash_struct;
     ctx->hash_ctx = hash_ctx;
     if (key_size <= HMAC64_BLOCK_SIZE)
-        memcpy(ctx->ipad, key, key_size);
+        memcpy(pad, key, key_size);
     else
     {
         ctx->hash_struct->hash_init(ctx->hash_ctx);
         ctx->hash_struct->hash_update(ctx->hash_ctx, key, key_size);
-        ctx->hash_struct->hash_final(ctx->hash_ctx, ctx->ipad);
+        ctx->hash_struct->hash_final(ctx->hash_ctx, pad);
     }
     for (i = 0; i < HMAC64_ROUNDS; ++i)
-    {
-        ctx->opad[i] = ctx->ipad[i] ^ OPAD;
-        ctx->ipad[i] ^= IPAD;
-    }
+        pad[i] ^= IPAD;
+    ctx->hash_struct->hash_init(ctx->hash_ctx);
+    ctx->hash_struct->hash_update(ctx->hash_ctx, pad, HMAC64_BLOCK_SIZE);
+    ctx->hash_struct->hash_save(ctx->hash_ctx, ctx->istate);
+
+    for (i = 0; i < HMAC64_ROUNDS; ++i)
+        pad[i] ^= IPAD ^ OPAD;
+    ctx->hash_struct->hash_init(ctx->hash_ctx);
+    ctx->hash_struct->hash_update(ctx->hash_ctx, pad, HMAC64_BLOCK_SIZE);
+    ctx->hash_struct->hash_save(ctx->hash_ctx, ctx->ostate);
+    //key is not stored
+    memset(pad, 0x00, HMAC64_BLOCK_SIZE);
 }
 
 void hmac_init(HMAC_CTX* ctx)
 {
-    ctx->hash_struct->hash_init(ctx->hash_ctx);
-    ctx->hash_struct->hash_update(ctx->hash_ctx, ctx->ipad, HMAC64_BLOCK_SIZE);
+    ctx->hash_struct->hash_restore(ctx->hash_ctx, ctx->istate, HMAC64_BLOCK_SIZE);
 }
 
 void hmac_update(HMAC_CTX* ctx, const void* data, unsigned int size)
@@ -47,8 +55,7 @@ void hmac_final(HMAC_CTX* ctx, void* hmac)
     //hmac here used as temporal storage to save stack space
     ctx->hash_struct->hash_final(ctx->hash_ctx, hmac);
 
-    ctx->hash_struct->hash_init(ctx->hash_ctx);
-    ctx->hash_struct->hash_update(ctx->hash_ctx, ctx->opad, HMAC64_BLOCK_SIZE);
+    ctx->hash_struct->hash_restore(ctx->hash_ctx, ctx->ostate, HMAC64_BLOCK_SIZE);
     ctx->hash_struct->hash_update(ctx->hash_ctx, hmac, ctx->hash_struct->digest_size);
     ctx->hash_struct->hash_final(ctx->hash_ctx, hmac);
 }
@@ -13,23 +13,30 @@
 #define HMAC64_ROUNDS                                  (64 >> 2)
 #define HMAC128_BLOCK_SIZE                             128
 #define HMAC128_ROUNDS                                 (128 >> 2)
+//intermediate hash state. Up to SHA256
+#define HMAC_STATE_ROUNDS                              8
 
 typedef void (*HASH_INIT)(void*);
 typedef void (*HASH_UPDATE)(void*, const void*, unsigned int);
 typedef void (*HASH_FINAL)(void*, void*);
+typedef void (*HASH_SAVE)(void*, void*);
+typedef void (*HASH_RESTORE)(void*, const void*, unsigned int);
 
 typedef struct {
     HASH_INIT hash_init;
     HASH_UPDATE hash_update;
     HASH_FINAL hash_final;
+    HASH_SAVE hash_save;
+    HASH_RESTORE hash_restore;
     unsigned short digest_size;
 } HMAC_HASH_STRUCT;
 
 typedef struct {
     void* hash_ctx;
     const HMAC_HASH_STRUCT* hash_struct;
-    uint32_t ipad[HMAC64_ROUNDS];
-    uint32_t opad[HMAC64_ROUNDS];
+    //hash state after ipad/opad block. Precomputed once per key
+    uint32_t istate[HMAC_STATE_ROUNDS];
+    uint32_t ostate[HMAC_STATE_ROUNDS];
     //doesn't storing key itself for memory saving
 } HMAC_CTX;
 
@@ -13,7 +13,8 @@
 #include "sha1.h"
 #include <string.h>
 
-const HMAC_HASH_STRUCT __HMAC_SHA1  = { (HASH_INIT)sha1_init, (HASH_UPDATE)sha1_update, (HASH_FINAL)sha1_final, 20};
+const HMAC_HASH_STRUCT __HMAC_SHA1  = { (HASH_INIT)sha1_init, (HASH_UPDATE)sha1_update, (HASH_FINAL)sha1_final,
+                                       (HASH_SAVE)sha1_save, (HASH_RESTORE)sha1_restore, 20};
 
 
 /****************************** MACROS ******************************/
@@ -149,3 +150,17 @@ void sha1_final(SHA1_CTX *ctx, BYTE hash[])
         hash[i + 16] = (ctx->state[4] >> (24 - i * 8)) & 0x000000ff;
     }
 }
+
+// Save intermediate state. Only valid on block boundary, when no data is buffered.
+void sha1_save(SHA1_CTX *ctx, WORD state[])
+{
+    memcpy(state, ctx->state, sizeof(ctx->state));
+}
+
+// Restore state, saved after len bytes of data was hashed.
+void sha1_restore(SHA1_CTX *ctx, const WORD state[], size_t len)
+{
+    sha1_init(ctx);
+    memcpy(ctx->state, state, sizeof(ctx->state));
+    ctx->bitlen = (unsigned long long)len * 8;
+}
@@ -34,5 +34,7 @@ extern const HMAC_HASH_STRUCT __HMAC_SHA1;
 void sha1_init(SHA1_CTX *ctx);
 void sha1_update(SHA1_CTX *ctx, const BYTE data[], size_t len);
 void sha1_final(SHA1_CTX *ctx, BYTE hash[]);
+void sha1_save(SHA1_CTX *ctx, WORD state[]);
+void sha1_restore(SHA1_CTX *ctx, const WORD state[], size_t len);
 
 #endif   // SHA1_H
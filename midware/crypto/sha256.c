@@ -28,7 +28,8 @@
 #define SIG1(x) (ROTRIGHT(x,17) ^ ROTRIGHT(x,19) ^ ((x) >> 10))
 
 /**************************** VARIABLES *****************************/
-const HMAC_HASH_STRUCT __HMAC_SHA256  = { (HASH_INIT)sha256_init, (HASH_UPDATE)sha256_update, (HASH_FINAL)sha256_final, 32};
+const HMAC_HASH_STRUCT __HMAC_SHA256  = { (HASH_INIT)sha256_init, (HASH_UPDATE)sha256_update, (HASH_FINAL)sha256_final,
+                                       (HASH_SAVE)sha256_save, (HASH_RESTORE)sha256_restore, 32};
 
 static const WORD k[64] = {
     0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
@@ -157,3 +158,17 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
         hash[i + 28] = (ctx->state[7] >> (24 - i * 8)) & 0x000000ff;
     }
 }
+
+// Save intermediate state. Only valid on block boundary, when no data is buffered.
+void sha256_save(SHA256_CTX *ctx, WORD state[])
+{
+    memcpy(state, ctx->state, sizeof(ctx->state));
+}
+
+// Restore state, saved after len bytes of data was hashed.
+void sha256_restore(SHA256_CTX *ctx, const WORD state[], size_t len)
+{
+    sha256_init(ctx);
+    memcpy(ctx->state, state, sizeof(ctx->state));
+    ctx->bitlen = (unsigned long long)len * 8;
+}
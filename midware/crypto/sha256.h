@@ -35,5 +35,7 @@ extern const HMAC_HASH_STRUCT __HMAC_SHA256;
 void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
+void sha256_save(SHA256_CTX *ctx, WORD state[]);
+void sha256_restore(SHA256_CTX *ctx, const WORD state[], size_t len);
 
 #endif   // SHA256_H
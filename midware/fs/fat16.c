@@ -9,6 +9,7 @@
 #include "../../userspace/error.h"
 #include "../../userspace/process.h"
 #include "../../userspace/stdio.h"
+#include "../../userspace/stdlib.h"
 #include "../../userspace/storage.h"
 #include "../../userspace/disk.h"
 #include "../../userspace/utf.h"
@@ -23,9 +24,20 @@ typedef struct {
     unsigned int first_cluster, current_cluster, cluster_num, pos;
 } FAT16_FILE_INFO;
 
+#if (VFS_FAT16_EXTENTS)
+typedef struct {
+    uint16_t cluster_num, cluster, count;
+} FAT16_EXTENT;
+#endif //VFS_FAT16_EXTENTS
+
 typedef struct {
     FAT16_FILE_INFO fi, data;
     unsigned int size, mode;
+#if (VFS_FAT16_EXTENTS)
+    //contiguous runs of cluster chain from file start, mapped while walking
+    FAT16_EXTENT extents[VFS_FAT16_EXTENTS];
+    unsigned int extents_count;
+#endif //VFS_FAT16_EXTENTS
 } FAT16_FILE_HANDLE_TYPE;
 
 typedef enum {
@@ -131,25 +143,129 @@ static unsigned long fat16_get_fat_next(VFSS_TYPE* vfss, unsigned long cluster)
     return next;
 }
 
+#if (VFS_FAT16_FREE_BITMAP)
+static inline void fat16_bitmap_set(VFSS_TYPE* vfss, unsigned long cluster, bool free)
+{
+    uint32_t mask = 1ul << (cluster & 31);
+    if (free)
+    {
+        vfss->fat16.free_bitmap[cluster >> 5] |= mask;
+        ++vfss->fat16.free_count;
+    }
+    else
+    {
+        vfss->fat16.free_bitmap[cluster >> 5] &= ~mask;
+        --vfss->fat16.free_count;
+    }
+}
+
+//first free cluster in [from, to)
+static unsigned long fat16_bitmap_find(VFSS_TYPE* vfss, unsigned long from, unsigned long to)
+{
+    unsigned long i;
+    uint32_t word;
+    if (from >= to)
+        return FAT_CLUSTER_RESERVED;
+    i = from >> 5;
+    //skip bits before from
+    word = vfss->fat16.free_bitmap[i] & (0xffffffff << (from & 31));
+    for (;;)
+    {
+        if (word)
+        {
+            from = (i << 5) + __builtin_ctz(word);
+            return from < to ? from : FAT_CLUSTER_RESERVED;
+        }
+        if ((++i << 5) >= to)
+            return FAT_CLUSTER_RESERVED;
+        word = vfss->fat16.free_bitmap[i];
+    }
+}
+
+static void fat16_bitmap_destroy(VFSS_TYPE* vfss)
+{
+    free(vfss->fat16.free_bitmap);
+    vfss->fat16.free_bitmap = NULL;
+}
+
+static void fat16_bitmap_create(VFSS_TYPE* vfss)
+{
+    unsigned long sector, sectors, chunk, cluster, i;
+    uint16_t* fat;
+    vfss->fat16.free_count = 0;
+    vfss->fat16.free_hint = 2;
+    vfss->fat16.free_bitmap = malloc(((vfss->fat16.clusters_count + 31) >> 5) * sizeof(uint32_t));
+    //not critical, fallback to FAT scan
+    if (vfss->fat16.free_bitmap == NULL)
+        return;
+    memset(vfss->fat16.free_bitmap, 0x00, ((vfss->fat16.clusters_count + 31) >> 5) * sizeof(uint32_t));
+    //read first FAT copy by cluster-sized chunks
+    sectors = (vfss->fat16.clusters_count + FAT_ENTRIES_IN_SECTOR - 1) / FAT_ENTRIES_IN_SECTOR;
+    for (sector = 0; sector < sectors; sector += chunk)
+    {
+        chunk = sectors - sector;
+        if (chunk > vfss->fat16.cluster_sectors)
+            chunk = vfss->fat16.cluster_sectors;
+        fat = vfss_read_sectors(vfss, vfss->fat16.reserved_sectors + sector, chunk * FAT_SECTOR_SIZE);
+        if (fat == NULL)
+        {
+            fat16_bitmap_destroy(vfss);
+            return;
+        }
+        for (i = 0, cluster = sector * FAT_ENTRIES_IN_SECTOR; i < chunk * FAT_ENTRIES_IN_SECTOR && cluster < vfss->fat16.clusters_count; ++i, ++cluster)
+        {
+            if (cluster >= 2 && fat[i] == FAT_CLUSTER_FREE)
+                fat16_bitmap_set(vfss, cluster, true);
+        }
+    }
+}
+#endif //VFS_FAT16_FREE_BITMAP
+
 static bool fat16_set_fat_value(VFSS_TYPE* vfss, unsigned long cluster, unsigned long value)
 {
     unsigned int i;
     uint16_t* fat;
+#if (VFS_FAT16_FREE_BITMAP)
+    bool was_free;
+#endif //VFS_FAT16_FREE_BITMAP
     fat = vfss_read_sectors(vfss, vfss->fat16.reserved_sectors + (cluster / FAT_ENTRIES_IN_SECTOR), FAT_SECTOR_SIZE);
     if (fat == NULL)
         return false;
+#if (VFS_FAT16_FREE_BITMAP)
+    was_free = fat[cluster % FAT_ENTRIES_IN_SECTOR] == FAT_CLUSTER_FREE;
+#endif //VFS_FAT16_FREE_BITMAP
     fat[cluster % FAT_ENTRIES_IN_SECTOR] = value;
     for (i = 0; i < vfss->fat16.fat_count; ++i)
     {
         if (!vfss_write_sectors(vfss, vfss->fat16.reserved_sectors + vfss->fat16.fat_sectors * i + (cluster / FAT_ENTRIES_IN_SECTOR), FAT_SECTOR_SIZE))
             return false;
     }
+#if (VFS_FAT16_FREE_BITMAP)
+    if ((vfss->fat16.free_bitmap != NULL) && (was_free != (value == FAT_CLUSTER_FREE)))
+        fat16_bitmap_set(vfss, cluster, !was_free);
+#endif //VFS_FAT16_FREE_BITMAP
     return true;
 }
 
 static unsigned long fat16_find_free_cluster(VFSS_TYPE* vfss, unsigned long cluster)
 {
     unsigned long next_free;
+#if (VFS_FAT16_FREE_BITMAP)
+    if (vfss->fat16.free_bitmap != NULL)
+    {
+        //after current till last, keeping chain contiguous if possible
+        next_free = fat16_bitmap_find(vfss, cluster + 1, vfss->fat16.clusters_count);
+        //from first till current -1
+        if (next_free >= FAT_CLUSTER_RESERVED)
+            next_free = fat16_bitmap_find(vfss, 2, cluster);
+        if (next_free < FAT_CLUSTER_RESERVED)
+            return next_free;
+#if (VFS_DEBUG_ERRORS)
+        printf("FAT16 warning: No free space\n");
+#endif //VFS_DEBUG_ERRORS
+        return FAT_CLUSTER_RESERVED;
+    }
+#endif //VFS_FAT16_FREE_BITMAP
     //after current till last
     for (next_free = cluster + 1; next_free < vfss->fat16.clusters_count;  ++next_free)
         if (fat16_get_fat_value(vfss, next_free) == FAT_CLUSTER_FREE)
@@ -166,11 +282,19 @@ static unsigned long fat16_find_free_cluster(VFSS_TYPE* vfss, unsigned long clus
 
 static unsigned long fat16_occupy_first_cluster(VFSS_TYPE* vfss)
 {
+#if (VFS_FAT16_FREE_BITMAP)
+    //next fit: new files are placed after last allocation, leaving free space behind it for growth
+    unsigned long cluster = fat16_find_free_cluster(vfss, vfss->fat16.free_hint);
+#else
     unsigned long cluster = fat16_find_free_cluster(vfss, 2);
+#endif //VFS_FAT16_FREE_BITMAP
     if (cluster >= FAT_CLUSTER_RESERVED)
         return FAT_CLUSTER_RESERVED;
     if (!fat16_set_fat_value(vfss, cluster, FAT_CLUSTER_LAST))
         return FAT_CLUSTER_RESERVED;
+#if (VFS_FAT16_FREE_BITMAP)
+    vfss->fat16.free_hint = cluster;
+#endif //VFS_FAT16_FREE_BITMAP
     return cluster;
 }
 
@@ -183,6 +307,9 @@ static unsigned long fat16_occupy_next_cluster(VFSS_TYPE* vfss, unsigned long cu
         return FAT_CLUSTER_RESERVED;
     if (!fat16_set_fat_value(vfss, cluster, FAT_CLUSTER_LAST))
         return FAT_CLUSTER_RESERVED;
+#if (VFS_FAT16_FREE_BITMAP)
+    vfss->fat16.free_hint = cluster;
+#endif //VFS_FAT16_FREE_BITMAP
     return cluster;
 }
 
@@ -220,6 +347,9 @@ static unsigned int fat16_strspcpy(char* dst, char* src, unsigned int dst_size,
 void fat16_init(VFSS_TYPE* vfss)
 {
     vfss->fat16.active = false;
+#if (VFS_FAT16_FREE_BITMAP)
+    vfss->fat16.free_bitmap = NULL;
+#endif //VFS_FAT16_FREE_BITMAP
     so_create(&vfss->fat16.finds, sizeof(FAT16_FILE_INFO), 1);
     so_create(&vfss->fat16.file_handles, sizeof(FAT16_FILE_HANDLE_TYPE), 1);
 }
@@ -297,6 +427,158 @@ static bool fat16_fi_get_cluster_num(VFSS_TYPE* vfss, FAT16_FILE_INFO* fi, unsig
     return fi->current_cluster < FAT_CLUSTER_RESERVED;
 }
 
+#if (VFS_FAT16_EXTENTS)
+static void fat16_extent_add(FAT16_FILE_HANDLE_TYPE* f, unsigned int cluster_num, unsigned int cluster)
+{
+    FAT16_EXTENT* last;
+    if (f->extents_count)
+    {
+        last = &f->extents[f->extents_count - 1];
+        //map is continuous from file start
+        if (last->cluster_num + last->count != cluster_num)
+            return;
+        if (last->cluster + last->count == cluster)
+        {
+            ++last->count;
+            return;
+        }
+        if (f->extents_count >= VFS_FAT16_EXTENTS)
+            return;
+    }
+    else if (cluster_num)
+        return;
+    f->extents[f->extents_count].cluster_num = cluster_num;
+    f->extents[f->extents_count].cluster = cluster;
+    f->extents[f->extents_count].count = 1;
+    ++f->extents_count;
+}
+
+//FAT_CLUSTER_RESERVED if not mapped yet
+static unsigned int fat16_extent_find(FAT16_FILE_HANDLE_TYPE* f, unsigned int cluster_num)
+{
+    int lo, hi, mid;
+    for (lo = 0, hi = f->extents_count - 1; lo <= hi; )
+    {
+        mid = (lo + hi) >> 1;
+        if (cluster_num < f->extents[mid].cluster_num)
+            hi = mid - 1;
+        else if (cluster_num >= f->extents[mid].cluster_num + f->extents[mid].count)
+            lo = mid + 1;
+        else
+            return f->extents[mid].cluster + cluster_num - f->extents[mid].cluster_num;
+    }
+    return FAT_CLUSTER_RESERVED;
+}
+#endif //VFS_FAT16_EXTENTS
+
+static void fat16_file_init_data(FAT16_FILE_HANDLE_TYPE* f, unsigned int first_cluster)
+{
+    fat16_fi_create(&f->data, first_cluster);
+#if (VFS_FAT16_EXTENTS)
+    f->extents_count = 0;
+    if (first_cluster >= 2 && first_cluster < FAT_CLUSTER_RESERVED)
+        fat16_extent_add(f, 0, first_cluster);
+#endif //VFS_FAT16_EXTENTS
+}
+
+//move file data to next cluster of chain
+static unsigned int fat16_file_next_cluster(VFSS_TYPE* vfss, FAT16_FILE_HANDLE_TYPE* f)
+{
+    unsigned int next;
+#if (VFS_FAT16_EXTENTS)
+    next = fat16_extent_find(f, f->data.cluster_num + 1);
+    if (next >= FAT_CLUSTER_RESERVED)
+    {
+        next = fat16_get_fat_next(vfss, f->data.current_cluster);
+        if (next < FAT_CLUSTER_RESERVED)
+            fat16_extent_add(f, f->data.cluster_num + 1, next);
+    }
+#else
+    next = fat16_get_fat_next(vfss, f->data.current_cluster);
+#endif //VFS_FAT16_EXTENTS
+    if (next < FAT_CLUSTER_RESERVED)
+    {
+        f->data.current_cluster = next;
+        ++f->data.cluster_num;
+    }
+    return next;
+}
+
+//forward file data to cluster_num of chain, without restart
+static bool fat16_file_forward(VFSS_TYPE* vfss, FAT16_FILE_HANDLE_TYPE* f, unsigned int cluster_num)
+{
+    while (f->data.cluster_num < cluster_num)
+    {
+        if (fat16_file_next_cluster(vfss, f) >= FAT_CLUSTER_RESERVED)
+            return false;
+    }
+    return true;
+}
+
+//sectors count, physically contiguous from sector of current cluster, up to max_sectors. Append clusters on write, if required
+static unsigned int fat16_file_contiguous_sectors(VFSS_TYPE* vfss, FAT16_FILE_HANDLE_TYPE* f, unsigned int sector, unsigned int max_sectors, bool append)
+{
+    unsigned int count, cluster, cluster_num, next;
+    cluster = f->data.current_cluster;
+    cluster_num = f->data.cluster_num;
+    for (count = vfss->fat16.cluster_sectors - sector; count < max_sectors; count += vfss->fat16.cluster_sectors)
+    {
+#if (VFS_FAT16_EXTENTS)
+        next = fat16_extent_find(f, cluster_num + 1);
+        if (next >= FAT_CLUSTER_RESERVED)
+#endif //VFS_FAT16_EXTENTS
+        {
+            next = fat16_get_fat_value(vfss, cluster);
+            //append only if next is free, rest is appended by write
+            if ((next >= FAT_CLUSTER_RESERVED) && append && (cluster + 1 < vfss->fat16.clusters_count) &&
+                (fat16_get_fat_value(vfss, cluster + 1) == FAT_CLUSTER_FREE))
+            {
+                next = cluster + 1;
+                if (!fat16_set_fat_value(vfss, cluster, next) || !fat16_set_fat_value(vfss, next, FAT_CLUSTER_LAST))
+                    break;
+            }
+            if (next < 2 || next >= FAT_CLUSTER_RESERVED)
+                break;
+#if (VFS_FAT16_EXTENTS)
+            fat16_extent_add(f, cluster_num + 1, next);
+#endif //VFS_FAT16_EXTENTS
+        }
+        if (next != cluster + 1)
+            break;
+        cluster = next;
+        ++cluster_num;
+    }
+    return count < max_sectors ? count : max_sectors;
+}
+
+static bool fat16_file_get_cluster_num(VFSS_TYPE* vfss, FAT16_FILE_HANDLE_TYPE* f, unsigned int cluster_num)
+{
+#if (VFS_FAT16_EXTENTS)
+    FAT16_EXTENT* last;
+    unsigned int cluster = fat16_extent_find(f, cluster_num);
+    if (cluster < FAT_CLUSTER_RESERVED)
+    {
+        f->data.current_cluster = cluster;
+        f->data.cluster_num = cluster_num;
+        return true;
+    }
+    //continue walk from last mapped cluster
+    if (f->extents_count)
+    {
+        last = &f->extents[f->extents_count - 1];
+        f->data.current_cluster = last->cluster + last->count - 1;
+        f->data.cluster_num = last->cluster_num + last->count - 1;
+    }
+    else
+        fat16_fi_reset(&f->data);
+    if (f->data.current_cluster >= FAT_CLUSTER_RESERVED)
+        return false;
+    return fat16_file_forward(vfss, f, cluster_num);
+#else
+    return fat16_fi_get_cluster_num(vfss, &f->data, cluster_num);
+#endif //VFS_FAT16_EXTENTS
+}
+
 //sector offset inside current cluster
 static unsigned int fat16_entry_get_sector_num(VFSS_TYPE* vfss, FAT16_FILE_INFO* fi)
 {
@@ -974,8 +1256,12 @@ static inline void fat16_mount(VFSS_TYPE* vfss)
         error(ERROR_ALREADY_CONFIGURED);
         return;
     }
-    if (fat16_parse_boot(vfss))
-        vfss->fat16.active = true;
+    if (!fat16_parse_boot(vfss))
+        return;
+#if (VFS_FAT16_FREE_BITMAP)
+    fat16_bitmap_create(vfss);
+#endif //VFS_FAT16_FREE_BITMAP
+    vfss->fat16.active = true;
 }
 
 static void fat16_unmount(VFSS_TYPE* vfss)
@@ -987,6 +1273,9 @@ static void fat16_unmount(VFSS_TYPE* vfss)
     //2. free file_handles
     while((handle = so_first(&vfss->fat16.file_handles)) != INVALID_HANDLE)
         fat16_close_file(vfss, handle);
+#if (VFS_FAT16_FREE_BITMAP)
+    fat16_bitmap_destroy(vfss);
+#endif //VFS_FAT16_FREE_BITMAP
     vfss->fat16.active = false;
 }
 
@@ -1136,7 +1425,7 @@ static inline void fat16_open_file(VFSS_TYPE* vfss, unsigned int folder, IO* io,
     f = so_get(&vfss->fat16.file_handles, h);
     memcpy(&f->fi, &fi, sizeof(FAT16_FILE_INFO));
     entry = fat16_read_file_entry(vfss, &fi);
-    fat16_fi_create(&f->data, entry->first_cluster);
+    fat16_file_init_data(f, entry->first_cluster);
     f->size = entry->size;
     f->mode = ot->mode;
 
@@ -1161,7 +1450,7 @@ static inline void fat16_seek_file(VFSS_TYPE* vfss, HANDLE h, unsigned int pos)
         cluster_num = (f->size - 1) / vfss->fat16.cluster_size;
     else
         cluster_num = f->data.pos / vfss->fat16.cluster_size;
-    if (!fat16_fi_get_cluster_num(vfss, &f->data, cluster_num))
+    if (!fat16_file_get_cluster_num(vfss, f, cluster_num))
     {
         fat16_fi_reset(&f->data);
         f->data.pos = 0;
@@ -1171,7 +1460,7 @@ static inline void fat16_seek_file(VFSS_TYPE* vfss, HANDLE h, unsigned int pos)
 static inline void fat16_read_file(VFSS_TYPE* vfss, HANDLE h, IO* io, unsigned int size, HANDLE process)
 {
     FAT16_FILE_HANDLE_TYPE* f;
-    unsigned int cluster_offset, sector_offset, chunk, sector, sectors_count, next_cluster;
+    unsigned int cluster_offset, sector_offset, chunk, sector, sectors_count;
     uint8_t* buf;
     f = so_get(&vfss->fat16.file_handles, h);
     if (f == NULL)
@@ -1189,35 +1478,39 @@ static inline void fat16_read_file(VFSS_TYPE* vfss, HANDLE h, IO* io, unsigned i
     if (f->size - f->data.pos < size)
         size = f->size - f->data.pos;
     io->data_size = 0;
-    buf = vfss_get_buf(vfss);
     while(size)
     {
         cluster_offset = f->data.pos % vfss->fat16.cluster_size;
         sector_offset = cluster_offset % FAT_SECTOR_SIZE;
         sector = cluster_offset / FAT_SECTOR_SIZE;
-        sectors_count = (size + sector_offset + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
-        if (sectors_count + sector > vfss->fat16.cluster_sectors)
-            sectors_count = vfss->fat16.cluster_sectors - sector;
-        chunk = sectors_count * FAT_SECTOR_SIZE - sector_offset;
-        if (chunk > size)
-            chunk = size;
-
-        if (vfss_read_sectors(vfss, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, sectors_count * FAT_SECTOR_SIZE) == NULL)
-            return;
-        io_data_append(io, buf + sector_offset, chunk);
+        //whole sectors, up to contiguous clusters run, directly to io
+        if ((sector_offset == 0) && (size >= FAT_SECTOR_SIZE))
+        {
+            sectors_count = fat16_file_contiguous_sectors(vfss, f, sector, size / FAT_SECTOR_SIZE, false);
+            chunk = sectors_count * FAT_SECTOR_SIZE;
+            if (!vfss_read_sectors_io(vfss, io, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, chunk))
+                return;
+        }
+        else
+        {
+            sectors_count = (size + sector_offset + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
+            if (sectors_count + sector > vfss->fat16.cluster_sectors)
+                sectors_count = vfss->fat16.cluster_sectors - sector;
+            chunk = sectors_count * FAT_SECTOR_SIZE - sector_offset;
+            if (chunk > size)
+                chunk = size;
+            buf = vfss_read_sectors(vfss, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, sectors_count * FAT_SECTOR_SIZE);
+            if (buf == NULL)
+                return;
+            io_data_append(io, buf + sector_offset, chunk);
+        }
         size -= chunk;
         f->data.pos += chunk;
-        if ((f->data.pos < f->size) && ((f->data.pos % vfss->fat16.cluster_size) == 0))
+        if ((f->data.pos < f->size) && !fat16_file_forward(vfss, f, f->data.pos / vfss->fat16.cluster_size))
         {
-            next_cluster = fat16_get_fat_next(vfss, f->data.current_cluster);
-            if (next_cluster >= FAT_CLUSTER_RESERVED)
-            {
-                fat16_fi_reset(&f->data);
-                f->data.pos = 0;
-                return;
-            }
-            else
-                f->data.current_cluster = next_cluster;
+            fat16_fi_reset(&f->data);
+            f->data.pos = 0;
+            return;
         }
     }
     io_complete(process, HAL_IO_CMD(HAL_VFS, IPC_READ), h, io);
@@ -1272,12 +1565,6 @@ static inline void fat16_write_file(VFSS_TYPE* vfss, HANDLE h, IO* io, HANDLE pr
         cluster_offset = f->data.pos % vfss->fat16.cluster_size;
         sector_offset = cluster_offset % FAT_SECTOR_SIZE;
         sector = cluster_offset / FAT_SECTOR_SIZE;
-        sectors_count = (size + sector_offset + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
-        if (sectors_count + sector > vfss->fat16.cluster_sectors)
-            sectors_count = vfss->fat16.cluster_sectors - sector;
-        chunk = sectors_count * FAT_SECTOR_SIZE - sector_offset;
-        if (chunk > size)
-            chunk = size;
 
         //append cluster. Empty file already have one
         if ((f->data.pos == f->size) && (cluster_offset == 0) && f->size)
@@ -1286,39 +1573,57 @@ static inline void fat16_write_file(VFSS_TYPE* vfss, HANDLE h, IO* io, HANDLE pr
             if (next_cluster >= FAT_CLUSTER_RESERVED)
                 break;
             f->data.current_cluster = next_cluster;
+            ++f->data.cluster_num;
+#if (VFS_FAT16_EXTENTS)
+            fat16_extent_add(f, f->data.cluster_num, next_cluster);
+#endif //VFS_FAT16_EXTENTS
         }
 
-        //readout first, no align
-        if (sector_offset || (chunk % FAT_SECTOR_SIZE))
+        //whole sectors, up to contiguous clusters run, directly from io
+        if ((sector_offset == 0) && (size >= FAT_SECTOR_SIZE))
         {
-            if (vfss_read_sectors(vfss, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, sectors_count * FAT_SECTOR_SIZE) == NULL)
+            sectors_count = fat16_file_contiguous_sectors(vfss, f, sector, size / FAT_SECTOR_SIZE, true);
+            chunk = sectors_count * FAT_SECTOR_SIZE;
+            if (!vfss_write_sectors_io(vfss, io, io->data_size - size, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, chunk))
                 break;
+            data += chunk;
         }
+        else
+        {
+            sectors_count = (size + sector_offset + FAT_SECTOR_SIZE - 1) / FAT_SECTOR_SIZE;
+            if (sectors_count + sector > vfss->fat16.cluster_sectors)
+                sectors_count = vfss->fat16.cluster_sectors - sector;
+            chunk = sectors_count * FAT_SECTOR_SIZE - sector_offset;
+            if (chunk > size)
+                chunk = size;
+
+            //readout first, no align
+            if (sector_offset || (chunk % FAT_SECTOR_SIZE))
+            {
+                if (vfss_read_sectors(vfss, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, sectors_count * FAT_SECTOR_SIZE) == NULL)
+                    break;
+            }
 
-        //overwrite data
-        memcpy(buf + sector_offset, data, chunk);
-        data += chunk;
+            //overwrite data
+            memcpy(buf + sector_offset, data, chunk);
+            data += chunk;
 
-        //writeback
-        if (!vfss_write_sectors(vfss, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, sectors_count * FAT_SECTOR_SIZE))
-            break;
+            //writeback
+            if (!vfss_write_sectors(vfss, fat16_cluster_to_sector(vfss, f->data.current_cluster) + sector, sectors_count * FAT_SECTOR_SIZE))
+                break;
+        }
 
         f->data.pos += chunk;
         //append to end of file
         if (f->data.pos > f->size)
             f->size = f->data.pos;
 
-        if ((f->data.pos < f->size) && ((f->data.pos % vfss->fat16.cluster_size) == 0))
+        //stay on last cluster at the end of file, next write will append
+        if (!fat16_file_forward(vfss, f, (f->data.pos == f->size ? f->data.pos - 1 : f->data.pos) / vfss->fat16.cluster_size))
         {
-            next_cluster = fat16_get_fat_next(vfss, f->data.current_cluster);
-            if (next_cluster >= FAT_CLUSTER_RESERVED)
-            {
-                fat16_fi_reset(&f->data);
-                f->data.pos = 0;
-                break;
-            }
-            else
-                f->data.current_cluster = next_cluster;
+            fat16_fi_reset(&f->data);
+            f->data.pos = 0;
+            break;
         }
     }
     //update file attributes
@@ -1522,6 +1827,10 @@ static inline void fat16_format(VFSS_TYPE* vfss, IO* io, HANDLE process)
 static int fat16_get_free(VFSS_TYPE* vfss)
 {
     unsigned int free_clusters, cluster;
+#if (VFS_FAT16_FREE_BITMAP)
+    if (vfss->fat16.free_bitmap != NULL)
+        return vfss->fat16.free_count * vfss->fat16.cluster_size;
+#endif //VFS_FAT16_FREE_BITMAP
     free_clusters = 0;
     for (cluster = 2; cluster < vfss->fat16.clusters_count; ++cluster)
         if (fat16_get_fat_value(vfss, cluster) == FAT_CLUSTER_FREE)
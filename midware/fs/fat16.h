@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include "../../userspace/so.h"
 #include "vfss.h"
+#include "sys_config.h"
 
 #define FAT_SECTOR_SIZE                                     512
 
@@ -91,6 +92,11 @@ typedef struct {
     unsigned long sectors_count, cluster_sectors, root_count, root_sectors, reserved_sectors, fat_sectors, cluster_size, clusters_count, fat_count;
     SO finds;
     SO file_handles;
+#if (VFS_FAT16_FREE_BITMAP)
+    //bit set - cluster free. NULL if not enough memory on mount
+    uint32_t* free_bitmap;
+    unsigned long free_count, free_hint;
+#endif //VFS_FAT16_FREE_BITMAP
     bool active;
 } FAT16_TYPE;
 
@@ -52,20 +52,201 @@ unsigned int vfss_get_volume_sectors(VFSS_TYPE* vfss)
     return vfss->volume.sectors_count;
 }
 
-void* vfss_read_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned size)
+static bool vfss_read_sectors_internal(VFSS_TYPE* vfss, unsigned long sector, unsigned size)
 {
-    bool res;
-    //cache read
-    if ((sector == vfss->current_sector) && (vfss->io->data_size == size))
-        return io_data(vfss->io);
 #if (VFS_BER)
     if (vfss->volume.sector_mode == SECTOR_MODE_BER)
-        res = ber_read_sectors(vfss, sector, size);
-    else
+        return ber_read_sectors(vfss, sector, size);
 #endif //VFS_BER
-        res = storage_read_sync(vfss->volume.hal, vfss->volume.process, vfss->volume.user, vfss->io, sector + vfss->volume.first_sector, size);
+    return storage_read_sync(vfss->volume.hal, vfss->volume.process, vfss->volume.user, vfss->io, sector + vfss->volume.first_sector, size);
+}
+
+static bool vfss_write_sectors_internal(VFSS_TYPE* vfss, unsigned long sector, unsigned size)
+{
+#if (VFS_BER)
+    if (vfss->volume.sector_mode == SECTOR_MODE_BER)
+        return ber_write_sectors(vfss, sector, size);
+#endif //VFS_BER
+    vfss->io->data_size = size;
+    return storage_write_sync(vfss->volume.hal, vfss->volume.process, vfss->volume.user, vfss->io, sector + vfss->volume.first_sector);
+}
+
+#if (VFS_CACHE_SECTORS)
+static void vfss_cache_swap(VFSS_TYPE* vfss, VFSS_CACHE_ENTRY* entry)
+{
+    unsigned int i, tmp;
+    uint32_t* a = io_data(vfss->io);
+    uint32_t* b = io_data(entry->io);
+    for (i = 0; i < FAT_SECTOR_SIZE / sizeof(uint32_t); ++i)
+    {
+        tmp = a[i];
+        a[i] = b[i];
+        b[i] = tmp;
+    }
+}
+
+static bool vfss_cache_write_back(VFSS_TYPE* vfss, VFSS_CACHE_ENTRY* entry)
+{
+    bool res;
+    unsigned int data_size;
+    if (!entry->dirty)
+        return true;
+    //write from working buffer: BER may require full block size. Working buffer content is preserved
+    data_size = vfss->io->data_size;
+    vfss_cache_swap(vfss, entry);
+    res = vfss_write_sectors_internal(vfss, entry->sector, FAT_SECTOR_SIZE);
+    vfss_cache_swap(vfss, entry);
+    vfss->io->data_size = data_size;
     if (!res)
+        return false;
+    entry->dirty = false;
+    ++vfss->cache_stat.write_backs;
+    return true;
+}
+
+static bool vfss_cache_flush(VFSS_TYPE* vfss)
+{
+    unsigned int i;
+    bool res = true;
+    for (i = 0; i < VFS_CACHE_SECTORS; ++i)
+    {
+        if (vfss->cache[i].last_used && !vfss_cache_write_back(vfss, &vfss->cache[i]))
+            res = false;
+    }
+    return res;
+}
+
+static void vfss_cache_invalidate(VFSS_TYPE* vfss)
+{
+    unsigned int i;
+    for (i = 0; i < VFS_CACHE_SECTORS; ++i)
+    {
+        vfss->cache[i].last_used = 0;
+        vfss->cache[i].dirty = false;
+    }
+    vfss->cache_time = 0;
+}
+
+static inline void vfss_cache_touch(VFSS_TYPE* vfss, VFSS_CACHE_ENTRY* entry)
+{
+    entry->last_used = ++vfss->cache_time;
+    //wrap, very unlikely
+    if (vfss->cache_time == 0)
+    {
+        vfss_cache_flush(vfss);
+        vfss_cache_invalidate(vfss);
+    }
+}
+
+static VFSS_CACHE_ENTRY* vfss_cache_find(VFSS_TYPE* vfss, unsigned long sector)
+{
+    unsigned int i;
+    for (i = 0; i < VFS_CACHE_SECTORS; ++i)
+    {
+        if (vfss->cache[i].last_used && (vfss->cache[i].sector == sector))
+            return &vfss->cache[i];
+    }
+    return NULL;
+}
+
+static VFSS_CACHE_ENTRY* vfss_cache_allocate(VFSS_TYPE* vfss, unsigned long sector)
+{
+    unsigned int i;
+    VFSS_CACHE_ENTRY* entry = NULL;
+    for (i = 0; i < VFS_CACHE_SECTORS; ++i)
+    {
+        if (vfss->cache[i].io == NULL)
+            continue;
+        if ((entry == NULL) || (vfss->cache[i].last_used < entry->last_used))
+            entry = &vfss->cache[i];
+    }
+    if ((entry == NULL) || !vfss_cache_write_back(vfss, entry))
+        return NULL;
+    entry->sector = sector;
+    entry->last_used = 0;
+    return entry;
+}
+
+static void* vfss_cache_read(VFSS_TYPE* vfss, unsigned long sector)
+{
+    VFSS_CACHE_ENTRY* entry = vfss_cache_find(vfss, sector);
+    if (entry != NULL)
+    {
+        ++vfss->cache_stat.hits;
+        memcpy(io_data(vfss->io), io_data(entry->io), FAT_SECTOR_SIZE);
+        vfss->io->data_size = FAT_SECTOR_SIZE;
+    }
+    else
+    {
+        ++vfss->cache_stat.misses;
+        if (!vfss_read_sectors_internal(vfss, sector, FAT_SECTOR_SIZE))
+            return NULL;
+        vfss->io->data_size = FAT_SECTOR_SIZE;
+        entry = vfss_cache_allocate(vfss, sector);
+        if (entry == NULL)
+            return io_data(vfss->io);
+        memcpy(io_data(entry->io), io_data(vfss->io), FAT_SECTOR_SIZE);
+        entry->dirty = false;
+    }
+    vfss_cache_touch(vfss, entry);
+    return io_data(vfss->io);
+}
+
+static bool vfss_cache_write(VFSS_TYPE* vfss, unsigned long sector)
+{
+    VFSS_CACHE_ENTRY* entry = vfss_cache_find(vfss, sector);
+    if (entry == NULL)
+        entry = vfss_cache_allocate(vfss, sector);
+    //no space or write back failed, write through
+    if (entry == NULL)
+        return vfss_write_sectors_internal(vfss, sector, FAT_SECTOR_SIZE);
+    memcpy(io_data(entry->io), io_data(vfss->io), FAT_SECTOR_SIZE);
+    vfss->io->data_size = FAT_SECTOR_SIZE;
+    entry->dirty = true;
+    vfss_cache_touch(vfss, entry);
+    return true;
+}
+
+//apply cache over multisector read, or update cache after multisector write
+static void vfss_cache_sync_range(VFSS_TYPE* vfss, uint8_t* buf, unsigned long sector, unsigned size, bool write)
+{
+    unsigned int i;
+    VFSS_CACHE_ENTRY* entry;
+    for (i = 0; i < VFS_CACHE_SECTORS; ++i)
+    {
+        entry = &vfss->cache[i];
+        if (!entry->last_used || (entry->sector < sector) || (entry->sector >= sector + size / FAT_SECTOR_SIZE))
+            continue;
+        if (write)
+        {
+            memcpy(io_data(entry->io), buf + (entry->sector - sector) * FAT_SECTOR_SIZE, FAT_SECTOR_SIZE);
+            entry->dirty = false;
+        }
+        else if (entry->dirty)
+            memcpy(buf + (entry->sector - sector) * FAT_SECTOR_SIZE, io_data(entry->io), FAT_SECTOR_SIZE);
+    }
+}
+#endif //VFS_CACHE_SECTORS
+
+void* vfss_read_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned size)
+{
+    //cache read
+    if ((sector == vfss->current_sector) && (vfss->io->data_size == size))
+        return io_data(vfss->io);
+#if (VFS_CACHE_SECTORS)
+    if (size == FAT_SECTOR_SIZE)
+    {
+        if (vfss_cache_read(vfss, sector) == NULL)
+            return NULL;
+        vfss->current_sector = sector;
+        return io_data(vfss->io);
+    }
+#endif //VFS_CACHE_SECTORS
+    if (!vfss_read_sectors_internal(vfss, sector, size))
         return NULL;
+#if (VFS_CACHE_SECTORS)
+    vfss_cache_sync_range(vfss, io_data(vfss->io), sector, size, false);
+#endif //VFS_CACHE_SECTORS
     vfss->current_sector = sector;
     return io_data(vfss->io);
 }
@@ -73,20 +254,100 @@ void* vfss_read_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned size)
 bool vfss_write_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned size)
 {
     bool res;
-#if (VFS_BER)
-    if (vfss->volume.sector_mode == SECTOR_MODE_BER)
-        res = ber_write_sectors(vfss, sector, size);
+#if (VFS_CACHE_SECTORS)
+    if (size == FAT_SECTOR_SIZE)
+        res = vfss_cache_write(vfss, sector);
     else
-#endif //VFS_BER
     {
-        vfss->io->data_size = size;
-        res = storage_write_sync(vfss->volume.hal, vfss->volume.process, vfss->volume.user, vfss->io, sector + vfss->volume.first_sector);
+        res = vfss_write_sectors_internal(vfss, sector, size);
+        if (res)
+            vfss_cache_sync_range(vfss, io_data(vfss->io), sector, size, true);
     }
+#else
+    res = vfss_write_sectors_internal(vfss, sector, size);
+#endif //VFS_CACHE_SECTORS
     if (res)
         vfss->current_sector = sector;
     return res;
 }
 
+//storage and DMA requirements for transfer from/to io data in place
+static bool vfss_io_direct(VFSS_TYPE* vfss, IO* io, unsigned int offset, unsigned size)
+{
+#if (VFS_BER)
+    if (vfss->volume.sector_mode == SECTOR_MODE_BER)
+        return false;
+#endif //VFS_BER
+    if ((io->data_offset + offset) & 3)
+        return false;
+    return io->size >= io->data_offset + offset + size + io->stack_size + sizeof(STORAGE_STACK);
+}
+
+bool vfss_read_sectors_io(VFSS_TYPE* vfss, IO* io, unsigned long sector, unsigned size)
+{
+    unsigned int data_offset, data_size, chunk;
+    bool res;
+    if (vfss_io_direct(vfss, io, io->data_size, size))
+    {
+        //read after current data
+        data_offset = io->data_offset;
+        data_size = io->data_size;
+        io->data_offset += data_size;
+        io->data_size = 0;
+        res = storage_read_sync(vfss->volume.hal, vfss->volume.process, vfss->volume.user, io, sector + vfss->volume.first_sector, size);
+#if (VFS_CACHE_SECTORS)
+        if (res)
+            vfss_cache_sync_range(vfss, io_data(io), sector, size, false);
+#endif //VFS_CACHE_SECTORS
+        io->data_offset = data_offset;
+        io->data_size = data_size + (res ? size : 0);
+        return res;
+    }
+    for (; size; size -= chunk, sector += chunk / FAT_SECTOR_SIZE)
+    {
+        chunk = size;
+        if (chunk > vfss->io_size)
+            chunk = vfss->io_size;
+        if (vfss_read_sectors(vfss, sector, chunk) == NULL)
+            return false;
+        io_data_append(io, io_data(vfss->io), chunk);
+    }
+    return true;
+}
+
+bool vfss_write_sectors_io(VFSS_TYPE* vfss, IO* io, unsigned int offset, unsigned long sector, unsigned size)
+{
+    unsigned int data_offset, data_size, chunk;
+    bool res;
+    if (vfss_io_direct(vfss, io, offset, size))
+    {
+        data_offset = io->data_offset;
+        data_size = io->data_size;
+        io->data_offset += offset;
+        io->data_size = size;
+        res = storage_write_sync(vfss->volume.hal, vfss->volume.process, vfss->volume.user, io, sector + vfss->volume.first_sector);
+#if (VFS_CACHE_SECTORS)
+        if (res)
+            vfss_cache_sync_range(vfss, io_data(io), sector, size, true);
+#endif //VFS_CACHE_SECTORS
+        io->data_offset = data_offset;
+        io->data_size = data_size;
+        //working buffer may be outdated
+        vfss->current_sector = 0xffffffff;
+        return res;
+    }
+    for (; size; size -= chunk, sector += chunk / FAT_SECTOR_SIZE, offset += chunk)
+    {
+        chunk = size;
+        if (chunk > vfss->io_size)
+            chunk = vfss->io_size;
+        memcpy(io_data(vfss->io), (uint8_t*)io_data(io) + offset, chunk);
+        if (!vfss_write_sectors(vfss, sector, chunk))
+            return false;
+    }
+    return true;
+}
+
 bool vfss_zero_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned count)
 {
     unsigned long i, io_sectors, sectors_to_zero;
@@ -119,18 +380,44 @@ static inline void vfss_open_volume(VFSS_TYPE* vfss, IO* io)
     memcpy(&vfss->volume, io_data(io), sizeof(VFS_VOLUME_TYPE));
     vfss->current_sector = 0xffffffff;
     vfss->current_size = 0;
+#if (VFS_CACHE_SECTORS)
+    vfss_cache_invalidate(vfss);
+    memset(&vfss->cache_stat, 0x00, sizeof(VFS_CACHE_STAT_TYPE));
+#endif //VFS_CACHE_SECTORS
 }
 
 static inline void vfss_close_volume(VFSS_TYPE* vfss)
 {
+#if (VFS_CACHE_SECTORS)
+    vfss_cache_flush(vfss);
+    vfss_cache_invalidate(vfss);
+#endif //VFS_CACHE_SECTORS
     vfss->volume.process = INVALID_HANDLE;
 }
 
+#if (VFS_CACHE_SECTORS)
+static inline void vfss_cache_stat(VFSS_TYPE* vfss, IO* io)
+{
+    memcpy(io_data(io), &vfss->cache_stat, sizeof(VFS_CACHE_STAT_TYPE));
+    io->data_size = sizeof(VFS_CACHE_STAT_TYPE);
+}
+#endif //VFS_CACHE_SECTORS
+
 static inline void vfss_init(VFSS_TYPE* vfss)
 {
+#if (VFS_CACHE_SECTORS)
+    unsigned int i;
+#endif //VFS_CACHE_SECTORS
     vfss->volume.process = INVALID_HANDLE;
     vfss->io = io_create(FAT_SECTOR_SIZE + sizeof(STORAGE_STACK));
     vfss->io_size = FAT_SECTOR_SIZE;
+#if (VFS_CACHE_SECTORS)
+    //entry without io is never allocated
+    for (i = 0; i < VFS_CACHE_SECTORS; ++i)
+        vfss->cache[i].io = io_create(FAT_SECTOR_SIZE);
+    vfss_cache_invalidate(vfss);
+    memset(&vfss->cache_stat, 0x00, sizeof(VFS_CACHE_STAT_TYPE));
+#endif //VFS_CACHE_SECTORS
 #if (VFS_BER)
     ber_init(vfss);
 #endif //VFS_BER
@@ -159,9 +446,23 @@ void vfss_request(VFSS_TYPE *vfss, IPC* ipc)
         vfss_close_volume(vfss);
         return;
     }
+#if (VFS_CACHE_SECTORS)
+    if ((HAL_ITEM(ipc->cmd) == VFS_STAT) && (ipc->param1 == VFS_VOLUME_HANDLE))
+    {
+        vfss_cache_stat(vfss, (IO*)ipc->param2);
+        return;
+    }
+#endif //VFS_CACHE_SECTORS
 #if (VFS_BER)
     if ((vfss->volume.sector_mode == SECTOR_MODE_BER) && (ipc->param1 == VFS_BER_HANDLE))
     {
+#if (VFS_CACHE_SECTORS)
+        //raw access and transactions are below cache
+        if (HAL_ITEM(ipc->cmd) != VFS_ROLLBACK_TRANSACTION)
+            vfss_cache_flush(vfss);
+        vfss_cache_invalidate(vfss);
+        vfss->current_sector = 0xffffffff;
+#endif //VFS_CACHE_SECTORS
         ber_request(vfss, ipc);
         return;
     }
@@ -172,6 +473,11 @@ void vfss_request(VFSS_TYPE *vfss, IPC* ipc)
 #else
     fat16_request(vfss, ipc);
 #endif  // VFS_SFS
+#if (VFS_CACHE_SECTORS)
+    //write back on file close and unmount. Format is completed asynchronously, flushed on volume close
+    if (HAL_ITEM(ipc->cmd) == IPC_CLOSE)
+        vfss_cache_flush(vfss);
+#endif //VFS_CACHE_SECTORS
 }
 
 void vfss()
@@ -8,6 +8,7 @@
 #define VFSS_H
 
 #include <stdbool.h>
+#include "../../userspace/io.h"
 
 typedef struct _VFSS_TYPE VFSS_TYPE;
 
@@ -20,5 +21,9 @@ unsigned int vfss_get_volume_sectors(VFSS_TYPE* vfss);
 void* vfss_read_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned size);
 bool vfss_write_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned size);
 bool vfss_zero_sectors(VFSS_TYPE* vfss, unsigned long sector, unsigned count);
+//append sectors to io. Directly to io data, if possible
+bool vfss_read_sectors_io(VFSS_TYPE* vfss, IO* io, unsigned long sector, unsigned size);
+//write sectors from io data at offset. Directly, if possible
+bool vfss_write_sectors_io(VFSS_TYPE* vfss, IO* io, unsigned int offset, unsigned long sector, unsigned size);
 
 #endif // VFSS_H
@@ -19,12 +19,26 @@
     #include "fat16.h"
 #endif  // VFS_SFS
 
+#if (VFS_CACHE_SECTORS)
+typedef struct {
+    IO* io;
+    unsigned long sector;
+    //0 - never used
+    unsigned int last_used;
+    bool dirty;
+} VFSS_CACHE_ENTRY;
+#endif //VFS_CACHE_SECTORS
 
 typedef struct _VFSS_TYPE {
     IO* io;
     unsigned io_size;
     VFS_VOLUME_TYPE volume;
     unsigned long current_sector, current_size;
+#if (VFS_CACHE_SECTORS)
+    VFSS_CACHE_ENTRY cache[VFS_CACHE_SECTORS];
+    unsigned int cache_time;
+    VFS_CACHE_STAT_TYPE cache_stat;
+#endif //VFS_CACHE_SECTORS
 #if (VFS_BER)
     BER_TYPE ber;
 #endif //VFS_BER
@@ -10,29 +10,69 @@
 #include "../../userspace/error.h"
 #include <string.h>
 
+//bucket is selected by mask
+#if (WEBS_NODE_HASH_SIZE & (WEBS_NODE_HASH_SIZE - 1))
+#error WEBS_NODE_HASH_SIZE must be power of 2
+#endif
+
+#define WEB_NODE_BUCKET(parent, hash)           (((hash) ^ (parent)) & (WEBS_NODE_HASH_SIZE - 1))
+
 void web_node_create(WEB_NODE* web_node)
 {
+    unsigned int i;
     so_create(&web_node->items, sizeof(WEB_NODE_ITEM), 1);
     web_node->root = INVALID_HANDLE;
+    web_node->hash = malloc(WEBS_NODE_HASH_SIZE * sizeof(HANDLE));
+    if (web_node->hash != NULL)
+        for (i = 0; i < WEBS_NODE_HASH_SIZE; ++i)
+            web_node->hash[i] = INVALID_HANDLE;
 }
 
 void web_node_destroy(WEB_NODE* web_node)
 {
     web_node_free(web_node, web_node->root);
+    free(web_node->hash);
     so_destroy(&web_node->items);
 }
 
-static WEB_NODE_ITEM* web_node_find_child(WEB_NODE* web_node, WEB_NODE_ITEM* parent, char* name, unsigned int len)
+static uint32_t web_node_hash(const char* name, unsigned int len)
 {
-    WEB_NODE_ITEM* cur;
-    for(cur = so_get(&web_node->items, parent->child); cur != NULL; cur = so_get(&web_node->items, cur->next))
+    //FNV-1a of lowercase name
+    unsigned int i;
+    uint32_t hash = 2166136261u;
+    char c;
+    for (i = 0; i < len; ++i)
     {
-        if (web_stricmp(WEB_OBJ_WILDCARD, 1, cur->name))
-            return cur;
+        c = name[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 0x20;
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash;
+}
 
-        if (web_stricmp(name, len, cur->name))
-            return cur;
+static HANDLE web_node_find_name(WEB_NODE* web_node, HANDLE parent, char* name, unsigned int len)
+{
+    WEB_NODE_ITEM* cur;
+    HANDLE h;
+    uint32_t hash = web_node_hash(name, len);
+    for (h = web_node->hash[WEB_NODE_BUCKET(parent, hash)]; h != INVALID_HANDLE; h = cur->hash_next)
+    {
+        cur = so_get(&web_node->items, h);
+        if ((cur->hash == hash) && (cur->parent == parent) && web_stricmp(name, len, cur->name) && (cur->name[len] == 0))
+            return h;
     }
+    return INVALID_HANDLE;
+}
+
+static WEB_NODE_ITEM* web_node_find_child(WEB_NODE* web_node, WEB_NODE_ITEM* parent, char* name, unsigned int len)
+{
+    HANDLE h;
+    if ((h = web_node_find_name(web_node, parent->self, name, len)) != INVALID_HANDLE)
+        return so_get(&web_node->items, h);
+    //exact name always wins over wildcard
+    if (parent->wildcard != INVALID_HANDLE)
+        return so_get(&web_node->items, parent->wildcard);
     return NULL;
 }
 
@@ -40,10 +80,14 @@ HANDLE web_node_allocate(WEB_NODE* web_node, HANDLE parent_handle, char* name, u
 {
     WEB_NODE_ITEM* parent;
     WEB_NODE_ITEM* cur;
-    WEB_NODE_ITEM* child;
     HANDLE cur_handle;
-    unsigned int len;
+    unsigned int len, bucket;
 
+    if (web_node->hash == NULL)
+    {
+        error(ERROR_OUT_OF_MEMORY);
+        return INVALID_HANDLE;
+    }
     len = strlen(name);
     if (parent_handle == WEB_ROOT_NODE)
     {
@@ -58,7 +102,7 @@ HANDLE web_node_allocate(WEB_NODE* web_node, HANDLE parent_handle, char* name, u
         parent = so_get(&web_node->items, parent_handle);
         if (parent == NULL)
             return INVALID_HANDLE;
-        if (web_node_find_child(web_node, parent, name, len) != NULL)
+        if (web_node_find_name(web_node, parent_handle, name, len) != INVALID_HANDLE)
         {
             error(ERROR_ALREADY_CONFIGURED);
             return INVALID_HANDLE;
@@ -76,25 +120,35 @@ HANDLE web_node_allocate(WEB_NODE* web_node, HANDLE parent_handle, char* name, u
     }
     strcpy(cur->name, name);
     cur->self = cur_handle;
-    cur->next = cur->child = INVALID_HANDLE;
+    cur->parent = parent_handle;
+    cur->next = cur->child = cur->wildcard = INVALID_HANDLE;
+    cur->hash = web_node_hash(name, len);
+    cur->hash_next = INVALID_HANDLE;
     cur->flags = flags;
+#if (WEBS_NODE_HANDLERS_MAX)
+    cur->handlers_count = cur->handler_next = 0;
+#endif //WEBS_NODE_HANDLERS_MAX
+#if (WEBS_NODE_STAT)
+    memset(&cur->stat, 0x00, sizeof(WEB_NODE_STAT));
+#endif //WEBS_NODE_STAT
+#if (WEBS_FILES)
+    cur->folder = 0;
+#endif //WEBS_FILES
 
     if (parent_handle == WEB_ROOT_NODE)
         web_node->root = cur_handle;
     else
     {
+        bucket = WEB_NODE_BUCKET(parent_handle, cur->hash);
+        cur->hash_next = web_node->hash[bucket];
+        web_node->hash[bucket] = cur_handle;
         //re-fetch after allocate
         parent = so_get(&web_node->items, parent_handle);
-        //first child
-        if (parent->child == INVALID_HANDLE)
-            parent->child = cur_handle;
-        //add sibling
-        else
-        {
-            for(child = so_get(&web_node->items, parent->child); child->next != INVALID_HANDLE;
-                child = so_get(&web_node->items, child->next)) {}
-            child->next = cur_handle;
-        }
+        //siblings order doesn't matter for routing, so just add first
+        cur->next = parent->child;
+        parent->child = cur_handle;
+        if (strcmp(name, WEB_OBJ_WILDCARD) == 0)
+            parent->wildcard = cur_handle;
     }
 
     return cur_handle;
@@ -102,6 +156,20 @@ HANDLE web_node_allocate(WEB_NODE* web_node, HANDLE parent_handle, char* name, u
 
 static void web_node_free_internal(WEB_NODE* web_node, WEB_NODE_ITEM* cur)
 {
+    HANDLE* h;
+    //root is not hashed
+    if (cur->parent != WEB_ROOT_NODE)
+    {
+        for (h = web_node->hash + WEB_NODE_BUCKET(cur->parent, cur->hash); *h != INVALID_HANDLE;
+             h = &((WEB_NODE_ITEM*)so_get(&web_node->items, *h))->hash_next)
+        {
+            if (*h == cur->self)
+            {
+                *h = cur->hash_next;
+                break;
+            }
+        }
+    }
     free(cur->name);
     so_free(&web_node->items, cur->self);
 }
@@ -109,11 +177,11 @@ static void web_node_free_internal(WEB_NODE* web_node, WEB_NODE_ITEM* cur)
 static void web_node_free_siblings(WEB_NODE* web_node, WEB_NODE_ITEM* cur)
 {
     WEB_NODE_ITEM* sibling;
-    WEB_NODE_ITEM* next;
+    HANDLE next;
 
-    for (sibling = cur; sibling != NULL; sibling = next)
+    for (sibling = cur; sibling != NULL; sibling = next == INVALID_HANDLE ? NULL : so_get(&web_node->items, next))
     {
-        next = so_get(&web_node->items, sibling->next);
+        next = sibling->next;
         if (sibling->child != INVALID_HANDLE)
             web_node_free_siblings(web_node, so_get(&web_node->items, sibling->child));
         web_node_free_internal(web_node, sibling);
@@ -124,8 +192,10 @@ void web_node_free(WEB_NODE* web_node, HANDLE handle)
 {
     WEB_NODE_ITEM* cur;
     WEB_NODE_ITEM* parent;
+    WEB_NODE_ITEM* sibling;
     HANDLE h;
-    bool found;
+    if (handle == INVALID_HANDLE)
+        return;
     cur = so_get(&web_node->items, handle);
     if (cur == NULL)
         return;
@@ -137,29 +207,23 @@ void web_node_free(WEB_NODE* web_node, HANDLE handle)
     //remove from parent/older brother
     if (handle != web_node->root)
     {
-        found = false;
-        for (h = so_first(&web_node->items); h != INVALID_HANDLE; h = so_next(&web_node->items, h))
+        parent = so_get(&web_node->items, cur->parent);
+        if (parent->wildcard == handle)
+            parent->wildcard = INVALID_HANDLE;
+        if (parent->child == handle)
+            parent->child = cur->next;
+        else
         {
-            parent = so_get(&web_node->items, h);
-            if (parent->child == handle)
+            for (h = parent->child; h != INVALID_HANDLE; h = sibling->next)
             {
-                parent->child = cur->next;
-                found = true;
-                break;
+                sibling = so_get(&web_node->items, h);
+                if (sibling->next == handle)
+                {
+                    sibling->next = cur->next;
+                    break;
+                }
             }
-            if (parent->next == handle)
-            {
-                parent->next = cur->next;
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-        {
-            error(ERROR_NOT_FOUND);
-            return;
         }
-
     }
 
     //destroy node itself
@@ -169,10 +233,12 @@ void web_node_free(WEB_NODE* web_node, HANDLE handle)
         web_node->root = INVALID_HANDLE;
 }
 
-HANDLE web_node_find_path(WEB_NODE* web_node, char* url, unsigned int url_size)
+HANDLE web_node_find_path(WEB_NODE* web_node, char* url, unsigned int url_size, char** tail, unsigned int* tail_size)
 {
     WEB_NODE_ITEM* cur;
     unsigned int len;
+    *tail = NULL;
+    *tail_size = 0;
     if (web_node->root == INVALID_HANDLE)
         return INVALID_HANDLE;
     if (!url_size || url[0] != '/')
@@ -181,19 +247,29 @@ HANDLE web_node_find_path(WEB_NODE* web_node, char* url, unsigned int url_size)
     //skip "/"
     --url_size;
     ++url;
-    if (url_size == 0)
-        return web_node->root;
     for (;;)
     {
+        //rest of path is handled by node itself
+        if (cur->flags & WEB_FLAG_FILES)
+        {
+            *tail = url;
+            *tail_size = url_size;
+            return cur->self;
+        }
+        if (url_size == 0)
+            return cur->self;
         len = web_get_word(url, url_size, '/');
         cur = web_node_find_child(web_node, cur, url, len);
         if (cur == NULL)
             return INVALID_HANDLE;
         if (len == url_size)
-            return cur->self;
-        //also skip slash
-        url += len + 1;
-        url_size -= len + 1;
+            url_size = 0;
+        else
+        {
+            //also skip slash
+            url += len + 1;
+            url_size -= len + 1;
+        }
     }
 }
 
@@ -205,3 +281,93 @@ bool web_node_check_flag(WEB_NODE* web_node, HANDLE handle, unsigned int flag)
         return false;
     return cur->flags & flag ? true : false;
 }
+
+#if (WEBS_NODE_HANDLERS_MAX)
+void web_node_add_handler(WEB_NODE* web_node, HANDLE handle, HANDLE process)
+{
+    unsigned int i;
+    WEB_NODE_ITEM* cur;
+    cur = so_get(&web_node->items, handle);
+    if (cur == NULL)
+        return;
+    for (i = 0; i < cur->handlers_count; ++i)
+    {
+        if (cur->handlers[i] == process)
+        {
+            error(ERROR_ALREADY_CONFIGURED);
+            return;
+        }
+    }
+    if (cur->handlers_count >= WEBS_NODE_HANDLERS_MAX)
+    {
+        error(ERROR_TOO_MANY_HANDLES);
+        return;
+    }
+    cur->handlers[cur->handlers_count++] = process;
+}
+
+void web_node_remove_handler(WEB_NODE* web_node, HANDLE handle, HANDLE process)
+{
+    unsigned int i;
+    WEB_NODE_ITEM* cur;
+    cur = so_get(&web_node->items, handle);
+    if (cur == NULL)
+        return;
+    for (i = 0; i < cur->handlers_count; ++i)
+    {
+        if (cur->handlers[i] == process)
+        {
+            memmove(cur->handlers + i, cur->handlers + i + 1, (cur->handlers_count - i - 1) * sizeof(HANDLE));
+            --cur->handlers_count;
+            if (cur->handler_next >= cur->handlers_count)
+                cur->handler_next = 0;
+            return;
+        }
+    }
+    error(ERROR_NOT_FOUND);
+}
+
+HANDLE web_node_next_handler(WEB_NODE* web_node, HANDLE handle)
+{
+    HANDLE process;
+    WEB_NODE_ITEM* cur;
+    cur = so_get(&web_node->items, handle);
+    if (cur == NULL || cur->handlers_count == 0)
+        return INVALID_HANDLE;
+    process = cur->handlers[cur->handler_next];
+    if (++cur->handler_next >= cur->handlers_count)
+        cur->handler_next = 0;
+    return process;
+}
+#endif //WEBS_NODE_HANDLERS_MAX
+
+#if (WEBS_FILES)
+void web_node_set_folder(WEB_NODE* web_node, HANDLE handle, unsigned int folder)
+{
+    WEB_NODE_ITEM* cur;
+    cur = so_get(&web_node->items, handle);
+    if (cur == NULL)
+        return;
+    cur->folder = folder;
+}
+
+unsigned int web_node_get_folder(WEB_NODE* web_node, HANDLE handle)
+{
+    WEB_NODE_ITEM* cur;
+    cur = so_get(&web_node->items, handle);
+    if (cur == NULL)
+        return 0;
+    return cur->folder;
+}
+#endif //WEBS_FILES
+
+#if (WEBS_NODE_STAT)
+WEB_NODE_STAT* web_node_get_stat(WEB_NODE* web_node, HANDLE handle)
+{
+    WEB_NODE_ITEM* cur;
+    cur = so_get(&web_node->items, handle);
+    if (cur == NULL)
+        return NULL;
+    return &cur->stat;
+}
+#endif //WEBS_NODE_STAT
@@ -9,16 +9,35 @@
 
 #include "../../userspace/types.h"
 #include "../../userspace/so.h"
+#include "../../userspace/web.h"
+#include "sys_config.h"
 
 typedef struct {
-    HANDLE child, next;
+    HANDLE child, next, parent;
     HANDLE self;
+    //routing hash chain
+    HANDLE hash_next;
+    //wildcard child, if any. Fallback, when name not found
+    HANDLE wildcard;
     char* name;
+    uint32_t hash;
     unsigned int flags;
+#if (WEBS_NODE_HANDLERS_MAX)
+    HANDLE handlers[WEBS_NODE_HANDLERS_MAX];
+    unsigned int handlers_count, handler_next;
+#endif //WEBS_NODE_HANDLERS_MAX
+#if (WEBS_NODE_STAT)
+    WEB_NODE_STAT stat;
+#endif //WEBS_NODE_STAT
+#if (WEBS_FILES)
+    unsigned int folder;
+#endif //WEBS_FILES
 } WEB_NODE_ITEM;
 
 typedef struct {
     HANDLE root;
+    //child lookup by (parent, name)
+    HANDLE* hash;
     SO items;
 } WEB_NODE;
 
@@ -26,7 +45,19 @@ void web_node_create(WEB_NODE* web_node);
 void web_node_destroy(WEB_NODE* web_node);
 HANDLE web_node_allocate(WEB_NODE* web_node, HANDLE parent_handle, char* name, unsigned int flags);
 void web_node_free(WEB_NODE* web_node, HANDLE handle);
-HANDLE web_node_find_path(WEB_NODE* web_node, char* url, unsigned int url_size);
+HANDLE web_node_find_path(WEB_NODE* web_node, char* url, unsigned int url_size, char** tail, unsigned int* tail_size);
 bool web_node_check_flag(WEB_NODE* web_node, HANDLE handle, unsigned int flag);
+#if (WEBS_NODE_HANDLERS_MAX)
+void web_node_add_handler(WEB_NODE* web_node, HANDLE handle, HANDLE process);
+void web_node_remove_handler(WEB_NODE* web_node, HANDLE handle, HANDLE process);
+HANDLE web_node_next_handler(WEB_NODE* web_node, HANDLE handle);
+#endif //WEBS_NODE_HANDLERS_MAX
+#if (WEBS_FILES)
+void web_node_set_folder(WEB_NODE* web_node, HANDLE handle, unsigned int folder);
+unsigned int web_node_get_folder(WEB_NODE* web_node, HANDLE handle);
+#endif //WEBS_FILES
+#if (WEBS_NODE_STAT)
+WEB_NODE_STAT* web_node_get_stat(WEB_NODE* web_node, HANDLE handle);
+#endif //WEBS_NODE_STAT
 
 #endif // WEB_NODE_H
@@ -224,6 +224,17 @@ bool web_url_to_relative(char** url, unsigned int* url_size)
     return true;
 }
 
+bool web_check_path(const char* path)
+{
+    //empty segment is volume root for vfs
+    if ((path[0] == '/') || (strstr(path, "//") != NULL))
+        return false;
+    //parent folder
+    if (strstr(path, "..") != NULL)
+        return false;
+    return true;
+}
+
 bool web_get_method(char* data, unsigned int size, WEB_METHOD* method)
 {
     int idx;
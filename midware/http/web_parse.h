@@ -40,6 +40,7 @@ void web_set_str_param(char* head, unsigned int* head_size, const char* param, c
 void web_set_int_param(char* head, unsigned int* head_size, const char* param, int value);
 void web_print(char* data, unsigned int size);
 bool web_url_to_relative(char** url, unsigned int* url_size);
+bool web_check_path(const char* path);
 bool web_get_method(char* data, unsigned int size, WEB_METHOD* method);
 bool web_get_version(const char* data, unsigned int size, HTTP_VERSION* version);
 
@@ -19,6 +19,9 @@
 #include "../../userspace/so.h"
 #include <string.h>
 #include "sys_config.h"
+#if (WEBS_FILES)
+#include "../../userspace/vfs.h"
+#endif //WEBS_FILES
 
 #if (WEBS_DEBUG_ERRORS) || (WEBS_DEBUG_SESSION) || (WEBS_DEBUG_REQUESTS) || (WEBS_DEBUG_FLOW)
 #define WEBS_DEBUG
@@ -36,10 +39,33 @@ typedef enum {
 
 typedef struct {
     IO* io;
+    //preallocated response IO, also holding user header params
+    IO* tx_io;
+    //user response. Held until response is sent
+    IO* user_io;
+    //RX buffer. Can contain few pipelined requests, current is first
     char* req;
     char* url;
-    unsigned int req_size, header_size, status_line_size, data_size, url_size, processed;
-    HANDLE conn, node_handle, self;
+    char* tx_data;
+    unsigned int req_size, req_alloc, header_size, status_line_size, data_size, url_size, tx_size, tx_processed;
+    //user IO completion command
+    unsigned int user_cmd;
+    //chunked response in progress, CRLF of last chunk not sent yet
+    bool stream, chunk_open;
+    //connection is closed after response is sent
+    bool close;
+    const char* content_type;
+#if (WEBS_FILES)
+    //static file transfer. Data is read to both session IOs and sent from them in turn
+    HANDLE file;
+    unsigned int file_left, file_reads, file_writes;
+#endif //WEBS_FILES
+    HANDLE conn, node_handle, self, process;
+    //dispatch order
+    unsigned int seq;
+#if (WEBS_NODE_STAT)
+    SYSTIME received, dispatched;
+#endif //WEBS_NODE_STAT
 #if (WEBS_SESSION_TIMEOUT_S)
     HANDLE timer;
 #endif //WEBS_SESSION_TIMEOUT_S
@@ -58,17 +84,47 @@ typedef struct {
 
 typedef struct {
     HANDLE tcpip, process, listener;
-    bool busy;
+    //requests, processed by handlers right now
+    unsigned int in_flight, seq;
     WEB_NODE web_node;
 
     ARRAY* errors;
     char* generic_error;
+#if (WEBS_FILES)
+    VFS_RECORD_TYPE vfs_record;
+#endif //WEBS_FILES
 
     SO sessions;
 } WEBS;
 
 #define HTTP_LINE_SIZE                         64
 
+#if (WEBS_FILES)
+typedef struct {
+    const char* ext;
+    const char* content_type;
+} WEBS_MIME;
+
+static const WEBS_MIME __WEBS_MIME[] =  {{"html",  "text/html"},
+                                         {"htm",   "text/html"},
+                                         {"css",   "text/css"},
+                                         {"js",    "application/javascript"},
+                                         {"json",  "application/json"},
+                                         {"txt",   "text/plain"},
+                                         {"xml",   "text/xml"},
+                                         {"png",   "image/png"},
+                                         {"jpg",   "image/jpeg"},
+                                         {"jpeg",  "image/jpeg"},
+                                         {"gif",   "image/gif"},
+                                         {"svg",   "image/svg+xml"},
+                                         {"ico",   "image/x-icon"},
+                                         {"woff",  "font/woff"},
+                                         {"woff2", "font/woff2"}};
+
+#define WEBS_MIME_COUNT                        (sizeof(__WEBS_MIME) / sizeof(WEBS_MIME))
+#define WEBS_MIME_DEFAULT                      "application/octet-stream"
+#endif //WEBS_FILES
+
 static const char* const __HTTP_REASON100[] = {"Continue",
                                                "Switching Protocols"};
 static const char* const __HTTP_REASON200[] = {"OK",
@@ -124,6 +180,8 @@ static const char* const* const __HTTP_REASONS[] =    {__HTTP_REASON100, __HTTP_
 static const unsigned int __CODE_SIZE[] =             {2, 7, 8, 27, 6};
 
 #define HTTP_STATUS_LINE_SIZE                   15
+//CRLF of previous chunk, size in hex, CRLF, CRLF of last chunk, null-terminator
+#define HTTP_CHUNK_PREFIX_SIZE                  16
 
 static inline void web_free_req(WEBS_SESSION* session)
 {
@@ -138,11 +196,14 @@ static inline void webs_init(WEBS* webs)
     webs->process = INVALID_HANDLE;
     web_node_create(&webs->web_node);
 
-    webs->busy = false;
+    webs->in_flight = webs->seq = 0;
     array_create(&webs->errors, sizeof(WEBS_ERROR), 1);
     webs->generic_error = NULL;
 
     so_create(&webs->sessions, sizeof(WEBS_SESSION), 1);
+#if (WEBS_FILES)
+    webs->vfs_record.vfs = INVALID_HANDLE;
+#endif //WEBS_FILES
 }
 
 static const char* webs_get_response_text(WEB_RESPONSE code)
@@ -157,13 +218,6 @@ static const char* webs_get_response_text(WEB_RESPONSE code)
     return __HTTP_REASONS[code / 100 - 1][code % 100];
 }
 
-static void webs_session_reset(WEBS_SESSION* session)
-{
-    web_free_req(session);
-    session->req_size = session->header_size = session->data_size = 0;
-    session->state = WEBS_SESSION_STATE_IDLE;
-}
-
 static inline WEBS_SESSION* webs_create_session(WEBS* webs)
 {
     HANDLE h;
@@ -181,11 +235,20 @@ static inline WEBS_SESSION* webs_create_session(WEBS* webs)
         return NULL;
     session->state = WEBS_SESSION_STATE_IDLE;
     session->req = NULL;
-    session->req_size = session->header_size = session->data_size = 0;
+    session->req_size = session->req_alloc = session->header_size = session->data_size = 0;
     session->io = io_create(WEBS_IO_SIZE + sizeof(TCP_STACK));
+    session->tx_io = io_create(WEBS_IO_SIZE + sizeof(TCP_STACK));
+    session->user_io = NULL;
+    session->stream = session->chunk_open = session->close = false;
+#if (WEBS_FILES)
+    session->file = INVALID_HANDLE;
+#endif //WEBS_FILES
     session->self = h;
-    if (session->io == NULL)
+    session->process = INVALID_HANDLE;
+    if (session->io == NULL || session->tx_io == NULL)
     {
+        io_destroy(session->io);
+        io_destroy(session->tx_io);
         so_free(&webs->sessions, h);
         return NULL;
     }
@@ -196,15 +259,101 @@ static inline WEBS_SESSION* webs_create_session(WEBS* webs)
 }
 
 
+static void webs_dispatch(WEBS* webs, WEBS_SESSION* session)
+{
+#if (WEBS_NODE_STAT)
+    WEB_NODE_STAT* stat;
+    unsigned int us;
+#endif //WEBS_NODE_STAT
+    session->process = INVALID_HANDLE;
+#if (WEBS_NODE_HANDLERS_MAX)
+    session->process = web_node_next_handler(&webs->web_node, session->node_handle);
+#endif //WEBS_NODE_HANDLERS_MAX
+    if (session->process == INVALID_HANDLE)
+        session->process = webs->process;
+#if (WEBS_NODE_STAT)
+    //node can be destroyed, while request is queued
+    if ((stat = web_node_get_stat(&webs->web_node, session->node_handle)) != NULL)
+    {
+        us = systime_elapsed_us(&session->received);
+        ++stat->requests;
+        stat->queue_us_total += us;
+        if (us > stat->queue_us_max)
+            stat->queue_us_max = us;
+    }
+    get_uptime(&session->dispatched);
+#endif //WEBS_NODE_STAT
+    ++webs->in_flight;
+    session->state = WEBS_SESSION_STATE_REQUEST;
+    //pipelined requests can follow in buffer: size of current one only
+    ipc_post_inline(session->process, HAL_CMD(HAL_WEBS, (WEBS_GET + session->method)), session->self, session->node_handle,
+                    session->header_size + session->data_size);
+}
+
+static void webs_dispatch_pending(WEBS* webs)
+{
+    HANDLE h;
+    WEBS_SESSION* cur_session;
+    WEBS_SESSION* first;
+    //closing
+    if (webs->process == INVALID_HANDLE)
+        return;
+    while (webs->in_flight < WEBS_DISPATCH_WINDOW)
+    {
+        first = NULL;
+        for (h = so_first(&webs->sessions); h != INVALID_HANDLE; h = so_next(&webs->sessions, h))
+        {
+            cur_session = so_get(&webs->sessions, h);
+            if ((cur_session->state == WEBS_SESSION_STATE_PENDING) && ((first == NULL) || ((int)(cur_session->seq - first->seq) < 0)))
+                first = cur_session;
+        }
+        if (first == NULL)
+            return;
+        webs_dispatch(webs, first);
+    }
+}
+
+static void webs_request_complete(WEBS* webs, WEBS_SESSION* session)
+{
+#if (WEBS_NODE_STAT)
+    WEB_NODE_STAT* stat;
+    unsigned int us;
+    if ((stat = web_node_get_stat(&webs->web_node, session->node_handle)) != NULL)
+    {
+        us = systime_elapsed_us(&session->dispatched);
+        stat->service_us_total += us;
+        if (us > stat->service_us_max)
+            stat->service_us_max = us;
+    }
+#endif //WEBS_NODE_STAT
+    --webs->in_flight;
+    //response is on the way
+    session->state = WEBS_SESSION_STATE_TX;
+}
+
 static void webs_destroy_session(WEBS* webs, WEBS_SESSION* session)
 {
+    bool in_flight = (session->state == WEBS_SESSION_STATE_REQUEST);
     web_free_req(session);
 #if (WEBS_SESSION_TIMEOUT_S)
     timer_stop(session->timer, session->self, HAL_WEBS);
     timer_destroy(session->timer);
 #endif //WEBS_SESSION_TIMEOUT_S
+    if (session->user_io != NULL)
+        io_complete_ex(session->process, HAL_IO_CMD(HAL_WEBS, session->user_cmd), session->self, session->user_io, ERROR_CONNECTION_CLOSED);
+#if (WEBS_FILES)
+    if (session->file != INVALID_HANDLE)
+        vfs_close(&webs->vfs_record, session->file);
+#endif //WEBS_FILES
     io_destroy(session->io);
+    io_destroy(session->tx_io);
     so_free(&webs->sessions, session->self);
+    //handler response will be ignored, free window slot
+    if (in_flight)
+    {
+        --webs->in_flight;
+        webs_dispatch_pending(webs);
+    }
 }
 
 static inline void webs_open_session(WEBS* webs, HANDLE conn)
@@ -271,64 +420,81 @@ static void webs_out_of_memory(WEBS* webs, WEBS_SESSION* session)
 static void webs_tx(WEBS* webs, WEBS_SESSION* session)
 {
     TCP_STACK* tcp_stack;
-    tcp_stack = io_push(session->io, sizeof(TCP_STACK));
-    session->io->data_size = WEBS_IO_SIZE;
-    if (session->req_size - session->processed < WEBS_IO_SIZE)
-    {
-        tcp_stack->flags = 0;
-        session->io->data_size = session->req_size - session->processed;
-    }
-    else
-        tcp_stack->flags = TCP_PSH;
-    memcpy(io_data(session->io), session->req + session->processed, session->io->data_size);
-    tcp_write(webs->tcpip, session->conn, session->io);
+    unsigned int size;
+    //first chunk is following header
+    size = session->tx_size - session->tx_processed;
+    if (size > WEBS_IO_SIZE - session->tx_io->data_size)
+        size = WEBS_IO_SIZE - session->tx_io->data_size;
+    memcpy((uint8_t*)io_data(session->tx_io) + session->tx_io->data_size, session->tx_data + session->tx_processed, size);
+    session->tx_io->data_size += size;
+    session->tx_processed += size;
+    tcp_stack = io_push(session->tx_io, sizeof(TCP_STACK));
+    //push on response end
+    tcp_stack->flags = session->tx_processed >= session->tx_size ? TCP_PSH : 0;
+    tcp_write(webs->tcpip, session->conn, session->tx_io);
 }
 
-static inline void webs_generate_params(WEBS_SESSION* session, unsigned int response_size)
+static inline void webs_generate_params(WEBS_SESSION* session, WEB_RESPONSE code, unsigned int response_size)
 {
     //header
-    web_set_str_param(io_data(session->io), &session->io->data_size, "server", "RExOS");
+    web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "server", "RExOS");
 
-    if (response_size)
+    if (session->stream)
     {
-        web_set_int_param(io_data(session->io), &session->io->data_size, "content-length", response_size);
-        web_set_str_param(io_data(session->io), &session->io->data_size, "content-type", "text/html");
+        //HTTP/1.0 stream is terminated by connection close
+        if (session->version >= HTTP_1_1)
+            web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "transfer-encoding", "chunked");
+        web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "content-type", session->content_type);
+    }
+    else
+    {
+        //without body length client can't find response end on persistent connection. 1xx, 204, 304 has no body by RFC 7230
+        if (response_size || ((code >= WEB_RESPONSE_OK) && (code != WEB_RESPONSE_NO_CONTENT) && (code != WEB_RESPONSE_NOT_MODIFIED)))
+            web_set_int_param(io_data(session->tx_io), &session->tx_io->data_size, "content-length", response_size);
+        if (response_size)
+            web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "content-type", session->content_type);
     }
 }
 
-static void webs_send_response(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE code, char* data, unsigned int data_size)
+static bool webs_tx_header(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE code, unsigned int data_size)
 {
-    unsigned int header_size, status_line_size;
+    unsigned int status_line_size;
+    char status_line[HTTP_LINE_SIZE];
 
     status_line_size = HTTP_STATUS_LINE_SIZE + strlen(webs_get_response_text(code));
-    webs_generate_params(session, data_size);
-    header_size = status_line_size + session->io->data_size + 2;
-    web_free_req(session);
-    session->req = malloc(header_size + data_size);
-
-    if (session->req == NULL)
+    webs_generate_params(session, code, data_size);
+    //header is generated in place, before response data. Left space for first chunk size
+    if (status_line_size + session->tx_io->data_size + 2 + HTTP_CHUNK_PREFIX_SIZE > WEBS_IO_SIZE)
     {
         webs_out_of_memory(webs, session);
-        return;
+        return false;
     }
 
-    //status line
-    sprintf(session->req, "HTTP/%d.%d %d %s\r\n", session->version >> 4, session->version & 0xf, code, webs_get_response_text(code));
-
-    //header, generated in io
-    memcpy(session->req + status_line_size, io_data(session->io), session->io->data_size);
-    sprintf(session->req + status_line_size + session->io->data_size, "\r\n");
-    memcpy(session->req + header_size, data, data_size);
-    session->req_size = header_size + data_size;
-    session->processed = 0;
-    session->state = WEBS_SESSION_STATE_TX;
+    //status line before user params
+    sprintf(status_line, "HTTP/%d.%d %d %s\r\n", session->version >> 4, session->version & 0xf, code, webs_get_response_text(code));
+    memmove((uint8_t*)io_data(session->tx_io) + status_line_size, io_data(session->tx_io), session->tx_io->data_size);
+    memcpy(io_data(session->tx_io), status_line, status_line_size);
+    session->tx_io->data_size += status_line_size;
+    memcpy((uint8_t*)io_data(session->tx_io) + session->tx_io->data_size, "\r\n", 2);
+    session->tx_io->data_size += 2;
 
 #if (WEBS_DEBUG_REQUESTS)
     printf("WEBS: %d %s\n", code, webs_get_response_text(code));
 #endif //WEBS_DEBUG_REQUESTS
+    return true;
+}
+
+static void webs_tx_data(WEBS* webs, WEBS_SESSION* session, char* data, unsigned int data_size)
+{
+    session->tx_data = data;
+    session->tx_size = data_size;
+    session->tx_processed = 0;
+    session->state = WEBS_SESSION_STATE_TX;
+
 #if (WEBS_DEBUG_FLOW)
     printf("WEBS TX:\n");
-    web_print(session->req, session->req_size);
+    web_print(io_data(session->tx_io), session->tx_io->data_size);
+    web_print(data, data_size);
 #endif //WEBS_DEBUG_FLOW
 
 #if (WEBS_SESSION_TIMEOUT_S)
@@ -339,6 +505,37 @@ static void webs_send_response(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE c
     webs_tx(webs, session);
 }
 
+static void webs_send_response(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE code, char* data, unsigned int data_size)
+{
+    if (webs_tx_header(webs, session, code, data_size))
+        webs_tx_data(webs, session, data, data_size);
+}
+
+static void webs_send_chunk(WEBS* webs, WEBS_SESSION* session, char* data, unsigned int data_size)
+{
+    char* prefix;
+    if (session->version >= HTTP_1_1)
+    {
+        prefix = (char*)io_data(session->tx_io) + session->tx_io->data_size;
+        //CRLF of previous chunk is sent with next one, so user data is not touched
+        if (session->chunk_open)
+        {
+            memcpy(prefix, "\r\n", 2);
+            prefix += 2;
+        }
+        if (data_size)
+            sprintf(prefix, "%x\r\n", data_size);
+        else
+            strcpy(prefix, "0\r\n\r\n");
+        session->tx_io->data_size += (session->chunk_open ? 2 : 0) + strlen(prefix);
+        session->chunk_open = (data_size != 0);
+    }
+    //last chunk
+    if (data_size == 0)
+        session->stream = false;
+    webs_tx_data(webs, session, data, data_size);
+}
+
 static char* webs_get_error_html(WEBS* webs, WEB_RESPONSE code)
 {
     int i;
@@ -360,10 +557,19 @@ static void webs_respond_error(WEBS* webs, WEBS_SESSION* session, WEB_RESPONSE c
     if (html == NULL)
     {
         //no generic error set
-        webs_destroy_session(webs, session);
+        webs_close_session(webs, session);
         return;
     }
-    webs_session_reset(session);
+    //current request is consumed by webs_session_next after response is sent, pipelined are kept
+    if (code == WEB_RESPONSE_PAYLOAD_TOO_LARGE)
+    {
+        //request boundary is lost, rest of stream can't be parsed
+        session->req_size = session->header_size = session->data_size = 0;
+        session->close = true;
+    }
+    io_reset(session->tx_io);
+    //file content type can be already set
+    session->content_type = "text/html";
     webs_send_response(webs, session, code, html, strlen(html));
 }
 
@@ -395,6 +601,8 @@ static inline void webs_close(WEBS* webs, HANDLE process)
         error(ERROR_NOT_CONFIGURED);
         return;
     }
+    //no more dispatching of pending requests
+    webs->process = INVALID_HANDLE;
 
     for (h = so_first(&webs->sessions); h != INVALID_HANDLE; h = so_next(&webs->sessions, h))
     {
@@ -402,7 +610,6 @@ static inline void webs_close(WEBS* webs, HANDLE process)
         webs_close_session(webs, session);
     }
     tcp_close_listen(webs->tcpip, webs->listener);
-    webs->process = INVALID_HANDLE;
 }
 
 static inline void webs_user_read(WEBS* webs, WEBS_SESSION* session, IO* io)
@@ -419,27 +626,61 @@ static inline void webs_user_read(WEBS* webs, WEBS_SESSION* session, IO* io)
 
 static inline void webs_user_write(WEBS* webs, WEBS_SESSION* session, IO* io)
 {
-    WEBS_SESSION* cur_session;
-    HANDLE h;
     WEB_RESPONSE code = *((WEB_RESPONSE*)io_stack(io));
     io_pop(io, sizeof(WEB_RESPONSE));
 
-    webs->busy = false;
+    webs_request_complete(webs, session);
     //switch to next req (if any)
-    for (h = so_first(&webs->sessions); h != INVALID_HANDLE; h = so_next(&webs->sessions, h))
+    webs_dispatch_pending(webs);
+
+    //user IO is held until response is sent
+    session->user_io = io;
+    session->user_cmd = IPC_WRITE;
+    webs_send_response(webs, session, code, io_data(io), io->data_size);
+    error(ERROR_SYNC);
+}
+
+static inline void webs_user_write_chunk(WEBS* webs, WEBS_SESSION* session, IO* io)
+{
+    WEB_RESPONSE code = *((WEB_RESPONSE*)io_stack(io));
+    bool first = (session->state == WEBS_SESSION_STATE_REQUEST);
+    io_pop(io, sizeof(WEB_RESPONSE));
+
+    if (first)
     {
-        cur_session = so_get(&webs->sessions, h);
-        if (cur_session->state == WEBS_SESSION_STATE_PENDING)
+        //first chunk is following header
+        webs_request_complete(webs, session);
+        webs_dispatch_pending(webs);
+        session->stream = true;
+        session->chunk_open = false;
+        if (!webs_tx_header(webs, session, code, 0))
         {
-            webs->busy = true;
-            cur_session->state = WEBS_SESSION_STATE_REQUEST;
-            ipc_post_inline(webs->process, HAL_CMD(HAL_WEBS, (WEBS_GET + cur_session->method)), cur_session->self,
-                            cur_session->node_handle, cur_session->req_size);
-            break;
+            error(ERROR_CONNECTION_CLOSED);
+            return;
         }
     }
+    //previous chunk must be sent
+    else if (!session->stream || session->user_io != NULL)
+    {
+        error(ERROR_INVALID_STATE);
+        return;
+    }
+    if ((io->data_size == 0) && (session->version < HTTP_1_1))
+    {
+        //no transfer encoding for HTTP/1.0, end of data is connection close
+        if (!first)
+        {
+            webs_close_session(webs, session);
+            return;
+        }
+        //header is not sent yet, close after it
+        session->close = true;
+    }
 
-    webs_send_response(webs, session, code, io_data(io), io->data_size);
+    session->user_io = io;
+    session->user_cmd = WEBS_WRITE_CHUNK;
+    webs_send_chunk(webs, session, io_data(io), io->data_size);
+    error(ERROR_SYNC);
 }
 
 static inline void webs_create_node(WEBS* webs, HANDLE process, HANDLE parent, IO* io, unsigned int flags)
@@ -506,6 +747,72 @@ static inline void webs_unregister_error(WEBS* webs, int code)
     error(ERROR_NOT_CONFIGURED);
 }
 
+static inline void webs_register_handler(WEBS* webs, HANDLE node, HANDLE process)
+{
+#if (WEBS_NODE_HANDLERS_MAX)
+    web_node_add_handler(&webs->web_node, node, process);
+#else
+    error(ERROR_NOT_SUPPORTED);
+#endif //WEBS_NODE_HANDLERS_MAX
+}
+
+static inline void webs_unregister_handler(WEBS* webs, HANDLE node, HANDLE process)
+{
+#if (WEBS_NODE_HANDLERS_MAX)
+    web_node_remove_handler(&webs->web_node, node, process);
+#else
+    error(ERROR_NOT_SUPPORTED);
+#endif //WEBS_NODE_HANDLERS_MAX
+}
+
+static inline void webs_get_node_stat(WEBS* webs, HANDLE process, HANDLE node, IO* io)
+{
+#if (WEBS_NODE_STAT)
+    WEB_NODE_STAT* stat;
+    io->data_size = 0;
+    if ((stat = web_node_get_stat(&webs->web_node, node)) == NULL)
+    {
+        error(ERROR_NOT_FOUND);
+        return;
+    }
+    if (io_get_free(io) < sizeof(WEB_NODE_STAT))
+    {
+        error(ERROR_IO_BUFFER_TOO_SMALL);
+        return;
+    }
+    memcpy(io_data(io), stat, sizeof(WEB_NODE_STAT));
+    io->data_size = sizeof(WEB_NODE_STAT);
+    io_complete(process, HAL_IO_CMD(HAL_WEBS, WEBS_GET_NODE_STAT), node, io);
+    error(ERROR_SYNC);
+#else
+    error(ERROR_NOT_SUPPORTED);
+#endif //WEBS_NODE_STAT
+}
+
+static inline void webs_set_folder(WEBS* webs, HANDLE node, HANDLE vfs, unsigned int folder)
+{
+#if (WEBS_FILES)
+    if (!web_node_check_flag(&webs->web_node, node, WEB_FLAG_FILES))
+    {
+        error(ERROR_INVALID_PARAMS);
+        return;
+    }
+    if (webs->vfs_record.vfs == INVALID_HANDLE)
+    {
+        if (!vfs_record_create(vfs, &webs->vfs_record))
+            return;
+    }
+    else if (webs->vfs_record.vfs != vfs)
+    {
+        error(ERROR_ALREADY_CONFIGURED);
+        return;
+    }
+    web_node_set_folder(&webs->web_node, node, folder);
+#else
+    error(ERROR_NOT_SUPPORTED);
+#endif //WEBS_FILES
+}
+
 static inline void webs_get_param(WEBS* webs, WEBS_SESSION* session, IO* io)
 {
     unsigned int size;
@@ -526,7 +833,7 @@ static inline void webs_get_param(WEBS* webs, WEBS_SESSION* session, IO* io)
     memcpy(io_data(io), param, size);
     ((uint8_t*)io_data(io))[size] = 0;
     io->data_size = size + 1;
-    io_complete(webs->process, HAL_IO_CMD(HAL_WEBS, WEBS_GET_PARAM), session->self, io);
+    io_complete(session->process, HAL_IO_CMD(HAL_WEBS, WEBS_GET_PARAM), session->self, io);
     error(ERROR_SYNC);
 }
 
@@ -537,7 +844,7 @@ static inline void webs_set_param(WEBS* webs, WEBS_SESSION* session, IO* io)
 
     param = io_data(io);
     value = param + strlen(param) + 1;
-    web_set_str_param(io_data(session->io), &session->io->data_size, param, value);
+    web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, param, value);
 }
 
 static inline void webs_get_url(WEBS* webs, WEBS_SESSION* session, IO* io)
@@ -551,7 +858,7 @@ static inline void webs_get_url(WEBS* webs, WEBS_SESSION* session, IO* io)
     memcpy(io_data(io), session->url, session->url_size);
     ((uint8_t*)io_data(io))[session->url_size] = 0;
     io->data_size = session->url_size + 1;
-    io_complete(webs->process, HAL_IO_CMD(HAL_WEBS, WEBS_GET_URL), session->self, io);
+    io_complete(session->process, HAL_IO_CMD(HAL_WEBS, WEBS_GET_URL), session->self, io);
     error(ERROR_SYNC);
 }
 
@@ -571,14 +878,21 @@ static inline void webs_session_request(WEBS* webs, IPC* ipc)
         printf("WEBS: session timeout\n");
 #endif //WEBS_DEBUG_SESSION
         webs_close_session(webs, session);
+        return;
     }
-    else
 #endif //WEBS_SESSION_TIMEOUT_S
-        if (session->state != WEBS_SESSION_STATE_REQUEST)
-        {
-            error(ERROR_INVALID_STATE);
-            return;
-        }
+    //only process, request is dispatched to, can access session
+    if (ipc->process != session->process)
+    {
+        error(ERROR_ACCESS_DENIED);
+        return;
+    }
+    //streaming response is checked separately
+    if ((session->state != WEBS_SESSION_STATE_REQUEST) && (HAL_ITEM(ipc->cmd) != WEBS_WRITE_CHUNK))
+    {
+        error(ERROR_INVALID_STATE);
+        return;
+    }
 
     switch (HAL_ITEM(ipc->cmd))
     {
@@ -588,6 +902,9 @@ static inline void webs_session_request(WEBS* webs, IPC* ipc)
     case IPC_WRITE:
         webs_user_write(webs, session, (IO*)ipc->param2);
         break;
+    case WEBS_WRITE_CHUNK:
+        webs_user_write_chunk(webs, session, (IO*)ipc->param2);
+        break;
     case WEBS_GET_PARAM:
         webs_get_param(webs, session, (IO*)ipc->param2);
         break;
@@ -624,17 +941,296 @@ static inline void webs_request(WEBS* webs, IPC* ipc)
     case WEBS_UNREGISTER_RESPONSE:
         webs_unregister_error(webs, (int)ipc->param1);
         break;
+    case WEBS_REGISTER_HANDLER:
+        webs_register_handler(webs, (HANDLE)ipc->param1, (HANDLE)ipc->param2);
+        break;
+    case WEBS_UNREGISTER_HANDLER:
+        webs_unregister_handler(webs, (HANDLE)ipc->param1, (HANDLE)ipc->param2);
+        break;
+    case WEBS_GET_NODE_STAT:
+        webs_get_node_stat(webs, ipc->process, (HANDLE)ipc->param1, (IO*)ipc->param2);
+        break;
+    case WEBS_SET_FOLDER:
+        webs_set_folder(webs, (HANDLE)ipc->param1, (HANDLE)ipc->param2, ipc->param3);
+        break;
     default:
         webs_session_request(webs, ipc);
     }
 }
 
+#if (WEBS_FILES)
+static const char* webs_file_content_type(const char* name)
+{
+    unsigned int i;
+    const char* ext = strrchr(name, '.');
+    if (ext == NULL)
+        return WEBS_MIME_DEFAULT;
+    ++ext;
+    for (i = 0; i < WEBS_MIME_COUNT; ++i)
+    {
+        if (web_stricmp(ext, strlen(ext), __WEBS_MIME[i].ext) && (__WEBS_MIME[i].ext[strlen(ext)] == 0))
+            return __WEBS_MIME[i].content_type;
+    }
+    return WEBS_MIME_DEFAULT;
+}
+
+static bool webs_file_find(WEBS* webs, char* file, VFS_FIND_TYPE* find)
+{
+    HANDLE h;
+    VFS_FIND_TYPE* cur;
+    bool res = false;
+    unsigned int len = strlen(file);
+    if ((h = vfs_find_first(&webs->vfs_record)) == INVALID_HANDLE)
+        return false;
+    while (vfs_find_next(&webs->vfs_record, h))
+    {
+        cur = io_data(webs->vfs_record.io);
+        if (web_stricmp(file, len, cur->name) && (cur->name[len] == 0))
+        {
+            find->item = cur->item;
+            find->size = cur->size;
+            find->attr = cur->attr;
+            res = true;
+            break;
+        }
+    }
+    vfs_find_close(&webs->vfs_record, h);
+    return res;
+}
+
+static bool webs_file_if_none_match(WEBS_SESSION* session, const char* etag)
+{
+    char* str;
+    unsigned int size, len, etag_len;
+    str = web_get_str_param(session->req, session->header_size, "if-none-match", &size);
+    if (str == NULL)
+        return false;
+    etag_len = strlen(etag);
+    //list of etags, comma separated
+    while (size)
+    {
+        len = web_get_word(str, size, ',');
+        if ((len == 1) && (str[0] == '*'))
+            return true;
+        if ((len == etag_len) && (memcmp(str, etag, len) == 0))
+            return true;
+        if (len >= size)
+            break;
+        str += len + 1;
+        size -= len + 1;
+        while (size && (str[0] == ' '))
+        {
+            ++str;
+            --size;
+        }
+    }
+    return false;
+}
+
+//0: no range or not supported, serve whole file. -1: not satisfiable
+static int webs_file_range(WEBS_SESSION* session, unsigned int file_size, unsigned int* from, unsigned int* to)
+{
+    char* str;
+    unsigned int size, pos, n;
+    str = web_get_str_param(session->req, session->header_size, "range", &size);
+    if (str == NULL)
+        return 0;
+    if ((size < 6) || !web_stricmp(str, 6, "bytes="))
+        return 0;
+    str += 6;
+    size -= 6;
+    //multiple ranges are not supported
+    if (memchr(str, ',', size) != NULL)
+        return 0;
+    pos = web_get_word(str, size, '-');
+    if (pos >= size)
+        return 0;
+    //suffix: last n bytes
+    if (pos == 0)
+    {
+        if (!web_atou(str + 1, size - 1, &n))
+            return 0;
+        if ((n == 0) || (file_size == 0))
+            return -1;
+        *from = n < file_size ? file_size - n : 0;
+        *to = file_size - 1;
+        return 1;
+    }
+    if (!web_atou(str, pos, from))
+        return 0;
+    *to = file_size - 1;
+    if (pos + 1 < size)
+    {
+        if (!web_atou(str + pos + 1, size - pos - 1, &n))
+            return 0;
+        if (n < *to)
+            *to = n;
+    }
+    if ((*from >= file_size) || (*from > *to))
+        return -1;
+    return 1;
+}
+
+static void webs_file_read(WEBS* webs, WEBS_SESSION* session, IO* io)
+{
+    unsigned int size = session->file_left;
+    if (size > WEBS_IO_SIZE)
+        size = WEBS_IO_SIZE;
+    session->file_left -= size;
+    ++session->file_reads;
+    //sectors are read by vfs directly to IO, that will be sent to TCP
+    vfs_read(&webs->vfs_record, session->file, io, size);
+}
+
+static void webs_file_request(WEBS* webs, WEBS_SESSION* session, char* path, unsigned int path_size)
+{
+    char* name;
+    char* file;
+    char* cur;
+    char etag[24];
+    char content_range[48];
+    VFS_FIND_TYPE find;
+    TCP_STACK* tcp_stack;
+    unsigned int from, to;
+    int range;
+    WEB_RESPONSE code;
+
+    //query is not part of file path
+    if ((cur = memchr(path, '?', path_size)) != NULL)
+        path_size = cur - path;
+    if (path_size + sizeof(WEBS_INDEX_FILE) > VFS_MAX_FILE_PATH + 1)
+    {
+        webs_respond_error(webs, session, WEB_RESPONSE_URI_TOO_LONG);
+        return;
+    }
+    //RX IO is not used, while request is processed
+    name = io_data(session->io);
+    memcpy(name, path, path_size);
+    name[path_size] = 0;
+    //tailing slashes are already removed from url
+    if (path_size == 0)
+        strcat(name, WEBS_INDEX_FILE);
+    //don't allow to leave node folder
+    if (!web_check_path(name))
+    {
+        webs_respond_error(webs, session, WEB_RESPONSE_FORBIDDEN);
+        return;
+    }
+
+    vfs_cd(&webs->vfs_record, web_node_get_folder(&webs->web_node, session->node_handle));
+    file = name;
+    if ((cur = strrchr(name, '/')) != NULL)
+    {
+        *cur = 0;
+        file = cur + 1;
+        if (!vfs_cd_path(&webs->vfs_record, name))
+        {
+            webs_respond_error(webs, session, WEB_RESPONSE_NOT_FOUND);
+            return;
+        }
+    }
+    if (!webs_file_find(webs, file, &find))
+    {
+        webs_respond_error(webs, session, WEB_RESPONSE_NOT_FOUND);
+        return;
+    }
+    //folder requested, serve it's index
+    if (find.attr & VFS_ATTR_FOLDER)
+    {
+        vfs_cd(&webs->vfs_record, find.item);
+        file = WEBS_INDEX_FILE;
+        if (!webs_file_find(webs, file, &find) || (find.attr & VFS_ATTR_FOLDER))
+        {
+            webs_respond_error(webs, session, WEB_RESPONSE_NOT_FOUND);
+            return;
+        }
+    }
+    session->content_type = webs_file_content_type(file);
+
+    //no modification time in vfs, first cluster and size are identifying file content
+    sprintf(etag, "\"%x-%x\"", find.item, find.size);
+    web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "etag", etag);
+    if (webs_file_if_none_match(session, etag))
+    {
+        webs_send_response(webs, session, WEB_RESPONSE_NOT_MODIFIED, NULL, 0);
+        return;
+    }
+    web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "accept-ranges", "bytes");
+
+    code = WEB_RESPONSE_OK;
+    from = 0;
+    to = find.size - 1;
+    range = webs_file_range(session, find.size, &from, &to);
+    if (range < 0)
+    {
+        sprintf(content_range, "bytes */%u", find.size);
+        web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "content-range", content_range);
+        webs_send_response(webs, session, WEB_RESPONSE_RANGE_NOT_SATISFIABLE, NULL, 0);
+        return;
+    }
+    if (range > 0)
+    {
+        code = WEB_RESPONSE_PARTIAL_CONTENT;
+        sprintf(content_range, "bytes %u-%u/%u", from, to, find.size);
+        web_set_str_param(io_data(session->tx_io), &session->tx_io->data_size, "content-range", content_range);
+    }
+
+    if (find.size && (session->method == WEB_METHOD_GET))
+    {
+        //relative to current folder, already changed
+        session->file = vfs_open(&webs->vfs_record, file, VFS_MODE_READ);
+        if (session->file == INVALID_HANDLE)
+        {
+            webs_respond_error(webs, session, WEB_RESPONSE_INTERNAL_SERVER_ERROR);
+            return;
+        }
+        if (from && !vfs_seek(&webs->vfs_record, session->file, from))
+        {
+            vfs_close(&webs->vfs_record, session->file);
+            session->file = INVALID_HANDLE;
+            webs_respond_error(webs, session, WEB_RESPONSE_INTERNAL_SERVER_ERROR);
+            return;
+        }
+    }
+
+    if (!webs_tx_header(webs, session, code, find.size ? to - from + 1 : 0))
+        return;
+    //HEAD or empty file
+    if (session->file == INVALID_HANDLE)
+    {
+        webs_tx_data(webs, session, NULL, 0);
+        return;
+    }
+
+#if (WEBS_DEBUG_FLOW)
+    printf("WEBS TX:\n");
+    web_print(io_data(session->tx_io), session->tx_io->data_size);
+#endif //WEBS_DEBUG_FLOW
+#if (WEBS_SESSION_TIMEOUT_S)
+    timer_stop(session->timer, session->self, HAL_WEBS);
+    timer_start_ms(session->timer, WEBS_SESSION_TIMEOUT_S * 1000);
+#endif //WEBS_SESSION_TIMEOUT_S
+
+    session->state = WEBS_SESSION_STATE_TX;
+    session->file_left = to - from + 1;
+    session->file_reads = 0;
+    session->file_writes = 1;
+    tcp_stack = io_push(session->tx_io, sizeof(TCP_STACK));
+    tcp_stack->flags = 0;
+    tcp_write(webs->tcpip, session->conn, session->tx_io);
+    webs_file_read(webs, session, session->io);
+}
+#endif //WEBS_FILES
+
 static inline void webs_req_received(WEBS* webs, WEBS_SESSION* session)
 {
     char* str;
     unsigned int pos, size;
+    char* tail;
+    unsigned int tail_size;
     do {
-        io_reset(session->io);
+        io_reset(session->tx_io);
+        session->content_type = "text/html";
         //parse status line
         //<METHOD> <URL> HTTP/<VERSION>
         str = session->req;
@@ -675,7 +1271,7 @@ static inline void webs_req_received(WEBS* webs, WEBS_SESSION* session)
 #endif //WEBS_DEBUG_REQUESTS
 
         //check url path and method
-        session->node_handle = web_node_find_path(&webs->web_node, session->url, session->url_size);
+        session->node_handle = web_node_find_path(&webs->web_node, session->url, session->url_size, &tail, &tail_size);
         if (session->node_handle == INVALID_HANDLE)
         {
             webs_respond_error(webs, session, WEB_RESPONSE_NOT_FOUND);
@@ -686,22 +1282,70 @@ static inline void webs_req_received(WEBS* webs, WEBS_SESSION* session)
             webs_respond_error(webs, session, WEB_RESPONSE_METHOD_NOT_ALLOWED);
             return;
         }
-
-        if (webs->busy)
-            session->state = WEBS_SESSION_STATE_PENDING;
-        else
+#if (WEBS_FILES)
+        //served without application
+        if (web_node_check_flag(&webs->web_node, session->node_handle, WEB_FLAG_FILES))
         {
-            webs->busy = true;
-            session->state = WEBS_SESSION_STATE_REQUEST;
-            ipc_post_inline(webs->process, HAL_CMD(HAL_WEBS, (WEBS_GET + session->method)), session->self, session->node_handle, session->req_size);
+            webs_file_request(webs, session, tail, tail_size);
+            return;
         }
+#endif //WEBS_FILES
+
+#if (WEBS_NODE_STAT)
+        get_uptime(&session->received);
+#endif //WEBS_NODE_STAT
+        //queue and dispatch, if window allows
+        session->state = WEBS_SESSION_STATE_PENDING;
+        session->seq = webs->seq++;
+        webs_dispatch_pending(webs);
         return;
     } while (false);
     webs_respond_error(webs, session, WEB_RESPONSE_BAD_REQUEST);
 }
 
+static void webs_session_parse(WEBS* webs, WEBS_SESSION* session)
+{
+    //Header ends with double CRLF
+    if (session->header_size == 0)
+    {
+        session->header_size = web_get_header_size(session->req, session->req_size);
+        //still no header received
+        if (session->header_size == 0)
+        {
+            tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
+            return;
+        }
+        session->status_line_size = web_get_line_size(session->req, session->header_size);
+        session->data_size = web_get_int_param(session->req + session->status_line_size, session->header_size - session->status_line_size, "content-length");
+    }
+
+    //Make sure all data received
+    if (session->header_size + session->data_size > session->req_size)
+    {
+        if (session->header_size + session->data_size > WEBS_MAX_PAYLOAD)
+        {
+            webs_respond_error(webs, session, WEB_RESPONSE_PAYLOAD_TOO_LARGE);
+            return;
+        }
+        tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
+        return;
+    }
+
+#if (WEBS_DEBUG_FLOW)
+    printf("WEBS RX:\n");
+    web_print(session->req, session->header_size + session->data_size);
+#endif //WEBS_DEBUG_FLOW
+
+#if (WEBS_SESSION_TIMEOUT_S)
+    timer_stop(session->timer, session->self, HAL_WEBS);
+#endif //WEBS_SESSION_TIMEOUT_S
+
+    webs_req_received(webs, session);
+}
+
 static inline void webs_session_rx(WEBS* webs, WEBS_SESSION* session, int size)
 {
+    char* req;
     if (size < 0)
     {
         //any error will cause connection termination
@@ -721,67 +1365,136 @@ static inline void webs_session_rx(WEBS* webs, WEBS_SESSION* session, int size)
         return;
     }
 
-    switch (session->state)
+    if ((session->state != WEBS_SESSION_STATE_IDLE) && (session->state != WEBS_SESSION_STATE_RX))
     {
-    case WEBS_SESSION_STATE_IDLE:
-        session->req = malloc(size);
-        session->state = WEBS_SESSION_STATE_RX;
-        break;
-    case WEBS_SESSION_STATE_RX:
-        session->req = realloc(session->req, session->req_size + size);
-        break;
-    default:
 #if (WEBS_DEBUG_ERRORS)
         printf("WEBS: Invalid session state on RX: %d\n", session->state);
 #endif //WEBS_DEBUG_ERRORS
         webs_close_session(webs, session);
         return;
     }
+    session->state = WEBS_SESSION_STATE_RX;
 
-    if (session->req == NULL)
+    //RX buffer is growing only, so keep-alive requests of same size are not allocating
+    if (session->req_size + session->io->data_size > session->req_alloc)
     {
-        webs_out_of_memory(webs, session);
-        return;
+        if (session->req == NULL)
+            req = malloc(session->req_size + session->io->data_size);
+        else
+            req = realloc(session->req, session->req_size + session->io->data_size);
+        if (req == NULL)
+        {
+            webs_out_of_memory(webs, session);
+            return;
+        }
+        session->req = req;
+        session->req_alloc = session->req_size + session->io->data_size;
     }
 
     memcpy(session->req + session->req_size, io_data(session->io), session->io->data_size);
     session->req_size += session->io->data_size;
 
-    //Header ends with double CRLF
-    if (session->header_size == 0)
+    webs_session_parse(webs, session);
+}
+
+#if (WEBS_SESSION_TIMEOUT_S)
+static void webs_session_next(WEBS* webs, WEBS_SESSION* session)
+{
+    unsigned int size = session->header_size + session->data_size;
+    //pipelined requests are already in buffer, process them without TCP round trip
+    session->req_size -= size;
+    memmove(session->req, session->req + size, session->req_size);
+    session->header_size = session->data_size = 0;
+    io_reset(session->tx_io);
+    if (session->req_size)
     {
-        session->header_size = web_get_header_size(session->req, session->req_size);
-        //still no header received
-        if (session->header_size == 0)
-        {
-            tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
-            return;
-        }
+        session->state = WEBS_SESSION_STATE_RX;
+        webs_session_parse(webs, session);
     }
-
-    session->status_line_size = web_get_line_size(session->req, session->header_size);
-    //Make sure all data received
-    if (session->data_size == 0)
-        session->data_size = web_get_int_param(session->req + session->status_line_size, session->header_size, "content-length");
-    if (session->data_size + session->header_size < session->req_size)
+    else
     {
+        session->state = WEBS_SESSION_STATE_IDLE;
         tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
-        return;
     }
+}
+#endif //WEBS_SESSION_TIMEOUT_S
 
-#if (WEBS_DEBUG_FLOW)
-    printf("WEBS RX:\n");
-    web_print(session->req, session->req_size);
-#endif //WEBS_DEBUG_FLOW
-
+#if (WEBS_FILES)
+static inline void webs_file_tx_complete(WEBS* webs, WEBS_SESSION* session, IO* io)
+{
+    --session->file_writes;
 #if (WEBS_SESSION_TIMEOUT_S)
     timer_stop(session->timer, session->self, HAL_WEBS);
+    timer_start_ms(session->timer, WEBS_SESSION_TIMEOUT_S * 1000);
 #endif //WEBS_SESSION_TIMEOUT_S
+    //IO is free, read next part of file
+    if (session->file_left)
+    {
+        webs_file_read(webs, session, io);
+        return;
+    }
+    if (session->file_reads || session->file_writes)
+        return;
+    vfs_close(&webs->vfs_record, session->file);
+    session->file = INVALID_HANDLE;
+    io_reset(session->tx_io);
+#if (WEBS_SESSION_TIMEOUT_S)
+    webs_session_next(webs, session);
+#else
+    webs_close_session(webs, session);
+#endif //WEBS_SESSION_TIMEOUT_S
+}
 
-    webs_req_received(webs, session);
+static inline void webs_file_rx_complete(WEBS* webs, WEBS_SESSION* session, IO* io, int size)
+{
+    TCP_STACK* tcp_stack;
+    if (size < 0)
+    {
+#if (WEBS_DEBUG_ERRORS)
+        printf("WEBS: file read error %d\n", size);
+#endif //WEBS_DEBUG_ERRORS
+        webs_close_session(webs, session);
+        return;
+    }
+    --session->file_reads;
+    ++session->file_writes;
+    tcp_stack = io_push(io, sizeof(TCP_STACK));
+    //push on last block
+    tcp_stack->flags = (session->file_left == 0) && (session->file_reads == 0) ? TCP_PSH : 0;
+    tcp_write(webs->tcpip, session->conn, io);
+}
+
+static WEBS_SESSION* webs_find_file_session(WEBS* webs, HANDLE file, IO* io)
+{
+    HANDLE h;
+    WEBS_SESSION* session;
+    for (h = so_first(&webs->sessions); h != INVALID_HANDLE; h = so_next(&webs->sessions, h))
+    {
+        session = so_get(&webs->sessions, h);
+        //file handle can be reused by next session, while read of closed one is in flight
+        if ((file == session->file) && ((io == session->io) || (io == session->tx_io)))
+            return session;
+    }
+    return NULL;
+}
+
+static inline void webs_vfs_request(WEBS* webs, IPC* ipc)
+{
+    WEBS_SESSION* session;
+    if (HAL_ITEM(ipc->cmd) != IPC_READ)
+    {
+        error(ERROR_NOT_SUPPORTED);
+        return;
+    }
+    session = webs_find_file_session(webs, (HANDLE)ipc->param1, (IO*)ipc->param2);
+    //session may be closed before read complete. Just ignore
+    if (session == NULL)
+        return;
+    webs_file_rx_complete(webs, session, (IO*)ipc->param2, (int)ipc->param3);
 }
+#endif //WEBS_FILES
 
-static inline void webs_session_tx_complete(WEBS* webs, WEBS_SESSION* session, int size)
+static inline void webs_session_tx_complete(WEBS* webs, WEBS_SESSION* session, IO* io, int size)
 {
     if (size < 0)
     {
@@ -789,18 +1502,40 @@ static inline void webs_session_tx_complete(WEBS* webs, WEBS_SESSION* session, i
         webs_close_session(webs, session);
         return;
     }
-    session->processed += size;
-    if (session->processed >= session->req_size)
+#if (WEBS_FILES)
+    if (session->file != INVALID_HANDLE)
+    {
+        webs_file_tx_complete(webs, session, io);
+        return;
+    }
+#endif //WEBS_FILES
+    io_reset(session->tx_io);
+    if (session->tx_processed < session->tx_size)
+    {
+        webs_tx(webs, session);
+        return;
+    }
+    //response sent, return user IO
+    if (session->user_io != NULL)
+    {
+        io_complete(session->process, HAL_IO_CMD(HAL_WEBS, session->user_cmd), session->self, session->user_io);
+        session->user_io = NULL;
+    }
+    //waiting for next chunk from user
+    if (session->stream)
+        return;
+    session->chunk_open = false;
+    session->process = INVALID_HANDLE;
+    if (session->close)
     {
+        webs_close_session(webs, session);
+        return;
+    }
 #if (WEBS_SESSION_TIMEOUT_S)
-        webs_session_reset(session);
-        tcp_read(webs->tcpip, session->conn, session->io, WEBS_IO_SIZE);
+    webs_session_next(webs, session);
 #else
-        webs_close_session(webs, session);
+    webs_close_session(webs, session);
 #endif //WEBS_SESSION_TIMEOUT_S
-    }
-    else
-        webs_tx(webs, session);
 }
 
 static inline void webs_tcp_request(WEBS* webs, IPC* ipc)
@@ -824,7 +1559,8 @@ static inline void webs_tcp_request(WEBS* webs, IPC* ipc)
             webs_session_rx(webs, session, (int)ipc->param3);
             break;
         case IPC_WRITE:
-            webs_session_tx_complete(webs, session, (int)ipc->param3);
+            webs_session_tx_complete(webs, session, (IO*)ipc->param2, (int)ipc->param3);
+            break;
         default:
             error(ERROR_NOT_SUPPORTED);
             break;
@@ -851,6 +1587,11 @@ void webs_main()
         case HAL_TCP:
             webs_tcp_request(&webs, &ipc);
             break;
+#if (WEBS_FILES)
+        case HAL_VFS:
+            webs_vfs_request(&webs, &ipc);
+            break;
+#endif //WEBS_FILES
         default:
             error(ERROR_NOT_SUPPORTED);
             break;
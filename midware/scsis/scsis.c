@@ -47,17 +47,38 @@ SCSIS* scsis_create(SCSIS_CB cb_host, void* param, unsigned int id, SCSI_STORAGE
     scsis->io = NULL;
     scsis->media = NULL;
     scsis->state = SCSIS_STATE_IDLE;
+    memset(scsis->ios, 0, sizeof(IO*) * SCSI_IO_DEPTH);
+    scsis->io_depth_max = SCSI_IO_DEPTH;
     return scsis;
 }
 
 void scsis_destroy(SCSIS* scsis)
 {
+    int i;
     if (scsis->storage_descriptor->flags & SCSI_STORAGE_DESCRIPTOR_REMOVABLE)
         storage_cancel_notify_state_change(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user);
     scsis_media_removed(scsis);
+    for (i = 1; i < SCSI_IO_DEPTH; ++i)
+        io_destroy(scsis->ios[i]);
     free(scsis);
 }
 
+void scsis_set_io_depth(SCSIS* scsis, unsigned int depth)
+{
+    unsigned int i;
+    if (depth < 1)
+        depth = 1;
+    if (depth > SCSI_IO_DEPTH)
+        depth = SCSI_IO_DEPTH;
+    scsis->io_depth_max = depth;
+    //release IOs, not used anymore
+    for (i = depth; i < SCSI_IO_DEPTH; ++i)
+    {
+        io_destroy(scsis->ios[i]);
+        scsis->ios[i] = NULL;
+    }
+}
+
 void scsis_init(SCSIS* scsis)
 {
     scsis_error_init(scsis);
@@ -76,11 +97,14 @@ void scsis_reset(SCSIS* scsis)
     scsis->need_media = false;
     scsis->io = NULL;
     scsis->state = SCSIS_STATE_IDLE;
+#if (SCSI_WRITE_CACHE)
+    scsis->write_cached = false;
+#endif //SCSI_WRITE_CACHE
 }
 
 void scsis_request_cmd(SCSIS* scsis, IO* io, uint8_t* req)
 {
-    scsis->io = io;
+    scsis->io = scsis->host_io = io;
     switch (req[0])
     {
     case SCSI_SPC_CMD_MODE_SENSE6:
@@ -225,6 +249,11 @@ void scsis_host_io_complete(SCSIS* scsis, int resp_size)
         scsis_bc_host_io_complete(scsis, resp_size);
 }
 
+IO* scsis_get_host_io(SCSIS* scsis)
+{
+    return scsis->host_io;
+}
+
 void scsis_host_give_io(SCSIS* scsis, IO* io)
 {
     scsis->io = io;
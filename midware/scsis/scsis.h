@@ -28,12 +28,16 @@ typedef void (*SCSIS_CB)(void*, unsigned int, SCSIS_RESPONSE, unsigned int);
 
 SCSIS* scsis_create(SCSIS_CB cb_host, void* param, unsigned int id, SCSI_STORAGE_DESCRIPTOR* storage_descriptor);
 void scsis_destroy(SCSIS* scsis);
+//IO ring depth, up to SCSI_IO_DEPTH. With depth 1 storage and host are not working in parallel. Only between commands
+void scsis_set_io_depth(SCSIS* scsis, unsigned int depth);
 
 //host interface
 void scsis_init(SCSIS* scsis);
 void scsis_reset(SCSIS* scsis);
 void scsis_request_cmd(SCSIS* scsis, IO* io, uint8_t* req);
 void scsis_host_io_complete(SCSIS* scsis, int resp_size);
+//IO for SCSIS_RESPONSE_READ/SCSIS_RESPONSE_WRITE data transfer. Not always IO given by host
+IO* scsis_get_host_io(SCSIS* scsis);
 void scsis_host_give_io(SCSIS* scsis, IO* io);
 void scsis_request(SCSIS* scsis, IPC* ipc);
 
@@ -92,137 +92,235 @@ void scsis_bc_start_stop_unit(SCSIS* scsis, uint8_t* req)
     scsis_pass(scsis);
 }
 
-static void scsis_io(SCSIS* scsis)
+static void scsis_lba_advance(SCSIS* scsis, unsigned int count)
 {
-    scsis->io->data_size = 0;
 #if (SCSI_LONG_LBA)
     uint32_t lba_old = scsis->lba;
 #endif //SCSI_LONG_LBA
-    if (!scsis_get_media(scsis))
-        return;
-    //request completed
-    if (scsis->count == 0)
-    {
-        scsis_pass(scsis);
-        return;
-    }
-    scsis->lba += scsis->count_cur;
+    scsis->lba += count;
 #if (SCSI_LONG_LBA)
     if (scsis->lba < lba_old)
         ++scsis->lba_hi;
 #endif //SCSI_LONG_LBA
+}
 
-    scsis->count_cur = (io_get_free(scsis->io) - sizeof(STORAGE_STACK)) / scsis->media->sector_size;
-    if (scsis->count < scsis->count_cur)
-        scsis->count_cur = scsis->count;
-
-    scsis->count -= scsis->count_cur;
+//fill: storage on read, host on write. Drain: vice versa
+static void scsis_bc_fill(SCSIS* scsis)
+{
+    IO* io = scsis->ios[scsis->io_head];
+    unsigned int sectors;
+    io->data_size = 0;
+    sectors = (io_get_free(io) - sizeof(STORAGE_STACK)) / scsis->media->sector_size;
+    if (scsis->count < sectors)
+        sectors = scsis->count;
+    scsis->count -= sectors;
+    scsis->io_sectors[scsis->io_head] = sectors;
+    ++scsis->io_used;
+    scsis->fill_busy = true;
 
     switch (scsis->state)
     {
     case SCSIS_STATE_READ:
         storage_read(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
-                     scsis->io, scsis->lba, scsis->count_cur * scsis->media->sector_size);
+                     io, scsis->lba, sectors * scsis->media->sector_size);
+        scsis_lba_advance(scsis, sectors);
         break;
     case SCSIS_STATE_WRITE:
 #if (SCSI_VERIFY_SUPPORTED)
     case SCSIS_STATE_VERIFY:
     case SCSIS_STATE_WRITE_VERIFY:
 #endif //SCSI_VERIFY_SUPPORTED
-        scsis_cb_host(scsis, SCSIS_RESPONSE_READ, scsis->count_cur * scsis->media->sector_size);
+        scsis->host_io = io;
+        scsis_cb_host(scsis, SCSIS_RESPONSE_READ, sectors * scsis->media->sector_size);
         break;
     default:
         break;
     }
 }
 
-static bool scsis_bc_io_response_check(SCSIS* scsis, int size)
+static void scsis_bc_drain(SCSIS* scsis)
+{
+    IO* io = scsis->ios[scsis->io_tail];
+    scsis->drain_busy = true;
+
+    switch (scsis->state)
+    {
+    case SCSIS_STATE_READ:
+        scsis->host_io = io;
+        scsis_cb_host(scsis, SCSIS_RESPONSE_WRITE, io->data_size);
+        return;
+    case SCSIS_STATE_WRITE:
+        storage_write(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
+                      io, scsis->lba);
+        break;
+#if (SCSI_VERIFY_SUPPORTED)
+    case SCSIS_STATE_VERIFY:
+        storage_verify(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
+                      io, scsis->lba);
+        break;
+    case SCSIS_STATE_WRITE_VERIFY:
+        storage_write_verify(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
+                      io, scsis->lba);
+        break;
+#endif //SCSI_VERIFY_SUPPORTED
+    default:
+        return;
+    }
+    scsis_lba_advance(scsis, scsis->io_sectors[scsis->io_tail]);
+}
+
+static void scsis_io(SCSIS* scsis)
+{
+    if (scsis->io_failed)
+    {
+        //wait for pending storage/host IO, before responding to host
+        if (!scsis->fill_busy && !scsis->drain_busy)
+            scsis_done(scsis, SCSIS_RESPONSE_FAIL);
+        return;
+    }
+    //request completed
+    if ((scsis->count == 0) && (scsis->io_used == 0))
+    {
+        scsis_pass(scsis);
+        return;
+    }
+    //storage and host are working in parallel on different IO
+    if (!scsis->drain_busy && (scsis->io_used > (scsis->fill_busy ? 1 : 0)))
+        scsis_bc_drain(scsis);
+    if (!scsis->fill_busy && scsis->count && (scsis->io_used < scsis->io_depth))
+        scsis_bc_fill(scsis);
+}
+
+static void scsis_bc_io_fail(SCSIS* scsis, uint8_t key_sense, uint16_t ascq)
+{
+    if (!scsis->io_failed)
+        scsis_error_put(scsis, key_sense, ascq);
+    scsis->io_failed = true;
+    scsis_io(scsis);
+}
+
+static void scsis_bc_io_start(SCSIS* scsis, SCSIS_STATE state)
 {
     if (!scsis_get_media(scsis))
+        return;
+    scsis->state = state;
+    //first IO is host's. Others are allocated on first request and kept for next
+    scsis->ios[0] = scsis->io;
+    for (scsis->io_depth = 1; scsis->io_depth < scsis->io_depth_max; ++scsis->io_depth)
+    {
+        if ((scsis->ios[scsis->io_depth] == NULL) && ((scsis->ios[scsis->io_depth] = io_create(scsis->io->size - sizeof(IO))) == NULL))
+            break;
+    }
+    scsis->io_head = scsis->io_tail = scsis->io_used = 0;
+    scsis->fill_busy = scsis->drain_busy = scsis->io_failed = false;
+    scsis_io(scsis);
+}
+
+static bool scsis_bc_io_response_check(SCSIS* scsis, int size, unsigned int sectors)
+{
+    if (scsis->media == NULL)
+    {
+        scsis_bc_io_fail(scsis, SENSE_KEY_NOT_READY, ASCQ_MEDIUM_NOT_PRESENT);
         return false;
+    }
     if (size < 0)
     {
         switch (size)
         {
         case ERROR_CRC:
-            scsis_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_LOGICAL_UNIT_COMMUNICATION_CRC_ERROR);
+            scsis_bc_io_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_LOGICAL_UNIT_COMMUNICATION_CRC_ERROR);
             break;
         case ERROR_IN_PROGRESS:
-            scsis_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_LOGICAL_UNIT_NOT_READY_OPERATION_IN_PROGRESS);
+            scsis_bc_io_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_LOGICAL_UNIT_NOT_READY_OPERATION_IN_PROGRESS);
             break;
         case ERROR_ACCESS_DENIED:
-            scsis_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_WRITE_PROTECTED);
+            scsis_bc_io_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_WRITE_PROTECTED);
             break;
         case ERROR_INVALID_PARAMS:
-            scsis_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE);
+            scsis_bc_io_fail(scsis, SENSE_KEY_MEDIUM_ERROR, ASCQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE);
             break;
         default:
-            scsis_fail(scsis, SENSE_KEY_HARDWARE_ERROR, ASCQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
+            scsis_bc_io_fail(scsis, SENSE_KEY_HARDWARE_ERROR, ASCQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
             break;
         }
         return false;
     }
-    else if (size != scsis->count_cur * scsis->media->sector_size)
+    else if (size != sectors * scsis->media->sector_size)
     {
-        scsis_fail(scsis, SENSE_KEY_HARDWARE_ERROR, ASCQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
+        scsis_bc_io_fail(scsis, SENSE_KEY_HARDWARE_ERROR, ASCQ_LOGICAL_UNIT_COMMUNICATION_FAILURE);
         return false;
     }
     return true;
 }
 
+static bool scsis_bc_fill_complete(SCSIS* scsis, int size)
+{
+    unsigned int sectors = scsis->io_sectors[scsis->io_head];
+    scsis->fill_busy = false;
+    scsis->io_head = (scsis->io_head + 1) % scsis->io_depth;
+    return scsis_bc_io_response_check(scsis, size, sectors);
+}
+
+static bool scsis_bc_drain_complete(SCSIS* scsis, int size)
+{
+    unsigned int sectors = scsis->io_sectors[scsis->io_tail];
+    scsis->drain_busy = false;
+    scsis->io_tail = (scsis->io_tail + 1) % scsis->io_depth;
+    --scsis->io_used;
+    return scsis_bc_io_response_check(scsis, size, sectors);
+}
+
 void scsis_bc_host_io_complete(SCSIS* scsis, int resp_size)
 {
-    if (!scsis_bc_io_response_check(scsis, resp_size))
-        return;
     switch (scsis->state)
     {
     case SCSIS_STATE_READ:
-        scsis_io(scsis);
+        if (!scsis_bc_drain_complete(scsis, resp_size))
+            return;
         break;
     case SCSIS_STATE_WRITE:
-#if (SCSI_WRITE_CACHE)
-        if (scsis->count == 0)
-            scsis_cb_host(scsis, SCSIS_RESPONSE_PASS, 0);
-#endif //SCSI_WRITE_CACHE
-        storage_write(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
-                      scsis->io, scsis->lba);
-        break;
 #if (SCSI_VERIFY_SUPPORTED)
     case SCSIS_STATE_VERIFY:
-        storage_verify(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
-                      scsis->io, scsis->lba);
-        break;
     case SCSIS_STATE_WRITE_VERIFY:
-        storage_write_verify(scsis->storage_descriptor->hal, scsis->storage_descriptor->storage, scsis->storage_descriptor->user,
-                      scsis->io, scsis->lba);
-        break;
 #endif //SCSI_VERIFY_SUPPORTED
-    default:
+        if (!scsis_bc_fill_complete(scsis, resp_size))
+            return;
+#if (SCSI_WRITE_CACHE)
+        if ((scsis->state == SCSIS_STATE_WRITE) && (scsis->count == 0) && !scsis->io_failed)
+        {
+            scsis->write_cached = true;
+            scsis_cb_host(scsis, SCSIS_RESPONSE_PASS, 0);
+        }
+#endif //SCSI_WRITE_CACHE
         break;
+    default:
+        return;
     }
+    scsis_io(scsis);
 }
 
 void scsis_bc_storage_io_complete(SCSIS* scsis, int resp_size)
 {
-    if (!scsis_bc_io_response_check(scsis, resp_size))
-        return;
-
     switch (scsis->state)
     {
     case SCSIS_STATE_READ:
-        scsis_cb_host(scsis, SCSIS_RESPONSE_WRITE, scsis->io->data_size);
+        if (!scsis_bc_fill_complete(scsis, resp_size))
+            return;
         break;
     case SCSIS_STATE_WRITE:
 #if (SCSI_VERIFY_SUPPORTED)
     case SCSIS_STATE_VERIFY:
     case SCSIS_STATE_WRITE_VERIFY:
 #endif //SCSI_VERIFY_SUPPORTED
-        scsis_io(scsis);
+        if (!scsis_bc_drain_complete(scsis, resp_size))
+            return;
         break;
     default:
-        break;
+        return;
     }
+    scsis_io(scsis);
 }
+
 void scsis_bc_read6(SCSIS* scsis, uint8_t* req)
 {
     scsis->lba = ((req[1] & 0x1f) << 16) | be2short(req + 2);
@@ -235,9 +333,7 @@ void scsis_bc_read6(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI read(6) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_READ;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_READ);
 }
 
 void scsis_bc_read10(SCSIS* scsis, uint8_t* req)
@@ -250,9 +346,7 @@ void scsis_bc_read10(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI read(10) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_READ;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_READ);
 }
 
 void scsis_bc_read12(SCSIS* scsis, uint8_t* req)
@@ -265,9 +359,7 @@ void scsis_bc_read12(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI read(12) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_READ;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_READ);
 }
 
 void scsis_bc_write6(SCSIS* scsis, uint8_t* req)
@@ -282,9 +374,7 @@ void scsis_bc_write6(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write(6) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE);
 }
 
 void scsis_bc_write10(SCSIS* scsis, uint8_t* req)
@@ -297,9 +387,7 @@ void scsis_bc_write10(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write(10) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE);
 }
 
 void scsis_bc_write12(SCSIS* scsis, uint8_t* req)
@@ -312,9 +400,7 @@ void scsis_bc_write12(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write(12) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE);
 }
 
 #if (SCSI_VERIFY_SUPPORTED)
@@ -328,9 +414,7 @@ void scsis_bc_verify10(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI verify(10) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_VERIFY);
 }
 
 void scsis_bc_verify12(SCSIS* scsis, uint8_t* req)
@@ -343,9 +427,7 @@ void scsis_bc_verify12(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI verify(12) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_VERIFY);
 }
 
 void scsis_bc_write_verify10(SCSIS* scsis, uint8_t* req)
@@ -358,9 +440,7 @@ void scsis_bc_write_verify10(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write and verify(10) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE_VERIFY);
 }
 
 void scsis_bc_write_verify12(SCSIS* scsis, uint8_t* req)
@@ -373,9 +453,7 @@ void scsis_bc_write_verify12(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write and verify(12) lba: %#08X, len: %#X\n", scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE_VERIFY);
 }
 #endif //SCSI_VERIFY_SUPPORTED
 
@@ -388,9 +466,7 @@ void scsis_bc_read16(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI read(16) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_READ;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_READ);
 }
 
 void scsis_bc_read32(SCSIS* scsis, uint8_t* req)
@@ -401,9 +477,7 @@ void scsis_bc_read32(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI read(32) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_READ;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_READ);
 }
 
 void scsis_bc_write16(SCSIS* scsis, uint8_t* req)
@@ -414,9 +488,7 @@ void scsis_bc_write16(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write(16) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE);
 }
 
 void scsis_bc_write32(SCSIS* scsis, uint8_t* req)
@@ -427,9 +499,7 @@ void scsis_bc_write32(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write(32) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE);
 }
 
 #if (SCSI_VERIFY_SUPPORTED)
@@ -441,9 +511,7 @@ void scsis_bc_verify16(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI verify(16) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_VERIFY);
 }
 
 void scsis_bc_verify32(SCSIS* scsis, uint8_t* req)
@@ -454,9 +522,7 @@ void scsis_bc_verify32(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI verify(32) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_VERIFY);
 }
 
 void scsis_bc_write_verify16(SCSIS* scsis, uint8_t* req)
@@ -467,9 +533,7 @@ void scsis_bc_write_verify16(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write and verify(16) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE_VERIFY);
 }
 
 void scsis_bc_write_verify32(SCSIS* scsis, uint8_t* req)
@@ -480,9 +544,7 @@ void scsis_bc_write_verify32(SCSIS* scsis, uint8_t* req)
 #if (SCSI_DEBUG_REQUESTS)
     printf("SCSI write and verify(32) lba: %#08X%08X, len: %#X\n", scsis->lba_hi, scsis->lba, scsis->count);
 #endif //SCSI_DEBUG_REQUESTS
-    scsis->state = SCSIS_STATE_WRITE_VERIFY;
-    scsis->count_cur = 0;
-    scsis_io(scsis);
+    scsis_bc_io_start(scsis, SCSIS_STATE_WRITE_VERIFY);
 }
 #endif //SCSI_VERIFY_SUPPORTED
 #endif //SCSI_LONG_LBA
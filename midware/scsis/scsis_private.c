@@ -49,12 +49,12 @@ void scsis_cb_host(SCSIS* scsis, SCSIS_RESPONSE response, unsigned int size)
     scsis->cb_host(scsis->param, scsis->id, response, size);
 }
 
-static void scsis_done(SCSIS* scsis, SCSIS_RESPONSE resp)
+void scsis_done(SCSIS* scsis, SCSIS_RESPONSE resp)
 {
     bool was_ready = false;
 #if (SCSI_WRITE_CACHE)
-    if (scsis->state == SCSIS_STATE_WRITE && (scsis->count == 0))
-        was_ready = true;
+    was_ready = scsis->write_cached;
+    scsis->write_cached = false;
 #endif //SCSI_WRITE_CACHE
     scsis->state = SCSIS_STATE_IDLE;
     if (scsis->need_media)
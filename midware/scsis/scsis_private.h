@@ -261,10 +261,20 @@ typedef struct _SCSIS {
     IO* io;
     SCSIS_CB cb_host;
     void* param;
-    unsigned int lba, count, count_cur, id;
+    unsigned int lba, count, id;
 #if (SCSI_LONG_LBA)
     unsigned int lba_hi;
 #endif //SCSI_LONG_LBA
+    //IO ring for storage/host pipelining. First is host IO
+    IO* ios[SCSI_IO_DEPTH];
+    unsigned int io_sectors[SCSI_IO_DEPTH];
+    unsigned int io_head, io_tail, io_used, io_depth, io_depth_max;
+    //IO for current host data transfer
+    IO* host_io;
+    bool fill_busy, drain_busy, io_failed;
+#if (SCSI_WRITE_CACHE)
+    bool write_cached;
+#endif //SCSI_WRITE_CACHE
 #if (SCSI_MMC)
     bool media_status_changed;
 #endif //SCSI_MMC
@@ -275,6 +285,7 @@ void scsis_error_init(SCSIS* scsis);
 void scsis_error_put(SCSIS* scsis, uint8_t key_sense, uint16_t ascq);
 void scsis_error_get(SCSIS* scsis, SCSIS_ERROR* err);
 void scsis_cb_host(SCSIS* scsis, SCSIS_RESPONSE response, unsigned int size);
+void scsis_done(SCSIS* scsis, SCSIS_RESPONSE resp);
 void scsis_fail(SCSIS* scsis, uint8_t key_sense, uint16_t ascq);
 void scsis_pass(SCSIS* scsis);
 
@@ -9,25 +9,39 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/endian.h"
 #include "../../userspace/error.h"
+#include "../../userspace/stdlib.h"
 #include "macs.h"
 #include "ips.h"
 
-#define ARP_CACHE_ITEM(tcpips, i)                    ((ARP_CACHE_ENTRY*)array_at((tcpips)->arps.cache, i))
+#define ARP_CACHE_ITEM(tcpips, i)                    (&(tcpips)->arps.cache[i])
 
-typedef struct {
-    IP ip;
-    //zero MAC means unresolved yet
-    MAC mac;
-    //time to live. Zero means static ARP
-    unsigned int ttl;
-} ARP_CACHE_ENTRY;
+//open addressing probe must always find empty slot
+#if (ARP_HASH_SIZE & (ARP_HASH_SIZE - 1)) || (ARP_HASH_SIZE <= ARP_CACHE_SIZE_MAX)
+#error ARP_HASH_SIZE must be power of 2, greater than ARP_CACHE_SIZE_MAX
+#endif
 
 static const MAC __MAC_BROADCAST =                  {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
 static const MAC __MAC_REQUEST =                    {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
 void arps_init(TCPIPS* tcpips)
 {
-    array_create(&tcpips->arps.cache, sizeof(ARP_CACHE_ENTRY), 1);
+    int i;
+    ARPS* arps = &tcpips->arps;
+    arps->incomplete.head = arps->incomplete.tail = -1;
+    arps->resolved.head = arps->resolved.tail = -1;
+    arps->free = -1;
+    arps->count = 0;
+    arps->cache = malloc(ARP_CACHE_SIZE_MAX * sizeof(ARP_CACHE_ENTRY) + ARP_HASH_SIZE * sizeof(short));
+    if (arps->cache == NULL)
+        return;
+    arps->hash = (short*)(arps->cache + ARP_CACHE_SIZE_MAX);
+    for (i = 0; i < ARP_HASH_SIZE; ++i)
+        arps->hash[i] = -1;
+    for (i = ARP_CACHE_SIZE_MAX - 1; i >= 0; --i)
+    {
+        arps->cache[i].next = arps->free;
+        arps->free = i;
+    }
 }
 
 static void arps_cmd_request(TCPIPS* tcpips, const IP* ip)
@@ -100,20 +114,92 @@ static inline void arps_cmd_reply(TCPIPS* tcpips, MAC* mac, IP* ip)
     macs_tx(tcpips, io, mac, ETHERTYPE_ARP);
 }
 
+static inline unsigned int arps_hash(uint32_t ip)
+{
+    uint32_t hash = ip;
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+    return hash & (ARP_HASH_SIZE - 1);
+}
+
 static int arps_index(TCPIPS* tcpips, const IP* ip)
 {
-    int i;
-    for (i = 0; i < array_size(tcpips->arps.cache); ++i)
+    unsigned int i;
+    int idx;
+    if (tcpips->arps.cache == NULL)
+        return -1;
+    //hash is never full, empty slot is always reached
+    for (i = arps_hash(ip->u32.ip); (idx = tcpips->arps.hash[i]) >= 0; i = (i + 1) & (ARP_HASH_SIZE - 1))
     {
-        if (ARP_CACHE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
-            return i;
+        if (ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip == ip->u32.ip)
+            return idx;
     }
     return -1;
 }
 
+static void arps_hash_remove(TCPIPS* tcpips, int idx)
+{
+    unsigned int i, j, k;
+    short* hash = tcpips->arps.hash;
+    for (i = arps_hash(ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip); hash[i] != idx; i = (i + 1) & (ARP_HASH_SIZE - 1)) {}
+    //backward shift, no tombstones
+    for (j = i;;)
+    {
+        hash[i] = -1;
+        for (;;)
+        {
+            j = (j + 1) & (ARP_HASH_SIZE - 1);
+            if (hash[j] < 0)
+                return;
+            k = arps_hash(ARP_CACHE_ITEM(tcpips, hash[j])->ip.u32.ip);
+            //keep in place if home slot is cyclically in (i, j]
+            if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+                continue;
+            break;
+        }
+        hash[i] = hash[j];
+        i = j;
+    }
+}
+
+static void arps_list_append(TCPIPS* tcpips, ARP_LIST* list, int idx)
+{
+    ARP_CACHE_ENTRY* arp = ARP_CACHE_ITEM(tcpips, idx);
+    arp->prev = list->tail;
+    arp->next = -1;
+    if (list->tail >= 0)
+        ARP_CACHE_ITEM(tcpips, list->tail)->next = idx;
+    else
+        list->head = idx;
+    list->tail = idx;
+}
+
+static void arps_list_remove(TCPIPS* tcpips, ARP_LIST* list, int idx)
+{
+    ARP_CACHE_ENTRY* arp = ARP_CACHE_ITEM(tcpips, idx);
+    if (arp->prev >= 0)
+        ARP_CACHE_ITEM(tcpips, arp->prev)->next = arp->next;
+    else
+        list->head = arp->next;
+    if (arp->next >= 0)
+        ARP_CACHE_ITEM(tcpips, arp->next)->prev = arp->prev;
+    else
+        list->tail = arp->prev;
+}
+
+static inline ARP_LIST* arps_item_list(TCPIPS* tcpips, int idx)
+{
+    ARP_CACHE_ENTRY* arp = ARP_CACHE_ITEM(tcpips, idx);
+    //static entries are not expiring
+    if (arp->ttl == 0)
+        return NULL;
+    return mac_compare(&arp->mac, &__MAC_REQUEST) ? &tcpips->arps.incomplete : &tcpips->arps.resolved;
+}
+
 static void arps_remove_item(TCPIPS* tcpips, int idx)
 {
     IP ip;
+    ARP_LIST* list;
     ip.u32.ip = 0;
     if (mac_compare(&ARP_CACHE_ITEM(tcpips, idx)->mac, &__MAC_REQUEST))
         ip.u32.ip = ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip;
@@ -125,7 +211,14 @@ static void arps_remove_item(TCPIPS* tcpips, int idx)
         printf(" removed\n");
     }
 #endif
-    array_remove(&tcpips->arps.cache, idx);
+    list = arps_item_list(tcpips, idx);
+    if (list != NULL)
+        arps_list_remove(tcpips, list, idx);
+    arps_hash_remove(tcpips, idx);
+    ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip = 0;
+    ARP_CACHE_ITEM(tcpips, idx)->next = tcpips->arps.free;
+    tcpips->arps.free = idx;
+    --tcpips->arps.count;
 
     //inform route on incomplete ARP if not resolved
     if (ip.u32.ip)
@@ -134,39 +227,33 @@ static void arps_remove_item(TCPIPS* tcpips, int idx)
 
 static void arps_insert_item(TCPIPS* tcpips, const IP* ip, const MAC* mac, unsigned int timeout)
 {
-    int i, idx;
-    unsigned int ttl;
+    int idx;
+    unsigned int i;
+    ARP_CACHE_ENTRY* arp;
     //don't add dups
-    if (arps_index(tcpips, ip) >= 0)
+    if ((tcpips->arps.cache == NULL) || (arps_index(tcpips, ip) >= 0))
         return;
-    //remove first non-static if no place
-    if (array_size(tcpips->arps.cache) == ARP_CACHE_SIZE_MAX)
+    //remove first to expire if no place. Resolved are preferred - incomplete can be answered soon
+    if (tcpips->arps.count == ARP_CACHE_SIZE_MAX)
     {
-        //first is static, can't remove
-        if (ARP_CACHE_ITEM(tcpips, 0)->ttl == 0)
+        idx = tcpips->arps.resolved.head >= 0 ? tcpips->arps.resolved.head : tcpips->arps.incomplete.head;
+        //all static, can't remove
+        if (idx < 0)
             return;
-        arps_remove_item(tcpips, 0);
+        arps_remove_item(tcpips, idx);
     }
-    idx = array_size(tcpips->arps.cache);
-    ttl = 0;
-    //add all static routes to the end of cache
+    idx = tcpips->arps.free;
+    arp = ARP_CACHE_ITEM(tcpips, idx);
+    tcpips->arps.free = arp->next;
+    ++tcpips->arps.count;
+    arp->ip.u32.ip = ip->u32.ip;
+    arp->mac.u32.hi = mac->u32.hi;
+    arp->mac.u32.lo = mac->u32.lo;
+    arp->ttl = timeout ? tcpips->seconds + timeout : 0;
+    for (i = arps_hash(ip->u32.ip); tcpips->arps.hash[i] >= 0; i = (i + 1) & (ARP_HASH_SIZE - 1)) {}
+    tcpips->arps.hash[i] = idx;
     if (timeout)
-    {
-        ttl = tcpips->seconds + timeout;
-        for (i = 0; i < array_size(tcpips->arps.cache); ++i)
-            if ((ARP_CACHE_ITEM(tcpips, i)->ttl > ttl) || (ARP_CACHE_ITEM(tcpips, i)->ttl == 0))
-            {
-                idx = i;
-                break;
-            }
-    }
-    if (array_insert(&tcpips->arps.cache, idx))
-    {
-        ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip = ip->u32.ip;
-        ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = mac->u32.hi;
-        ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = mac->u32.lo;
-        ARP_CACHE_ITEM(tcpips, idx)->ttl = ttl;
-    }
+        arps_list_append(tcpips, arps_item_list(tcpips, idx), idx);
 #if (ARP_DEBUG)
     if (mac->u32.hi && mac->u32.lo)
     {
@@ -181,12 +268,18 @@ static void arps_insert_item(TCPIPS* tcpips, const IP* ip, const MAC* mac, unsig
 
 static void arps_update_item(TCPIPS* tcpips, const IP* ip, const MAC* mac)
 {
+    ARP_LIST* list;
     int idx = arps_index(tcpips, ip);
-    if (idx < 0)
+    //static entries are never updated
+    if ((idx < 0) || (ARP_CACHE_ITEM(tcpips, idx)->ttl == 0))
         return;
+    //move to the end of resolved list
+    list = arps_item_list(tcpips, idx);
+    arps_list_remove(tcpips, list, idx);
     ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = mac->u32.hi;
     ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = mac->u32.lo;
     ARP_CACHE_ITEM(tcpips, idx)->ttl = tcpips->seconds + ARP_CACHE_TIMEOUT;
+    arps_list_append(tcpips, &tcpips->arps.resolved, idx);
 #if (ARP_DEBUG)
     printf("ARP: route resolved ");
     ip_print(ip);
@@ -199,7 +292,8 @@ static void arps_update_item(TCPIPS* tcpips, const IP* ip, const MAC* mac)
 static bool arps_lookup(TCPIPS* tcpips, const IP* ip, MAC* mac)
 {
     int idx = arps_index(tcpips, ip);
-    if (idx >= 0)
+    //not resolved yet
+    if ((idx >= 0) && !mac_compare(&ARP_CACHE_ITEM(tcpips, idx)->mac, &__MAC_REQUEST))
     {
         mac->u32.hi = ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi;
         mac->u32.lo = ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo;
@@ -221,15 +315,19 @@ void arps_link_changed(TCPIPS* tcpips, bool link)
     else
     {
         //flush ARP cache, except static routes
-        while (array_size(tcpips->arps.cache) && ARP_CACHE_ITEM(tcpips, 0)->ttl)
-            arps_remove_item(tcpips, 0);
+        while (tcpips->arps.incomplete.head >= 0)
+            arps_remove_item(tcpips, tcpips->arps.incomplete.head);
+        while (tcpips->arps.resolved.head >= 0)
+            arps_remove_item(tcpips, tcpips->arps.resolved.head);
     }
 }
 
 void arps_timer(TCPIPS* tcpips, unsigned int seconds)
 {
-    while (array_size(tcpips->arps.cache) && ARP_CACHE_ITEM(tcpips, 0)->ttl && (ARP_CACHE_ITEM(tcpips, 0)->ttl <= seconds))
-        arps_remove_item(tcpips, 0);
+    while ((tcpips->arps.incomplete.head >= 0) && (ARP_CACHE_ITEM(tcpips, tcpips->arps.incomplete.head)->ttl <= seconds))
+        arps_remove_item(tcpips, tcpips->arps.incomplete.head);
+    while ((tcpips->arps.resolved.head >= 0) && (ARP_CACHE_ITEM(tcpips, tcpips->arps.resolved.head)->ttl <= seconds))
+        arps_remove_item(tcpips, tcpips->arps.resolved.head);
 }
 
 static inline void arps_add_static(TCPIPS* tcpips, IPC* ipc)
@@ -264,8 +362,12 @@ static inline void arps_remove(TCPIPS* tcpips, IP* ip)
 
 static void arps_flush(TCPIPS* tcpips)
 {
-    while (array_size(tcpips->arps.cache))
-        arps_remove_item(tcpips, 0);
+    int i;
+    for (i = 0; (i < ARP_CACHE_SIZE_MAX) && tcpips->arps.count; ++i)
+    {
+        if (ARP_CACHE_ITEM(tcpips, i)->ip.u32.ip)
+            arps_remove_item(tcpips, i);
+    }
 }
 
 #if (ARP_DEBUG)
@@ -273,16 +375,19 @@ static inline void arps_show_table(TCPIPS* tcpips)
 {
     int i;
     ARP_CACHE_ENTRY* arp;
-    if (array_size(tcpips->arps.cache) == 0)
+    if (tcpips->arps.count == 0)
     {
         printf("ARP: table is empty\n");
         return;
     }
     printf("       IP             MAC          TTL\n");
     printf("-----------------------------------------\n");
-    for (i = 0; i < array_size(tcpips->arps.cache); ++i)
+    for (i = 0; i < ARP_CACHE_SIZE_MAX; ++i)
     {
         arp = ARP_CACHE_ITEM(tcpips, i);
+        //free entry
+        if (arp->ip.u32.ip == 0)
+            continue;
         printf("  ");
         ip_print(&arp->ip);
         printf("  ");
@@ -380,6 +485,9 @@ bool arps_resolve(TCPIPS* tcpips, const IP* ip, MAC* mac)
     }
     if (arps_lookup(tcpips, ip, mac))
         return true;
+    //already requesting, route will be informed on reply or timeout
+    if (arps_index(tcpips, ip) >= 0)
+        return false;
     //request mac
     arps_insert_item(tcpips, ip, &__MAC_REQUEST, ARP_CACHE_INCOMPLETE_TIMEOUT);
     arps_cmd_request(tcpips, ip);
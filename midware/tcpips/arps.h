@@ -9,7 +9,6 @@
 
 #include "tcpips.h"
 #include "../../userspace/eth.h"
-#include "../../userspace/array.h"
 #include "../../userspace/ipc.h"
 #include "../../userspace/arp.h"
 #include <stdint.h>
@@ -40,7 +39,27 @@ typedef struct {
 #define RARP_REPLY                      4
 
 typedef struct {
-    ARRAY* cache;
+    IP ip;
+    //zero MAC means unresolved yet
+    MAC mac;
+    //time to live. Zero means static ARP
+    unsigned int ttl;
+    //expire list, free list
+    short prev, next;
+} ARP_CACHE_ENTRY;
+
+typedef struct {
+    short head, tail;
+} ARP_LIST;
+
+typedef struct {
+    ARP_CACHE_ENTRY* cache;
+    //open addressing, linear probing. Index in cache or -1
+    short* hash;
+    //same timeout in each list, so lists are sorted by expire time
+    ARP_LIST incomplete, resolved;
+    short free;
+    unsigned int count;
 } ARPS;
 
 //from tcpip
@@ -460,6 +460,7 @@ static inline void ips_insert_fragment(TCPIPS* tcpips, IO* io, unsigned int offs
     IP_HEADER* hdr;
     IPS_ASSEMBLY* as;
     IO* assembled;
+    uint16_t crc, prev;
     IP_STACK* ip_stack = io_stack(io);
     hdr = (IP_HEADER*)(((uint8_t*)io_data(io)) - ip_stack->hdr_size);
     as = ips_find_assembly(tcpips, &hdr->src, be2short(hdr->id_be));
@@ -524,13 +525,16 @@ static inline void ips_insert_fragment(TCPIPS* tcpips, IO* io, unsigned int offs
         //update header
         io->data_offset += ip_stack->hdr_size;
         io->data_size -= ip_stack->hdr_size;
+        //update checksum incrementally, header is already verified
+        crc = be2short(hdr->header_crc_be);
         //total len
+        prev = be2short(hdr->total_len_be);
         short2be(hdr->total_len_be, io->data_size);
+        crc = ip_checksum_update(crc, prev, be2short(hdr->total_len_be));
         //flags, offset
+        crc = ip_checksum_update(crc, be2short(hdr->flags_offset_be), 0);
         hdr->flags_offset_be[0] = hdr->flags_offset_be[1] = 0;
-        //update checksum
-        short2be(hdr->header_crc_be, 0);
-        short2be(hdr->header_crc_be, ip_checksum(io_data(assembled), ip_stack->hdr_size));
+        short2be(hdr->header_crc_be, crc);
         ips_process(tcpips, assembled, &hdr->src);
     }
 }
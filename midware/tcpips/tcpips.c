@@ -123,6 +123,11 @@ void tcpips_release_io(TCPIPS* tcpips, IO* io)
         *iop = io;
 }
 
+unsigned int tcpips_get_free_io_count(TCPIPS* tcpips)
+{
+    return TCPIP_MAX_FRAMES_COUNT - tcpips->io_allocated + array_size(tcpips->free_io);
+}
+
 static void tcpips_rx_next(TCPIPS* tcpips)
 {
     IO* io = tcpips_allocate_io(tcpips);
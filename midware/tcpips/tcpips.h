@@ -24,6 +24,8 @@ extern const IP __BROADCAST;
 IO* tcpips_allocate_io(TCPIPS* tcpips);
 //release previously allocated io. Io is not actually freed, just put in queue of free ios
 void tcpips_release_io(TCPIPS* tcpips, IO* io);
+//ios, that can be allocated without dropping queued ones
+unsigned int tcpips_get_free_io_count(TCPIPS* tcpips);
 //transmit. If tx operation is in place (2 tx for double buffering), io will be putted in queue for later processing
 void tcpips_tx(TCPIPS* tcpips, IO* io);
 
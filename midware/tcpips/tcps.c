@@ -18,6 +18,20 @@
 #define TCP_MSS_MIN                                      536
 
 #define MSL_MS                                           60000
+//no timestamps option, so 4 blocks fits
+#define TCP_SACK_BLOCKS_MAX                              4
+
+//buckets are selected by mask
+#if (TCP_HASH_SIZE & (TCP_HASH_SIZE - 1)) || (TCP_LISTEN_HASH_SIZE & (TCP_LISTEN_HASH_SIZE - 1))
+#error TCP_HASH_SIZE and TCP_LISTEN_HASH_SIZE must be power of 2
+#endif
+
+//held segments must not starve tcpip IO pool
+#if (TCP_OOO_FRAMES_MAX >= TCPIP_MAX_FRAMES_COUNT)
+#error TCP_OOO_FRAMES_MAX must be less than TCPIP_MAX_FRAMES_COUNT
+#endif
+
+#define TCP_TX(tcb, i)                                   ((tcb)->tx[((tcb)->tx_head + (i)) % TCP_TX_QUEUE_SIZE])
 
 #pragma pack(push, 1)
 typedef struct {
@@ -41,7 +55,7 @@ typedef struct {
 #pragma pack(pop)
 
 typedef struct {
-    HANDLE process;
+    HANDLE process, next;
     uint16_t port;
 } TCP_LISTEN_HANDLE;
 
@@ -59,18 +73,27 @@ typedef enum {
 } TCP_STATE;
 
 typedef struct {
-    HANDLE process;
+    HANDLE process, next;
     IP remote_addr;
     IO* rx;
     IO* rx_tmp;
-    IO* tx;
+    //queued user writes. tx_cur - acked size of first, tx_size - total not acked size
+    IO* tx[TCP_TX_QUEUE_SIZE];
+    unsigned int tx_head, tx_count, tx_size;
+    //out of order segments, sorted by sequence
+    IO* ooo[TCP_OOO_SIZE];
+    unsigned int ooo_count;
     HANDLE timer;
     unsigned int tx_cur, rx_cur;
-    uint32_t snd_una, snd_nxt, rcv_nxt;
+    //snd_sent - next sequence to send, snd_max - after highest sent sequence (snd_sent is rewound on retransmission),
+    //snd_nxt - after last queued sequence
+    uint32_t snd_una, snd_sent, snd_max, snd_nxt, rcv_nxt;
+    //first hole end, reported by peer SACK. Last hole retransmitted. Sequence of last received out of order segment
+    uint32_t sack_left, snd_rexmit, sack_last;
 
     TCP_STATE state;
     uint16_t remote_port, local_port, mss, rx_wnd, tx_wnd, retry;
-    bool active, transmit, fin;
+    bool active, transmit, fin, sack, sack_hole;
 } TCP_TCB;
 
 #if (TCP_DEBUG_PACKETS)
@@ -194,6 +217,55 @@ static void tcps_append_mss(IO* io)
     tcps_append_opt(io, TCP_OPTS_MSS, mss_be, 2 + 2);
 }
 
+static void tcps_append_sack_permitted(IO* io)
+{
+    tcps_append_opt(io, TCP_OPTS_SACK_PERMITTED, NULL, 2);
+}
+
+//report held out of order data, merged in blocks. First block is containing last received segment (RFC 2018 4)
+static void tcps_append_sack(IO* io, TCP_TCB* tcb)
+{
+    uint8_t sack[TCP_SACK_BLOCKS_MAX * 8];
+    uint32_t left[TCP_OOO_SIZE], right[TCP_OOO_SIZE];
+    unsigned int i, count, first, size;
+    uint32_t seq;
+    if (!tcb->sack || tcb->ooo_count == 0)
+        return;
+    for (i = 0, count = 0; i < tcb->ooo_count; ++i)
+    {
+        seq = be2int(((TCP_HEADER*)io_data(tcb->ooo[i]))->seq_be);
+        if (count && tcps_diff(right[count - 1], seq) <= 0)
+        {
+            if (tcps_diff(right[count - 1], seq + tcps_data_len(tcb->ooo[i])) > 0)
+                right[count - 1] = seq + tcps_data_len(tcb->ooo[i]);
+        }
+        else
+        {
+            left[count] = seq;
+            right[count] = seq + tcps_data_len(tcb->ooo[i]);
+            ++count;
+        }
+    }
+    //blocks are sorted by sequence
+    for (first = 0; first < count - 1; ++first)
+    {
+        if (tcps_diff(tcb->sack_last, right[first]) > 0)
+            break;
+    }
+    int2be(sack, left[first]);
+    int2be(sack + 4, right[first]);
+    //others in sequence order
+    for (i = 0, size = 1; (i < count) && (size < TCP_SACK_BLOCKS_MAX); ++i)
+    {
+        if (i == first)
+            continue;
+        int2be(sack + size * 8, left[i]);
+        int2be(sack + size * 8 + 4, right[i]);
+        ++size;
+    }
+    tcps_append_opt(io, TCP_OPTS_SACK, sack, 2 + size * 8);
+}
+
 #if (TCP_DEBUG_PACKETS)
 static void tcps_debug(IO* io, const IP* src, const IP* dst)
 {
@@ -243,6 +315,9 @@ static void tcps_debug(IO* io, const IP* src, const IP* dst)
             case TCP_OPTS_MSS:
                 printf("MSS:%d", be2short(opt->data));
                 break;
+            case TCP_OPTS_SACK_PERMITTED:
+                printf("SACK_PERMITTED");
+                break;
             default:
                 printf("K%d", opt->kind);
                 for (j = 0; j < opt->len - 2; ++j)
@@ -329,13 +404,62 @@ static void tcps_rx_flush(TCPIPS* tcpips, HANDLE tcb_handle)
         ips_release_io(tcpips, tcb->rx_tmp);
         tcb->rx_tmp = NULL;
     }
+    tcpips->tcps.ooo_frames -= tcb->ooo_count;
+    while (tcb->ooo_count)
+        ips_release_io(tcpips, tcb->ooo[--tcb->ooo_count]);
+}
+
+static bool tcps_ooo_insert(TCPIPS* tcpips, TCP_TCB* tcb, IO* io, uint32_t seq)
+{
+    unsigned int i;
+    int diff;
+    if (tcb->ooo_count >= TCP_OOO_SIZE || tcpips->tcps.ooo_frames >= TCP_OOO_FRAMES_MAX)
+        return false;
+    //reported first in SACK, even if duplicate
+    tcb->sack_last = seq;
+    for (i = 0; i < tcb->ooo_count; ++i)
+    {
+        diff = tcps_diff(be2int(((TCP_HEADER*)io_data(tcb->ooo[i]))->seq_be), seq);
+        //already have
+        if (diff == 0)
+            return false;
+        if (diff < 0)
+            break;
+    }
+    memmove(&tcb->ooo[i + 1], &tcb->ooo[i], (tcb->ooo_count - i) * sizeof(IO*));
+    tcb->ooo[i] = io;
+    ++tcb->ooo_count;
+    ++tcpips->tcps.ooo_frames;
+    return true;
+}
+
+static bool tcps_ooo_holds(TCP_TCB* tcb, IO* io)
+{
+    unsigned int i;
+    for (i = 0; i < tcb->ooo_count; ++i)
+        if (tcb->ooo[i] == io)
+            return true;
+    return false;
+}
+
+static inline unsigned int tcps_hash(uint32_t ip, uint16_t remote_port, uint16_t local_port)
+{
+    uint32_t hash = ip ^ ((uint32_t)remote_port << 16) ^ local_port;
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+    return hash & (TCP_HASH_SIZE - 1);
+}
+
+static inline unsigned int tcps_listen_hash(uint16_t port)
+{
+    return (port ^ (port >> 8)) & (TCP_LISTEN_HASH_SIZE - 1);
 }
 
 static HANDLE tcps_find_listener(TCPIPS* tcpips, uint16_t port)
 {
     HANDLE handle;
     TCP_LISTEN_HANDLE* tlh;
-    for (handle = so_first(&tcpips->tcps.listen); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.listen, handle))
+    for (handle = tcpips->tcps.listen_hash[tcps_listen_hash(port)]; handle != INVALID_HANDLE; handle = tlh->next)
     {
         tlh = so_get(&tcpips->tcps.listen, handle);
         if (tlh->port == port)
@@ -344,11 +468,20 @@ static HANDLE tcps_find_listener(TCPIPS* tcpips, uint16_t port)
     return INVALID_HANDLE;
 }
 
+static void tcps_free_listener(TCPIPS* tcpips, HANDLE handle)
+{
+    HANDLE* cur;
+    TCP_LISTEN_HANDLE* tlh = so_get(&tcpips->tcps.listen, handle);
+    for (cur = &tcpips->tcps.listen_hash[tcps_listen_hash(tlh->port)]; *cur != handle; cur = &((TCP_LISTEN_HANDLE*)so_get(&tcpips->tcps.listen, *cur))->next) {}
+    *cur = tlh->next;
+    so_free(&tcpips->tcps.listen, handle);
+}
+
 static HANDLE tcps_find_tcb(TCPIPS* tcpips, const IP* src, uint16_t remote_port, uint16_t local_port)
 {
     HANDLE handle;
     TCP_TCB* tcb;
-    for (handle = so_first(&tcpips->tcps.tcbs); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.tcbs, handle))
+    for (handle = tcpips->tcps.tcb_hash[tcps_hash(src->u32.ip, remote_port, local_port)]; handle != INVALID_HANDLE; handle = tcb->next)
     {
         tcb = so_get(&tcpips->tcps.tcbs, handle);
         if (tcb->remote_port == remote_port && tcb->local_port == local_port && tcb->remote_addr.u32.ip == src->u32.ip)
@@ -374,6 +507,7 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
 {
     TCP_TCB* tcb;
     HANDLE handle;
+    HANDLE* bucket;
     if (so_count(&tcpips->tcps.tcbs) > TCP_HANDLES_LIMIT)
     {
         error(ERROR_TOO_MANY_HANDLES);
@@ -395,7 +529,7 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
     tcb->retry = 0;
     tcb->process = INVALID_HANDLE;
     tcb->remote_addr.u32.ip = remote_addr->u32.ip;
-    tcb->snd_una = tcb->snd_nxt = 0;
+    tcb->snd_una = tcb->snd_sent = tcb->snd_max = tcb->snd_nxt = 0;
     tcb->rcv_nxt = 0;
     tcb->state = TCP_STATE_CLOSED;
     tcb->remote_port = remote_port;
@@ -404,15 +538,25 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
     tcb->active = false;
     tcb->transmit = false;
     tcb->fin = false;
-    tcb->rx = tcb->tx = tcb->rx_tmp = NULL;
+    tcb->rx = tcb->rx_tmp = NULL;
+    tcb->tx_head = tcb->tx_count = tcb->tx_size = 0;
+    tcb->ooo_count = 0;
+    tcb->sack = tcb->sack_hole = false;
+    tcb->sack_left = tcb->snd_rexmit = tcb->sack_last = 0;
     tcb->tx_cur = 0;
     tcps_update_rx_wnd(tcb);
     tcb->tx_wnd = 0;
+    //index for rx demux
+    bucket = &tcpips->tcps.tcb_hash[tcps_hash(remote_addr->u32.ip, remote_port, local_port)];
+    tcb->next = *bucket;
+    *bucket = handle;
     return handle;
 }
 
 static void tcps_destroy_tcb(TCPIPS* tcpips, HANDLE tcb_handle)
 {
+    HANDLE* cur;
+    unsigned int i;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 #if (TCP_DEBUG_FLOW)
     printf("%s -> 0\n", __TCP_STATES[tcb->state]);
@@ -420,8 +564,11 @@ static void tcps_destroy_tcb(TCPIPS* tcpips, HANDLE tcb_handle)
     timer_stop(tcb->timer, tcb_handle, HAL_TCP);
     timer_destroy(tcb->timer);
     tcps_rx_flush(tcpips, tcb_handle);
-    if (tcb->tx)
-        io_complete_ex(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx, ERROR_CONNECTION_CLOSED);
+    for (i = 0; i < tcb->tx_count; ++i)
+        io_complete_ex(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, TCP_TX(tcb, i), ERROR_CONNECTION_CLOSED);
+    for (cur = &tcpips->tcps.tcb_hash[tcps_hash(tcb->remote_addr.u32.ip, tcb->remote_port, tcb->local_port)]; *cur != tcb_handle;
+         cur = &((TCP_TCB*)so_get(&tcpips->tcps.tcbs, *cur))->next) {}
+    *cur = tcb->next;
     so_free(&tcpips->tcps.tcbs, tcb_handle);
 }
 
@@ -485,8 +632,10 @@ static inline bool tcps_set_mss(TCP_TCB* tcb, uint16_t mss)
 
 static void tcps_apply_options(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
 {
-    int i;
+    int i, j;
+    uint32_t left;
     TCP_OPT* opt;
+    tcb->sack_hole = false;
     for (i = tcps_get_first_opt(io); i; i = tcps_get_next_opt(io, i))
     {
         opt = (TCP_OPT*)((uint8_t*)io_data(io) + i);
@@ -500,6 +649,21 @@ static void tcps_apply_options(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
             tcps_set_mss(tcpips, tcb, be2short(opt->data));
 #endif //ICMP
             break;
+        case TCP_OPTS_SACK_PERMITTED:
+            tcb->sack = true;
+            break;
+        case TCP_OPTS_SACK:
+            //find nearest hole end
+            for (j = 0; j + 8 <= opt->len - 2; j += 8)
+            {
+                left = be2int(opt->data + j);
+                if (tcps_diff(tcb->snd_una, left) > 0 && (!tcb->sack_hole || tcps_diff(tcb->sack_left, left) < 0))
+                {
+                    tcb->sack_left = left;
+                    tcb->sack_hole = true;
+                }
+            }
+            break;
         default:
             break;
         }
@@ -581,50 +745,102 @@ static void tcps_tx_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     tcp_tx->flags |= TCP_FLAG_ACK;
     int2be(tcp_tx->seq_be, tcb->snd_nxt);
     int2be(tcp_tx->ack_be, tcb->rcv_nxt);
+    tcps_append_sack(tx, tcb);
     tcps_tx(tcpips, tx, tcb);
     tcps_timer_start(tcb);
 }
 
-static void tcps_tx_text_ack_fin(TCPIPS* tcpips, HANDLE tcb_handle)
+static bool tcps_tx_text(TCPIPS* tcpips, TCP_TCB* tcb, uint32_t seq, unsigned int size, bool fin)
 {
     IO* io;
+    IO* tx;
     TCP_HEADER* tcp;
     TCP_STACK* tcp_stack;
-    unsigned int size;
-    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    unsigned int i, offset, chunk, data_offset;
 
     if ((io = tcps_allocate_io(tcpips, tcb)) == NULL)
-        return;
+        return false;
 
     tcp = io_data(io);
     tcp->flags |= TCP_FLAG_ACK;
-    int2be(tcp->seq_be, tcb->snd_una);
+    int2be(tcp->seq_be, seq);
     int2be(tcp->ack_be, tcb->rcv_nxt);
+    //options are not fit with full sized segment
+    if (size == 0)
+        tcps_append_sack(io, tcb);
+    data_offset = io->data_size;
+    //segment can span over few queued user blocks
+    offset = tcb->tx_cur + tcps_delta(tcb->snd_una, seq);
+    for (i = 0; size; ++i)
+    {
+        tx = TCP_TX(tcb, i);
+        if (offset >= tx->data_size)
+        {
+            offset -= tx->data_size;
+            continue;
+        }
+        chunk = tx->data_size - offset;
+        if (chunk > size)
+            chunk = size;
+        memcpy((uint8_t*)io_data(io) + io->data_size, (uint8_t*)io_data(tx) + offset, chunk);
+        //apply flags. Urgent pointer only from first block
+        tcp_stack = io_stack(tx);
+        if ((tcp_stack->flags & TCP_PSH) && (offset + chunk >= tx->data_size))
+            tcp->flags |= TCP_FLAG_PSH;
+        if ((tcp_stack->flags & TCP_URG) && (tcp_stack->urg_len > offset) && (io->data_size == data_offset))
+        {
+            tcp->flags |= TCP_FLAG_URG;
+            short2be(tcp->urgent_pointer_be, tcp_stack->urg_len - offset);
+        }
+        io->data_size += chunk;
+        size -= chunk;
+        offset = 0;
+    }
+    if (fin)
+        tcp->flags |= TCP_FLAG_FIN;
+    tcps_tx(tcpips, io, tcb);
+    return true;
+}
+
+//send not yet sent text and FIN up to peer window. If nothing to send, send ACK on request
+static void tcps_tx_text_ack_fin(TCPIPS* tcpips, HANDLE tcb_handle, bool ack)
+{
+    unsigned int in_flight, unsent, size, frames;
+    bool fin;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+
     //if no transmit window, request window update, wait timeout, than try again
     if (tcb->tx_wnd)
     {
-        if (tcb->tx != NULL)
+        //on frames exhaustion tcpips drops queued tx frames - own segments. Also keep one for rx
+        for (frames = tcpips_get_free_io_count(tcpips); frames > 1; --frames)
         {
-            size = tcb->tx->data_size - tcb->tx_cur;
-            if (size > tcb->tx_wnd)
-                size = tcb->tx_wnd;
-            memcpy((uint8_t*)io_data(io) + io->data_size, (uint8_t*)io_data(tcb->tx) + tcb->tx_cur, size);
-            io->data_size += size;
-            //apply flags
-            tcp_stack = io_stack(tcb->tx);
-            if ((tcp_stack->flags & TCP_PSH) && (tcb->tx_cur + size >= tcb->tx->data_size))
-                tcp->flags |= TCP_FLAG_PSH;
-            if ((tcp_stack->flags & TCP_URG) && (tcp_stack->urg_len > tcb->tx_cur))
+            in_flight = tcps_delta(tcb->snd_una, tcb->snd_sent);
+            unsent = tcb->tx_size > in_flight ? tcb->tx_size - in_flight : 0;
+            size = unsent;
+            if (size > tcb->mss)
+                size = tcb->mss;
+            if (in_flight + size > tcb->tx_wnd)
+                size = tcb->tx_wnd > in_flight ? tcb->tx_wnd - in_flight : 0;
+            //FIN is virtual byte after all text
+            fin = tcb->fin && (size == unsent) && (tcb->snd_sent + size != tcb->snd_nxt);
+            if (size == 0 && !fin)
+                break;
+            //not sent text will be retransmitted on timeout
+            if (!tcps_tx_text(tcpips, tcb, tcb->snd_sent, size, fin))
+                break;
+            tcb->snd_sent += size;
+            ack = false;
+            if (fin)
             {
-                tcp->flags |= TCP_FLAG_URG;
-                short2be(tcp->urgent_pointer_be, tcp_stack->urg_len - tcb->tx_cur);
+                ++tcb->snd_sent;
+                break;
             }
         }
-        else
-            size = 0;
-        if (tcb->fin && (tcb->snd_una != tcb->snd_nxt) && (size < tcb->tx_wnd))
-            tcp->flags |= TCP_FLAG_FIN;
-        tcps_tx(tcpips, io, tcb);
+        if (ack)
+            tcps_tx_text(tcpips, tcb, tcb->snd_sent, 0, false);
+        if (tcps_diff(tcb->snd_max, tcb->snd_sent) > 0)
+            tcb->snd_max = tcb->snd_sent;
     }
     tcps_timer_start(tcb);
 }
@@ -643,6 +859,7 @@ static void tcps_tx_syn(TCPIPS* tcpips, HANDLE tcb_handle)
     //SYN flag
     tcp->flags |= TCP_FLAG_SYN;
     tcps_append_mss(io);
+    tcps_append_sack_permitted(io);
 
     int2be(tcp->seq_be, tcb->snd_una);
     tcps_tx(tcpips, io, tcb);
@@ -663,6 +880,8 @@ static void tcps_tx_syn_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     //add ACK, SYN flags
     tcp->flags |= TCP_FLAG_ACK | TCP_FLAG_SYN;
     tcps_append_mss(io);
+    if (tcb->sack)
+        tcps_append_sack_permitted(io);
 
     int2be(tcp->seq_be, tcb->snd_una);
     int2be(tcp->ack_be, tcb->rcv_nxt);
@@ -755,6 +974,18 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
             tcps_timer_start(tcb);
             return false;
         }
+        //future text in window - hold for reassembly
+        switch (tcb->state)
+        {
+        case TCP_STATE_ESTABLISHED:
+        case TCP_STATE_FIN_WAIT_1:
+        case TCP_STATE_FIN_WAIT_2:
+            if (seq_delta > 0 && seg_len && (seq_delta + seg_len <= tcb->rx_wnd) && !(tcp->flags & TCP_FLAG_SYN))
+                tcps_ooo_insert(tcpips, tcb, io, seq);
+            break;
+        default:
+            break;
+        }
 
         tcps_tx_ack(tcpips, tcb_handle);
         return false;
@@ -765,17 +996,25 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
 static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
     int snd_diff, ack_diff;
+    unsigned int size;
+    IO* tx;
     TCP_HEADER* tcp;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     tcp = io_data(io);
-    snd_diff = tcps_diff(tcb->snd_una, tcb->snd_nxt);
+    //queued, but not sent yet text can't be acked
+    snd_diff = tcps_diff(tcb->snd_una, tcb->snd_max);
     ack_diff = tcps_diff(tcb->snd_una, be2int(tcp->ack_be));
 
     if (tcb->state == TCP_STATE_SYN_RECEIVED)
     {
-        //SND.UNA =< SEG.ACK =< SND.NXT
+        //SND.UNA =< SEG.ACK =< SND.MAX
         if (ack_diff >= 0 && ack_diff <= snd_diff)
         {
+            //SYN is acked: SND.UNA = SEG.ACK, before server-first text is sent
+            tcb->snd_una += ack_diff;
+            snd_diff -= ack_diff;
+            ack_diff = 0;
+            tcb->retry = 0;
             tcps_set_state(tcb, TCP_STATE_ESTABLISHED);
             ipc_post_inline(tcb->process, HAL_CMD(HAL_TCP, IPC_OPEN), tcb_handle, tcb_handle, 0);
             //and continue processing in that state if no data
@@ -790,34 +1029,54 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             return false;
         }
     }
-    //SEG.ACK > SND.NXT
+    //SEG.ACK > SND.MAX
     if (ack_diff > snd_diff)
     {
 #if (TCP_DEBUG_FLOW)
-        printf("TCP: SEG.ACK > SND.NEXT. Keep-alive?\n");
+        printf("TCP: SEG.ACK > SND.MAX. Keep-alive?\n");
 #endif //TCP_DEBUG_FLOW
         tcps_tx_ack(tcpips, tcb_handle);
         return false;
     }
 
-    if ((ack_diff > 0) || ((ack_diff == 0) && (tcb->snd_nxt == tcb->snd_una)))
+    if ((ack_diff > 0) || ((ack_diff == 0) && (tcb->snd_max == tcb->snd_una)))
         tcb->retry = 0;
+    //duplicate ack with SACK: retransmit first hole once, don't wait for timeout
+    if ((ack_diff == 0) && tcb->sack_hole && (tcb->snd_sent != tcb->snd_una) && (tcb->snd_rexmit != tcb->snd_una))
+    {
+        size = tcps_delta(tcb->snd_una, tcb->sack_left);
+        if (size > tcb->mss)
+            size = tcb->mss;
+        if (size > tcb->tx_size)
+            size = tcb->tx_size;
+        tcb->snd_rexmit = tcb->snd_una;
+        tcps_tx_text(tcpips, tcb, tcb->snd_una, size, false);
+    }
     //adjust ack
     if (ack_diff > 0)
     {
         tcb->snd_una += ack_diff;
-        if (tcb->tx != NULL)
+        //acked after retransmission start
+        if (tcps_diff(tcb->snd_sent, tcb->snd_una) > 0)
+            tcb->snd_sent = tcb->snd_una;
+        //cumulative ack: return all sent buffers to user
+        while (tcb->tx_count)
         {
-            if (ack_diff >= tcb->tx->data_size - tcb->tx_cur)
+            tx = TCP_TX(tcb, 0);
+            size = tx->data_size - tcb->tx_cur;
+            if (ack_diff < size)
             {
-                //return sent buffers to user
-                io_pop(tcb->tx, sizeof(TCP_STACK));
-                io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx);
-                tcb->tx = NULL;
-                tcb->tx_cur = 0;
-            }
-            else
                 tcb->tx_cur += ack_diff;
+                tcb->tx_size -= ack_diff;
+                break;
+            }
+            ack_diff -= size;
+            tcb->tx_size -= size;
+            tcb->tx_cur = 0;
+            tcb->tx_head = (tcb->tx_head + 1) % TCP_TX_QUEUE_SIZE;
+            --tcb->tx_count;
+            io_pop(tx, sizeof(TCP_STACK));
+            io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tx);
         }
     }
 
@@ -953,7 +1212,54 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     }
 }
 
-static inline bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
+static bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle);
+
+//process held segments, which are in sequence now
+static bool tcps_rx_ooo(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    IO* io;
+    TCP_HEADER* tcp;
+    int head;
+    unsigned int data_len, data_offset;
+    bool fin;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    while (tcb->ooo_count)
+    {
+        io = tcb->ooo[0];
+        tcp = io_data(io);
+        head = tcps_diff(be2int(tcp->seq_be), tcb->rcv_nxt);
+        //still hole
+        if (head < 0)
+            break;
+        memmove(&tcb->ooo[0], &tcb->ooo[1], (--tcb->ooo_count) * sizeof(IO*));
+        --tcpips->tcps.ooo_frames;
+        data_len = tcps_data_len(io);
+        fin = (tcp->flags & TCP_FLAG_FIN) != 0;
+        //duplicate or don't fit tmp buffer anymore
+        if ((head > data_len) || (head == data_len && !fin) ||
+            (tcb->rx == NULL && tcb->rx_tmp != NULL && data_len - head > io_get_free(tcb->rx_tmp)))
+        {
+            ips_release_io(tcpips, io);
+            continue;
+        }
+        //remove already received part
+        if (head)
+        {
+            data_offset = tcps_data_offset(io);
+            memmove((uint8_t*)io_data(io) + data_offset, (uint8_t*)io_data(io) + data_offset + head, data_len - head);
+            io->data_size -= head;
+            tcp->flags &= ~TCP_FLAG_URG;
+        }
+        tcps_rx_text(tcpips, io, tcb_handle);
+        if (tcb->rx_tmp != io)
+            ips_release_io(tcpips, io);
+        if (fin)
+            return tcps_rx_otw_fin(tcpips, tcb_handle);
+    }
+    return true;
+}
+
+static bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 
@@ -1001,7 +1307,8 @@ static inline void tcps_rx_send(TCPIPS* tcpips, HANDLE tcb_handle)
 #endif //TCP_KEEP_ALIVE
         return;
     }
-    tcps_tx_text_ack_fin(tcpips, tcb_handle);
+    //no pure ACK on ACK of text in flight
+    tcps_tx_text_ack_fin(tcpips, tcb_handle, tcb->rx_cur || !tcb->transmit || (tcb->snd_sent == tcb->snd_una));
 }
 
 static inline void tcps_rx_closed(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
@@ -1046,7 +1353,7 @@ static inline void tcps_rx_listen(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             tcps_set_state(tcb, TCP_STATE_SYN_RECEIVED);
             tcb->rcv_nxt = be2int(tcp->seq_be) + 1;
             tcb->snd_una = tcb->snd_nxt = tcps_gen_isn();
-            ++tcb->snd_nxt;
+            tcb->snd_sent = tcb->snd_max = ++tcb->snd_nxt;
 
             tcps_tx_syn_ack(tcpips, tcb_handle);
             return;
@@ -1071,7 +1378,8 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     {
         ack = be2int(tcp->ack_be);
         ack_diff = tcps_diff(tcb->snd_una, ack);
-        if (ack_diff < 0)
+        //only SYN is sent
+        if ((ack_diff < 0) || (ack_diff > tcps_diff(tcb->snd_una, tcb->snd_max)))
         {
             if ((tcp->flags & TCP_FLAG_RST) == 0)
                 tcps_tx_rst(tcpips, tcb_handle, ack);
@@ -1099,6 +1407,7 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     {
         if (ack_diff)
         {
+            tcb->snd_una += ack_diff;
             ++tcb->rcv_nxt;
             tcps_set_state(tcb, TCP_STATE_ESTABLISHED);
             //inform user connected successfully
@@ -1147,6 +1456,9 @@ static inline void tcps_rx_otw(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         if (!tcps_rx_otw_fin(tcpips, tcb_handle))
             return;
     }
+    //gap filled? Continue with held segments
+    else if (!tcps_rx_ooo(tcpips, tcb_handle))
+        return;
 
     //finally send ACK reply/data/fin/etc
     tcps_rx_send(tcpips, tcb_handle);
@@ -1174,8 +1486,14 @@ static inline void tcps_rx_process(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 
 void tcps_init(TCPIPS* tcpips)
 {
+    int i;
     so_create(&tcpips->tcps.listen, sizeof(TCP_LISTEN_HANDLE), 1);
     so_create(&tcpips->tcps.tcbs, sizeof(TCP_TCB), 1);
+    tcpips->tcps.ooo_frames = 0;
+    for (i = 0; i < TCP_HASH_SIZE; ++i)
+        tcpips->tcps.tcb_hash[i] = INVALID_HANDLE;
+    for (i = 0; i < TCP_LISTEN_HASH_SIZE; ++i)
+        tcpips->tcps.listen_hash[i] = INVALID_HANDLE;
 }
 
 void tcps_link_changed(TCPIPS* tcpips, bool link)
@@ -1187,7 +1505,7 @@ void tcps_link_changed(TCPIPS* tcpips, bool link)
         while((handle = so_first(&tcpips->tcps.tcbs)) != INVALID_HANDLE)
             tcps_close_connection(tcpips, handle, ERROR_CONNECTION_CLOSED);
         while((handle = so_first(&tcpips->tcps.listen)) != INVALID_HANDLE)
-            so_free(&tcpips->tcps.listen, handle);
+            tcps_free_listener(tcpips, handle);
     }
 }
 
@@ -1231,8 +1549,8 @@ void tcps_rx(TCPIPS* tcpips, IO* io, IP* src)
         tcb->tx_wnd = be2short(tcp->window_be);
         tcb->rx_cur = 0;
         tcps_rx_process(tcpips, io, tcb_handle);
-        //make sure not queued in rx
-        if (tcb->rx_tmp == io)
+        //make sure not queued in rx or held for reassembly
+        if (tcb->rx_tmp == io || tcps_ooo_holds(tcb, io))
             return;
     }
     ips_release_io(tcpips, io);
@@ -1241,6 +1559,7 @@ void tcps_rx(TCPIPS* tcpips, IO* io, IP* src)
 static inline void tcps_listen(TCPIPS* tcpips, IPC* ipc)
 {
     HANDLE handle;
+    HANDLE* bucket;
     TCP_LISTEN_HANDLE* tlh;
     if (tcps_find_listener(tcpips, (uint16_t)ipc->param1) != INVALID_HANDLE)
     {
@@ -1253,12 +1572,17 @@ static inline void tcps_listen(TCPIPS* tcpips, IPC* ipc)
     tlh = so_get(&tcpips->tcps.listen, handle);
     tlh->port = (uint16_t)ipc->param1;
     tlh->process = ipc->process;
+    bucket = &tcpips->tcps.listen_hash[tcps_listen_hash(tlh->port)];
+    tlh->next = *bucket;
+    *bucket = handle;
     ipc->param2 = handle;
 }
 
 static inline void tcps_close_listen(TCPIPS* tcpips, HANDLE handle)
 {
-    so_free(&tcpips->tcps.listen, handle);
+    if (!so_check_handle(&tcpips->tcps.listen, handle))
+        return;
+    tcps_free_listener(tcpips, handle);
 }
 
 static HANDLE tcps_create_tcb(TCPIPS* tcpips, uint16_t remote_port, const IP* remote_addr, HANDLE process)
@@ -1313,7 +1637,7 @@ static inline void tcps_open(TCPIPS* tcpips, HANDLE tcb_handle)
     }
     tcps_set_state(tcb, TCP_STATE_SYN_SENT);
     tcb->snd_una = tcb->snd_nxt = tcps_gen_isn();
-    ++tcb->snd_nxt;
+    tcb->snd_sent = tcb->snd_max = ++tcb->snd_nxt;
     tcps_tx_syn(tcpips, tcb_handle);
     error(ERROR_SYNC);
 }
@@ -1330,7 +1654,7 @@ static inline void tcps_close(TCPIPS* tcpips, HANDLE tcb_handle)
         tcb->fin = true;
         ++tcb->snd_nxt;
         tcps_rx_flush(tcpips, tcb_handle);
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
         error(ERROR_SYNC);
         break;
     case TCP_STATE_LAST_ACK:
@@ -1443,17 +1767,18 @@ static inline void tcps_write(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
         error(ERROR_INVALID_STATE);
         return;
     }
-    if (tcb->tx != NULL)
+    if (tcb->tx_count >= TCP_TX_QUEUE_SIZE)
     {
         error(ERROR_IN_PROGRESS);
         return;
     }
     timer_stop(tcb->timer, tcb_handle, HAL_TCP);
 
-    tcb->tx = io;
+    TCP_TX(tcb, tcb->tx_count++) = io;
+    tcb->tx_size += io->data_size;
     tcb->snd_nxt += io->data_size;
     tcb->transmit = true;
-    tcps_tx_text_ack_fin(tcpips, tcb_handle);
+    tcps_tx_text_ack_fin(tcpips, tcb_handle, false);
     error(ERROR_SYNC);
 }
 
@@ -1480,7 +1805,7 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
         printf(":%u\n", tcb->remote_port);
 #endif //TCP_DEBUG_FLOW
         tcb->transmit = true;
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
         return;
     }
 #endif //TCP_KEEP_ALIVE
@@ -1505,7 +1830,9 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
         tcps_tx_syn(tcpips, tcb_handle);
         break;
     default:
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        //retransmit all in flight from queue
+        tcb->snd_sent = tcb->snd_una;
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
         break;
     }
 }
@@ -25,9 +25,16 @@
 #define TCP_OPTS_END                                0
 #define TCP_OPTS_NOOP                               1
 #define TCP_OPTS_MSS                                2
+#define TCP_OPTS_SACK_PERMITTED                     4
+#define TCP_OPTS_SACK                               5
 
 typedef struct {
     SO listen, tcbs;
+    //RX demux: chains of handles
+    HANDLE tcb_hash[TCP_HASH_SIZE];
+    HANDLE listen_hash[TCP_LISTEN_HASH_SIZE];
+    //out of order segments, held by all connections
+    unsigned int ooo_frames;
     uint16_t dynamic;
 } TCPS;
 
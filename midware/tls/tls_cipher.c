@@ -1279,43 +1279,43 @@ bool tls_cipher_compare_finished(TLS_CIPHER* tls_cipher, TLS_FINISHED_MODE mode,
     return memcmp(dig, data, TLS_FINISHED_DIGEST_SIZE) == 0;
 }
 
-bool tls_cipher_decode_key_block(const void* premaster, TLS_CIPHER *tls_cipher)
+bool tls_cipher_generate_key_block(TLS_CIPHER *tls_cipher)
 {
     uint8_t* raw;
-    bool res;
     unsigned int raw_size = (tls_cipher->hash_size + tls_cipher->key_size) << 1;
     raw = malloc(raw_size);
     if (raw == NULL)
         return false;
 
-    res = false;
-    //decode pkcs padding
-    do {
-        if (eme_pkcs1_v1_15_decode(premaster, TLS_RAW_PREMASTER_SIZE, tls_cipher->master, TLS_PREMASTER_SIZE) < sizeof(TLS_PREMASTER_SIZE))
-            break;
-        //decode master from premaster
-        p_hash(tls_cipher->master, TLS_PREMASTER_SIZE, __MASTER_LABEL, MASTER_LABEL_LEN,
-                                   tls_cipher->client_random, TLS_RANDOM_SIZE,
-                                   tls_cipher->server_random, TLS_RANDOM_SIZE,
-                                   tls_cipher->master, TLS_MASTER_SIZE);
-
-        //genarate raw key block. Server here goes first
-        p_hash(tls_cipher->master, TLS_MASTER_SIZE, __KEY_BLOCK_LABEL, KEY_BLOCK_LABEL_LEN,
-                                    tls_cipher->server_random, TLS_RANDOM_SIZE,
-                                    tls_cipher->client_random, TLS_RANDOM_SIZE,
-                                    raw, raw_size);
+    //genarate raw key block. Server here goes first
+    p_hash(tls_cipher->master, TLS_MASTER_SIZE, __KEY_BLOCK_LABEL, KEY_BLOCK_LABEL_LEN,
+                                tls_cipher->server_random, TLS_RANDOM_SIZE,
+                                tls_cipher->client_random, TLS_RANDOM_SIZE,
+                                raw, raw_size);
 
-        hmac_setup(&tls_cipher->rx_hmac_ctx, tls_cipher->hash_struct, tls_cipher->rx_hash_ctx, raw, tls_cipher->hash_size);
-        hmac_setup(&tls_cipher->tx_hmac_ctx, tls_cipher->hash_struct, tls_cipher->tx_hash_ctx, raw + tls_cipher->hash_size, tls_cipher->hash_size);
-        AES_set_decrypt_key(raw + (tls_cipher->hash_size << 1), 128, &tls_cipher->rx_key);
-        AES_set_encrypt_key(raw + (tls_cipher->hash_size << 1) + tls_cipher->key_size, 128, &tls_cipher->tx_key);
-        //MAC, IV, padding (same as IV), extra padding byte
-        tls_cipher->max_data_size -= tls_cipher->hash_size + 2 * tls_cipher->block_size + 1;
-        res = true;
-    } while(false);
+    hmac_setup(&tls_cipher->rx_hmac_ctx, tls_cipher->hash_struct, tls_cipher->rx_hash_ctx, raw, tls_cipher->hash_size);
+    hmac_setup(&tls_cipher->tx_hmac_ctx, tls_cipher->hash_struct, tls_cipher->tx_hash_ctx, raw + tls_cipher->hash_size, tls_cipher->hash_size);
+    AES_set_decrypt_key(raw + (tls_cipher->hash_size << 1), 128, &tls_cipher->rx_key);
+    AES_set_encrypt_key(raw + (tls_cipher->hash_size << 1) + tls_cipher->key_size, 128, &tls_cipher->tx_key);
+    //MAC, IV, padding (same as IV), extra padding byte
+    tls_cipher->max_data_size -= tls_cipher->hash_size + 2 * tls_cipher->block_size + 1;
 
+    memset(raw, 0x00, raw_size);
     free (raw);
-    return res;
+    return true;
+}
+
+bool tls_cipher_decode_key_block(const void* premaster, TLS_CIPHER *tls_cipher)
+{
+    //decode pkcs padding
+    if (eme_pkcs1_v1_15_decode(premaster, TLS_RAW_PREMASTER_SIZE, tls_cipher->master, TLS_PREMASTER_SIZE) < sizeof(TLS_PREMASTER_SIZE))
+        return false;
+    //decode master from premaster
+    p_hash(tls_cipher->master, TLS_PREMASTER_SIZE, __MASTER_LABEL, MASTER_LABEL_LEN,
+                               tls_cipher->client_random, TLS_RANDOM_SIZE,
+                               tls_cipher->server_random, TLS_RANDOM_SIZE,
+                               tls_cipher->master, TLS_MASTER_SIZE);
+    return tls_cipher_generate_key_block(tls_cipher);
 }
 
 int tls_cipher_decrypt(TLS_CIPHER* tls_cipher, TLS_CONTENT_TYPE content_type, void* in, unsigned int len)
@@ -51,6 +51,7 @@ void tls_cipher_hash_handshake(TLS_CIPHER* tls_cipher, const void* data, unsigne
 void tls_cipher_generate_finished(TLS_CIPHER* tls_cipher, TLS_FINISHED_MODE mode, void* out);
 bool tls_cipher_compare_finished(TLS_CIPHER* tls_cipher, TLS_FINISHED_MODE mode, const void* data);
 
+bool tls_cipher_generate_key_block(TLS_CIPHER *tls_cipher);
 bool tls_cipher_decode_key_block(const void* premaster, TLS_CIPHER *tls_cipher);
 
 int tls_cipher_decrypt(TLS_CIPHER* tls_cipher, TLS_CONTENT_TYPE content_type, void* in, unsigned int len);
@@ -15,6 +15,7 @@
 #include "../../userspace/so.h"
 #include "../../userspace/tcp.h"
 #include "../../userspace/endian.h"
+#include "../../userspace/systime.h"
 #include "../crypto/aes.h"
 #include <string.h>
 
@@ -39,30 +40,45 @@ typedef enum {
 
 typedef struct {
     HANDLE handle;
+    //user IO
     IO* rx;
     IO* tx;
-#if (TLS_DEBUG_REQUESTS)
+    //session records IO
+    IO* tcp_rx;
+    IO* tcp_tx;
+#if (TLS_DEBUG_REQUESTS) || (TLS_DEBUG_ERRORS)
     IP remote_addr;
-#endif //TLS_DEBUG_REQUESTS
-    unsigned int rx_size, tx_offset;
+#endif //(TLS_DEBUG_REQUESTS) || (TLS_DEBUG_ERRORS)
+    void* pending_data;
+    unsigned int rx_size, tx_offset, offset, pending_len;
     TLS_PROTOCOL_VERSION version;
     TLS_CIPHER tls_cipher;
     uint8_t session_id[TLS_SESSION_ID_SIZE];
     TLSS_STATE state;
     uint16_t cipher_suite;
-    bool server_secure, client_secure;
+    bool server_secure, client_secure, rx_busy, tx_busy, resumed;
 } TLSS_TCB;
 
+#if (TLS_SESSION_CACHE_SIZE)
 typedef struct {
-    HANDLE tcpip, user, owner, tcb_handle;
+    uint8_t session_id[TLS_SESSION_ID_SIZE];
+    uint8_t master[TLS_MASTER_SIZE];
+    uint16_t cipher_suite;
+    //uptime seconds
+    unsigned int last_used;
+    bool valid;
+} TLSS_SESSION;
+#endif //TLS_SESSION_CACHE_SIZE
+
+typedef struct {
+    HANDLE tcpip, user, owner;
     uint8_t* cert;
-    void* pending_data;
     unsigned int cert_len;
-    unsigned int offset, pending_len;
-    IO* rx;
-    IO* tx;
     SO tcbs;
-    bool rx_busy, tx_busy;
+#if (TLS_SESSION_CACHE_SIZE)
+    TLSS_SESSION sessions[TLS_SESSION_CACHE_SIZE];
+    TLS_SESSION_CACHE_STAT sessions_stat;
+#endif //TLS_SESSION_CACHE_SIZE
 } TLSS;
 
 const REX __TLSS = {
@@ -250,12 +266,81 @@ static void tlss_set_state(TLSS_TCB* tcb, TLSS_STATE new_state)
     tcb->state = new_state;
 }
 
+static void tlss_destroy_io(IO* io)
+{
+    //IO in use by tcpip/owner will be destroyed on return
+    io_destroy(io);
+    error(ERROR_OK);
+}
+
+#if (TLS_SESSION_CACHE_SIZE)
+static unsigned int tlss_uptime()
+{
+    SYSTIME uptime;
+    get_uptime(&uptime);
+    return uptime.sec;
+}
+
+static void tlss_session_erase(TLSS_SESSION* session)
+{
+    memset(session, 0x00, sizeof(TLSS_SESSION));
+}
+
+static TLSS_SESSION* tlss_session_find(TLSS* tlss, const uint8_t* session_id)
+{
+    int i;
+    unsigned int uptime = tlss_uptime();
+    for (i = 0; i < TLS_SESSION_CACHE_SIZE; ++i)
+    {
+        if (!tlss->sessions[i].valid || memcmp(tlss->sessions[i].session_id, session_id, TLS_SESSION_ID_SIZE))
+            continue;
+        if (uptime - tlss->sessions[i].last_used >= TLS_SESSION_CACHE_TTL)
+        {
+            tlss_session_erase(&tlss->sessions[i]);
+            return NULL;
+        }
+        return &tlss->sessions[i];
+    }
+    return NULL;
+}
+
+static void tlss_session_store(TLSS* tlss, TLSS_TCB* tcb)
+{
+    int i;
+    TLSS_SESSION* session = NULL;
+    unsigned int uptime = tlss_uptime();
+    //free entry or least recently used
+    for (i = 0; i < TLS_SESSION_CACHE_SIZE; ++i)
+    {
+        if (!tlss->sessions[i].valid)
+        {
+            session = &tlss->sessions[i];
+            break;
+        }
+        if ((session == NULL) || (uptime - tlss->sessions[i].last_used > uptime - session->last_used))
+            session = &tlss->sessions[i];
+    }
+    memcpy(session->session_id, tcb->session_id, TLS_SESSION_ID_SIZE);
+    memcpy(session->master, tcb->tls_cipher.master, TLS_MASTER_SIZE);
+    session->cipher_suite = tcb->cipher_suite;
+    session->last_used = uptime;
+    session->valid = true;
+}
+
+static void tlss_session_invalidate(TLSS* tlss, TLSS_TCB* tcb)
+{
+    //session id is empty, if not assigned yet
+    TLSS_SESSION* session = tlss_session_find(tlss, tcb->session_id);
+    if (session != NULL)
+        tlss_session_erase(session);
+}
+#endif //TLS_SESSION_CACHE_SIZE
+
 static HANDLE tlss_create_tcb(TLSS* tlss, HANDLE handle)
 {
     TLSS_TCB* tcb;
     HANDLE tcb_handle;
-    //TODO: multiple sessions support
-    if (so_count(&tlss->tcbs))
+    if (so_count(&tlss->tcbs) >= TLS_SESSIONS_MAX)
         return INVALID_HANDLE;
     tcb_handle = so_allocate(&tlss->tcbs);
     if (tcb_handle == INVALID_HANDLE)
@@ -263,6 +348,15 @@ static HANDLE tlss_create_tcb(TLSS* tlss, HANDLE handle)
     tcb = so_get(&tlss->tcbs, tcb_handle);
     tls_cipher_init(&tcb->tls_cipher);
     memset(tcb, 0x00, sizeof(TLSS_TCB));
+    tcb->tcp_rx = io_create(TLS_IO_SIZE + sizeof(TCP_STACK));
+    tcb->tcp_tx = io_create(TLS_IO_SIZE + sizeof(TCP_STACK));
+    if (tcb->tcp_rx == NULL || tcb->tcp_tx == NULL)
+    {
+        io_destroy(tcb->tcp_rx);
+        io_destroy(tcb->tcp_tx);
+        so_free(&tlss->tcbs, tcb_handle);
+        return INVALID_HANDLE;
+    }
     tcb->handle = handle;
     tcb->state = TLSS_STATE_CLIENT_HELLO;
     tcb->version = TLS_PROTOCOL_VERSION_UNSUPPORTED;
@@ -278,6 +372,8 @@ static void tlss_destroy_tcb(TLSS* tlss, HANDLE tcb_handle)
     printf("TLS: %s -> 0\n", __TLSS_STATES[tcb->state]);
 #endif //TLS_DEBUG_REQUESTS
     tls_cipher_destroy(&tcb->tls_cipher);
+    tlss_destroy_io(tcb->tcp_rx);
+    tlss_destroy_io(tcb->tcp_tx);
     memset(tcb, 0x00, sizeof(TLSS_TCB));
     so_free(&tlss->tcbs, tcb_handle);
 }
@@ -300,19 +396,20 @@ static void tlss_flush(TLSS* tlss, HANDLE tcb_handle)
     TLSS_TCB* tcb = so_get(&tlss->tcbs, tcb_handle);
     if (tcb->rx != NULL)
     {
-        io_complete_ex(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_READ), tlss->tcb_handle, tcb->rx, ERROR_IO_CANCELLED);
+        io_complete_ex(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_READ), tcb_handle, tcb->rx, ERROR_IO_CANCELLED);
         tcb->rx = NULL;
     }
     if (tcb->tx != NULL)
     {
-        io_complete_ex(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tlss->tcb_handle, tcb->tx, ERROR_IO_CANCELLED);
+        io_complete_ex(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx, ERROR_IO_CANCELLED);
         tcb->tx = NULL;
     }
     if (tcb->state == TLSS_STATE_PENDING)
+    {
         tcb->state = TLSS_STATE_READY;
-    //active session
-    if (tlss->tcb_handle == tcb_handle)
-        tlss->tcb_handle = INVALID_HANDLE;
+        //drop rest of received records
+        tcb->offset = tcb->tcp_rx->data_size;
+    }
     if (tcb->state == TLSS_STATE_READY)
         tcp_flush(tlss->tcpip, tcb->handle);
 }
@@ -329,35 +426,28 @@ static void tlss_close_session(TLSS* tlss, HANDLE tcb_handle, bool close_tcp)
     tlss_destroy_tcb(tlss, tcb_handle);
 }
 
-static void tlss_tcp_rx(TLSS* tlss)
+static void tlss_tcp_rx(TLSS* tlss, TLSS_TCB* tcb)
 {
-    HANDLE tcb_handle;
-    TLSS_TCB* tcb;
     //already reading (wakeup by tx complete, user request, etc)
-    if (tlss->rx_busy)
+    if (tcb->rx_busy)
         return;
-    //TODO: refactor to listen handles for multiple sessions support
-    tlss->offset = 0;
-    if ((tcb_handle = so_first(&tlss->tcbs)) != INVALID_HANDLE)
-    {
-        tcb = so_get(&tlss->tcbs, tcb_handle);
-        tlss->rx_busy = true;
-        tcp_read(tlss->tcpip, tcb->handle, tlss->rx, TLS_IO_SIZE);
-    }
+    tcb->offset = 0;
+    tcb->rx_busy = true;
+    tcp_read(tlss->tcpip, tcb->handle, tcb->tcp_rx, TLS_IO_SIZE);
 }
 
 static void tlss_tcp_tx(TLSS* tlss, TLSS_TCB* tcb)
 {
     TCP_STACK* stack;
-    tlss->tx_busy = true;
-    stack = io_push(tlss->tx, sizeof(TCP_STACK));
+    tcb->tx_busy = true;
+    stack = io_push(tcb->tcp_tx, sizeof(TCP_STACK));
     stack->flags = TCP_PSH;
-    tcp_write(tlss->tcpip, tcb->handle, tlss->tx);
+    tcp_write(tlss->tcpip, tcb->handle, tcb->tcp_tx);
 }
 
-static inline void tlss_connection_established(TLSS* tlss, TLSS_TCB* tcb)
+static inline void tlss_connection_established(TLSS* tlss, HANDLE tcb_handle)
 {
-    ipc_post_inline(tlss->user, HAL_CMD(HAL_TCP, IPC_OPEN), tlss->tcb_handle, tlss->tcb_handle, 0);
+    ipc_post_inline(tlss->user, HAL_CMD(HAL_TCP, IPC_OPEN), tcb_handle, tcb_handle, 0);
 }
 
 static unsigned int tlss_get_size(TLS_SIZE* tls_size)
@@ -377,23 +467,23 @@ static void tlss_set_size(TLS_SIZE* tls_size, unsigned int value)
 
 static void* tlss_allocate_record(TLSS* tlss, TLSS_TCB* tcb, TLS_CONTENT_TYPE content_type)
 {
-    TLS_RECORD* rec = (TLS_RECORD*)((uint8_t*)io_data(tlss->tx) + tlss->tx->data_size);
+    TLS_RECORD* rec = (TLS_RECORD*)((uint8_t*)io_data(tcb->tcp_tx) + tcb->tcp_tx->data_size);
     rec->content_type = content_type;
     rec->version.major = 3;
     rec->version.minor = (uint8_t)tcb->version;
     short2be(rec->record_length_be, 0);
-    return (uint8_t*)io_data(tlss->tx) + tlss->tx->data_size + sizeof(TLS_RECORD) + (tcb->server_secure ? tcb->tls_cipher.block_size : 0);
+    return (uint8_t*)io_data(tcb->tcp_tx) + tcb->tcp_tx->data_size + sizeof(TLS_RECORD) + (tcb->server_secure ? tcb->tls_cipher.block_size : 0);
 }
 
 static void tlss_send_record(TLSS* tlss, TLSS_TCB* tcb, unsigned int len)
 {
-    TLS_RECORD* rec = (TLS_RECORD*)((uint8_t*)io_data(tlss->tx) + tlss->tx->data_size);
+    TLS_RECORD* rec = (TLS_RECORD*)((uint8_t*)io_data(tcb->tcp_tx) + tcb->tcp_tx->data_size);
 
     if (tcb->server_secure)
-        len = tls_cipher_encrypt(&tcb->tls_cipher, rec->content_type, (uint8_t*)io_data(tlss->tx) + tlss->tx->data_size + sizeof(TLS_RECORD), len);
+        len = tls_cipher_encrypt(&tcb->tls_cipher, rec->content_type, (uint8_t*)io_data(tcb->tcp_tx) + tcb->tcp_tx->data_size + sizeof(TLS_RECORD), len);
     //Update full record len
     short2be(rec->record_length_be, len);
-    tlss->tx->data_size += len + sizeof(TLS_RECORD);
+    tcb->tcp_tx->data_size += len + sizeof(TLS_RECORD);
 }
 
 static void tlss_user_tx(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb)
@@ -523,19 +613,6 @@ static unsigned int tlss_append_server_hello_done(TLSS* tlss, TLSS_TCB* tcb, voi
     return sizeof(TLS_HANDSHAKE);
 }
 
-static inline void tlss_tx_server_hello(TLSS* tlss, TLSS_TCB* tcb)
-{
-    void* data;
-    unsigned int len = 0;
-    data = tlss_allocate_record(tlss, tcb, TLS_CONTENT_HANDSHAKE);
-    len += tlss_append_server_hello(tlss, tcb, (uint8_t*)data + len);
-    len += tlss_append_certificate(tlss, tcb, (uint8_t*)data + len);
-    len += tlss_append_server_hello_done(tlss, tcb, (uint8_t*)data + len);
-    tlss_send_record(tlss, tcb, len);
-    tlss_set_state(tcb, TLSS_STATE_CLIENT_KEY_EXCHANGE);
-    tlss_tcp_tx(tlss, tcb);
-}
-
 static unsigned int tlss_append_server_change_cipher_spec(TLSS* tlss, TLSS_TCB* tcb, void* data)
 {
     *((uint8_t*)data) = TLS_CHANGE_CIPHER_SPEC;
@@ -557,15 +634,15 @@ static unsigned int tlss_append_server_finished(TLSS* tlss, TLSS_TCB* tcb, void*
     tls_cipher_generate_finished(&tcb->tls_cipher, TLS_SERVER_FINISHED, (uint8_t*)data + len);
     len += TLS_FINISHED_DIGEST_SIZE;
 
-    //this message itself not included in hash
-    tls_cipher_hash_handshake(&tcb->tls_cipher, data, sizeof(TLS_HANDSHAKE));
+    //required for client finished on abbreviated handshake
+    tls_cipher_hash_handshake(&tcb->tls_cipher, data, len);
 #if (TLS_DEBUG_REQUESTS)
     printf("TLS: (server) finished\n");
 #endif //TLS_DEBUG_REQUESTS
     return len;
 }
 
-static inline void tlss_tx_server_change_cipher_spec(TLSS* tlss, TLSS_TCB* tcb)
+static void tlss_send_server_finished(TLSS* tlss, TLSS_TCB* tcb)
 {
     void* data;
     unsigned int len = 0;
@@ -579,16 +656,24 @@ static inline void tlss_tx_server_change_cipher_spec(TLSS* tlss, TLSS_TCB* tcb)
     data = tlss_allocate_record(tlss, tcb, TLS_CONTENT_HANDSHAKE);
     len += tlss_append_server_finished(tlss, tcb, (uint8_t*)data + len);
     tlss_send_record(tlss, tcb, len);
+}
 
+static inline void tlss_tx_server_change_cipher_spec(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb)
+{
+    tlss_send_server_finished(tlss, tcb);
     tlss_set_state(tcb, TLSS_STATE_READY);
     tlss_tcp_tx(tlss, tcb);
 
-    tlss_connection_established(tlss, tcb);
+    tlss_connection_established(tlss, tcb_handle);
 }
 
 static void tlss_tx_alert(TLSS* tlss, TLSS_TCB* tcb, TLS_ALERT_LEVEL alert_level, TLS_ALERT_DESCRIPTION alert_description)
 {
-    TLS_ALERT* alert = tlss_allocate_record(tlss, tcb, TLS_CONTENT_ALERT);
+    TLS_ALERT* alert;
+    //records IO is in use. Alert is dropped, session will be closed on tx complete
+    if (tcb->tx_busy)
+        return;
+    alert = tlss_allocate_record(tlss, tcb, TLS_CONTENT_ALERT);
     alert->alert_level = alert_level;
     alert->alert_description = alert_description;
 #if (TLS_DEBUG_REQUESTS)
@@ -603,10 +688,41 @@ static void tlss_tx_alert(TLSS* tlss, TLSS_TCB* tcb, TLS_ALERT_LEVEL alert_level
 
 static void tlss_fatal(TLSS* tlss, TLSS_TCB* tcb, TLS_ALERT_DESCRIPTION alert_description)
 {
+#if (TLS_SESSION_CACHE_SIZE)
+    //failed session can't be resumed
+    tlss_session_invalidate(tlss, tcb);
+#endif //TLS_SESSION_CACHE_SIZE
     tcb->state = TLSS_STATE_CLOSING;
     tlss_tx_alert(tlss, tcb, TLS_ALERT_LEVEL_FATAL, alert_description);
 }
 
+static inline void tlss_tx_server_hello(TLSS* tlss, TLSS_TCB* tcb)
+{
+    void* data;
+    unsigned int len = 0;
+    //abbreviated handshake: keys from cached master, server is first to change cipher spec
+    if (tcb->resumed && !tls_cipher_generate_key_block(&tcb->tls_cipher))
+    {
+        tlss_fatal(tlss, tcb, TLS_ALERT_INTERNAL_ERROR);
+        return;
+    }
+    data = tlss_allocate_record(tlss, tcb, TLS_CONTENT_HANDSHAKE);
+    len += tlss_append_server_hello(tlss, tcb, (uint8_t*)data + len);
+    if (tcb->resumed)
+    {
+        tlss_send_record(tlss, tcb, len);
+        tlss_send_server_finished(tlss, tcb);
+        tlss_set_state(tcb, TLSS_STATE_CLIENT_CHANGE_CIPHER_SPEC);
+        tlss_tcp_tx(tlss, tcb);
+        return;
+    }
+    len += tlss_append_certificate(tlss, tcb, (uint8_t*)data + len);
+    len += tlss_append_server_hello_done(tlss, tcb, (uint8_t*)data + len);
+    tlss_send_record(tlss, tcb, len);
+    tlss_set_state(tcb, TLSS_STATE_CLIENT_KEY_EXCHANGE);
+    tlss_tcp_tx(tlss, tcb);
+}
+
 static inline void tlss_rx_change_cipher(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned int len)
 {
     if ((tcb->state != TLSS_STATE_CLIENT_CHANGE_CIPHER_SPEC) || (len != 1) || (*((uint8_t*)data) != TLS_CHANGE_CIPHER_SPEC) || (tcb->client_secure))
@@ -620,13 +736,14 @@ static inline void tlss_rx_change_cipher(TLSS* tlss, TLSS_TCB* tcb, void* data,
 #endif //TLS_DEBUG_REQUESTS
 }
 
-static inline void tlss_rx_alert(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned int len)
+//return false if session is closed
+static inline bool tlss_rx_alert(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb, void* data, unsigned int len)
 {
     TLS_ALERT* alert = data;
     if (len < sizeof(TLS_ALERT))
     {
         tlss_fatal(tlss, tcb, TLS_ALERT_UNEXPECTED_MESSAGE);
-        return;
+        return true;
     }
     if (alert->alert_description == TLS_ALERT_CLOSE_NOTIFY)
     {
@@ -635,21 +752,24 @@ static inline void tlss_rx_alert(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned
 #endif //TLS_DEBUG_REQUEST
         //rx answer on our close notify
         if (tcb->state == TLSS_STATE_CLOSE_NOTIFY)
-            tlss_close_session(tlss, tlss->tcb_handle, true);
-        else
         {
-            //tx close notify
-            tlss_tx_alert(tlss, tcb, TLS_ALERT_LEVEL_WARNING, TLS_ALERT_CLOSE_NOTIFY);
-            tlss_set_state(tcb, TLSS_STATE_CLOSING);
+            tlss_close_session(tlss, tcb_handle, true);
+            return false;
         }
+        //tx close notify
+        tlss_tx_alert(tlss, tcb, TLS_ALERT_LEVEL_WARNING, TLS_ALERT_CLOSE_NOTIFY);
+        tlss_set_state(tcb, TLSS_STATE_CLOSING);
+        return true;
     }
-    else
-    {
 #if (TLS_DEBUG_REQUESTS)
-        printf("TLS: rx %s alert: %d\n", alert->alert_level == TLS_ALERT_LEVEL_WARNING ? "warning" : "fatal", alert->alert_description);
+    printf("TLS: rx %s alert: %d\n", alert->alert_level == TLS_ALERT_LEVEL_WARNING ? "warning" : "fatal", alert->alert_description);
 #endif //TLS_DEBUG_REQUESTS
-        tlss_close_session(tlss, tlss->tcb_handle, true);
-    }
+#if (TLS_SESSION_CACHE_SIZE)
+    if (alert->alert_level == TLS_ALERT_LEVEL_FATAL)
+        tlss_session_invalidate(tlss, tcb);
+#endif //TLS_SESSION_CACHE_SIZE
+    tlss_close_session(tlss, tcb_handle, true);
+    return false;
 }
 
 static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned int len)
@@ -664,6 +784,9 @@ static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, u
     uint16_t extensions_len;
     TLS_HELLO* hello;
     TLS_EXTENSION* ext;
+#if (TLS_SESSION_CACHE_SIZE)
+    TLSS_SESSION* session = NULL;
+#endif //TLS_SESSION_CACHE_SIZE
     hello = data;
     //1. Check state and clientHello header size
     if ((tcb->state != TLSS_STATE_CLIENT_HELLO) || (len < sizeof(TLS_HELLO)))
@@ -694,7 +817,7 @@ static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, u
         tcb->version = TLS_PROTOCOL_1_2;
     //3. Copy random
     memcpy(tcb->tls_cipher.client_random, &hello->random, TLS_RANDOM_SIZE);
-    //4. Ignore session, just check size
+    //4. Lookup session to resume
     data += sizeof(TLS_HELLO);
     len -= sizeof(TLS_HELLO);
     if (len < hello->session_id_length + 2)
@@ -702,6 +825,10 @@ static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, u
         tlss_fatal(tlss, tcb, TLS_ALERT_UNEXPECTED_MESSAGE);
         return;
     }
+#if (TLS_SESSION_CACHE_SIZE)
+    if (hello->session_id_length == TLS_SESSION_ID_SIZE)
+        session = tlss_session_find(tlss, data);
+#endif //TLS_SESSION_CACHE_SIZE
     data += hello->session_id_length;
     len -= hello->session_id_length;
     //5. Decode cipher suites and apply
@@ -717,6 +844,18 @@ static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, u
     cipher_suites = data;
     data += cipher_suites_len;
     len -= cipher_suites_len;
+#if (TLS_SESSION_CACHE_SIZE)
+    //resumed session must use same cipher suite
+    for (i = 0; (session != NULL) && (i < cipher_suites_len); i += 2)
+    {
+        if (be2short(cipher_suites + i) == session->cipher_suite)
+        {
+            tcb->cipher_suite = session->cipher_suite;
+            tcb->resumed = true;
+            break;
+        }
+    }
+#endif //TLS_SESSION_CACHE_SIZE
     for (i = 0; (i < cipher_suites_len) && (tcb->cipher_suite == TLS_NULL_WITH_NULL_NULL); i += 2)
     {
         tmp = be2short(cipher_suites + i);
@@ -807,6 +946,17 @@ static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, u
         tlss_fatal(tlss, tcb, TLS_ALERT_INTERNAL_ERROR);
         return;
     }
+#if (TLS_SESSION_CACHE_SIZE)
+    if (tcb->resumed)
+    {
+        memcpy(tcb->session_id, session->session_id, TLS_SESSION_ID_SIZE);
+        memcpy(tcb->tls_cipher.master, session->master, TLS_MASTER_SIZE);
+        session->last_used = tlss_uptime();
+        ++tlss->sessions_stat.hits;
+    }
+    else if (hello->session_id_length)
+        ++tlss->sessions_stat.misses;
+#endif //TLS_SESSION_CACHE_SIZE
     tlss_set_state(tcb, TLSS_STATE_GENERATE_SERVER_RANDOM);
 #if (TLS_DEBUG_REQUESTS)
     printf("TLS: clientHello\n");
@@ -820,6 +970,8 @@ static inline void tlss_rx_client_hello(TLSS* tlss, TLSS_TCB* tcb, void* data, u
         printf("NULL\n");
     else
         tlss_dump((uint8_t*)hello + sizeof(TLS_HELLO), hello->session_id_length);
+    if (tcb->resumed)
+        printf("Session resumed\n");
     printf("cipher suites:\n");
     for (i = 0; i < cipher_suites_len; i += 2)
     {
@@ -853,16 +1005,15 @@ static inline void tlss_rx_client_key_exchange(TLSS* tlss, TLSS_TCB* tcb, void*
         tlss_fatal(tlss, tcb, TLS_ALERT_UNEXPECTED_MESSAGE);
         return;
     }
-    io_reset(tlss->tx);
-    memcpy(io_data(tlss->tx), (uint8_t*)data + 2, TLS_RAW_PREMASTER_SIZE);
-    tlss->tx->data_size = TLS_RAW_PREMASTER_SIZE;
+    //records processing is stopped until decrypted, rx is not overwritten
+    tcb->pending_data = (uint8_t*)data + 2;
     tlss_set_state(tcb, TLSS_STATE_DECRYPT_PREMASTER);
 #if (TLS_DEBUG_REQUESTS)
     printf("TLS: clientKeyExchange\n");
 #endif //TLS_DEBUG_REQUESTS
 }
 
-static inline void tlss_rx_finished(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned int len)
+static inline void tlss_rx_finished(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb, void* data, unsigned int len)
 {
     if ((tcb->state != TLSS_STATE_CLIENT_CHANGE_CIPHER_SPEC) || (len != TLS_FINISHED_DIGEST_SIZE) || (!tcb->client_secure))
     {
@@ -877,14 +1028,23 @@ static inline void tlss_rx_finished(TLSS* tlss, TLSS_TCB* tcb, void* data, unsig
         tlss_fatal(tlss, tcb, TLS_ALERT_HANDSHAKE_FAILURE);
         return;
     }
-
-    tlss_set_state(tcb, TLSS_STATE_GENERATE_IV_SEED);
 #if (TLS_DEBUG_REQUESTS)
     printf("TLS: (client) finished\n");
 #endif //TLS_DEBUG_REQUESTS
+    //abbreviated handshake: server finished is already sent
+    if (tcb->resumed)
+    {
+        tlss_set_state(tcb, TLSS_STATE_READY);
+        tlss_connection_established(tlss, tcb_handle);
+        return;
+    }
+#if (TLS_SESSION_CACHE_SIZE)
+    tlss_session_store(tlss, tcb);
+#endif //TLS_SESSION_CACHE_SIZE
+    tlss_set_state(tcb, TLSS_STATE_GENERATE_IV_SEED);
 }
 
-static inline void tlss_rx_handshakes(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned int len)
+static inline void tlss_rx_handshakes(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb, void* data, unsigned int len)
 {
     unsigned short offset, len_cur;
     TLS_HANDSHAKE* handshake;
@@ -914,7 +1074,7 @@ static inline void tlss_rx_handshakes(TLSS* tlss, TLSS_TCB* tcb, void* data, uns
             tlss_rx_client_key_exchange(tlss, tcb, data_cur, len_cur);
             break;
         case TLS_HANDSHAKE_FINISHED:
-            tlss_rx_finished(tlss, tcb, data_cur, len_cur);
+            tlss_rx_finished(tlss, tcb_handle, tcb, data_cur, len_cur);
             break;
         default:
 #if (TLS_DEBUG_ERRORS)
@@ -927,7 +1087,7 @@ static inline void tlss_rx_handshakes(TLSS* tlss, TLSS_TCB* tcb, void* data, uns
     }
 }
 
-static inline void tlss_rx_app(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned int len)
+static inline void tlss_rx_app(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb, void* data, unsigned int len)
 {
     TCP_STACK* stack;
     unsigned int to_read;
@@ -945,56 +1105,39 @@ static inline void tlss_rx_app(TLSS* tlss, TLSS_TCB* tcb, void* data, unsigned i
         stack->flags = 0;
         data = (uint8_t*)data + to_read;
         len -= to_read;
-        io_complete(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_READ), tlss->tcb_handle, tcb->rx);
+        io_complete(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_READ), tcb_handle, tcb->rx);
         tcb->rx = NULL;
     }
     if (len)
     {
-        tlss->pending_data = data;
-        tlss->pending_len = len;
+        tcb->pending_data = data;
+        tcb->pending_len = len;
         tlss_set_state(tcb, TLSS_STATE_PENDING);
     }
 }
 
-static inline void tlss_process_user_tx(TLSS* tlss)
-{
-    HANDLE tcb_handle;
-    TLSS_TCB* tcb;
-    for (tcb_handle = so_first(&tlss->tcbs); tcb_handle != INVALID_HANDLE; tcb_handle = so_next(&tlss->tcbs, tcb_handle))
-    {
-        tcb = so_get(&tlss->tcbs, tcb_handle);
-        if (tcb->tx != NULL)
-        {
-            tlss_user_tx(tlss, tcb_handle, tcb);
-            return;
-        }
-    }
-}
-
-static inline bool tlss_rx_next(TLSS* tlss, TLSS_TCB* tcb)
+static inline bool tlss_rx_next(TLSS* tlss, HANDLE tcb_handle, TLSS_TCB* tcb)
 {
     TLS_RECORD* rec;
     int len;
     void* data;
-    if (tlss->offset >= tlss->rx->data_size)
-        tlss->tcb_handle = INVALID_HANDLE;
-    if (tlss->tcb_handle == INVALID_HANDLE)
+    if (tcb->rx_busy || (tcb->offset >= tcb->tcp_rx->data_size))
     {
         //read next record(s)
-        tlss_tcp_rx(tlss);
-        if (!tlss->tx_busy)
-            tlss_process_user_tx(tlss);
+        tlss_tcp_rx(tlss, tcb);
+        if (!tcb->tx_busy && (tcb->tx != NULL))
+            tlss_user_tx(tlss, tcb_handle, tcb);
         return false;
     }
 
     do {
         //Empty records disabled by TLS
-        if ((tlss->rx->data_size - tlss->offset) <= sizeof(TLS_RECORD))
+        if ((tcb->tcp_rx->data_size - tcb->offset) <= sizeof(TLS_RECORD))
         {
             tlss_fatal(tlss, tcb, TLS_ALERT_UNEXPECTED_MESSAGE);
             break;
         }
-        rec = (TLS_RECORD*)((uint8_t*)io_data(tlss->rx) + tlss->offset);
+        rec = (TLS_RECORD*)((uint8_t*)io_data(tcb->tcp_rx) + tcb->offset);
         //check TLS 1.0 - 1.2
         if ((rec->version.major != 3) || (rec->version.minor == 0) || (rec->version.minor > 3))
         {
@@ -1002,14 +1145,14 @@ static inline bool tlss_rx_next(TLSS* tlss, TLSS_TCB* tcb)
             break;
         }
         len = be2short(rec->record_length_be);
-        tlss->offset += sizeof(TLS_RECORD);
-        if (len > tlss->rx->data_size - tlss->offset)
+        tcb->offset += sizeof(TLS_RECORD);
+        if (len > tcb->tcp_rx->data_size - tcb->offset)
         {
             tlss_fatal(tlss, tcb, TLS_ALERT_UNEXPECTED_MESSAGE);
             break;
         }
-        data = (uint8_t*)io_data(tlss->rx) + tlss->offset;
-        tlss->offset += len;
+        data = (uint8_t*)io_data(tcb->tcp_rx) + tcb->offset;
+        tcb->offset += len;
         if (tcb->client_secure)
         {
             len = tls_cipher_decrypt(&tcb->tls_cipher, rec->content_type, data, len);
@@ -1032,13 +1175,14 @@ static inline bool tlss_rx_next(TLSS* tlss, TLSS_TCB* tcb)
             tlss_rx_change_cipher(tlss, tcb, data, len);
             break;
         case TLS_CONTENT_ALERT:
-            tlss_rx_alert(tlss, tcb, data, len);
+            if (!tlss_rx_alert(tlss, tcb_handle, tcb, data, len))
+                return false;
             break;
         case TLS_CONTENT_HANDSHAKE:
-            tlss_rx_handshakes(tlss, tcb, data, len);
+            tlss_rx_handshakes(tlss, tcb_handle, tcb, data, len);
             break;
         case TLS_CONTENT_APP:
-            tlss_rx_app(tlss, tcb, data, len);
+            tlss_rx_app(tlss, tcb_handle, tcb, data, len);
             break;
         default:
 #if (TLS_DEBUG_ERRORS)
@@ -1050,54 +1194,57 @@ static inline bool tlss_rx_next(TLSS* tlss, TLSS_TCB* tcb)
     return true;
 }
 
-static void tlss_fsm(TLSS* tlss)
+static void tlss_fsm(TLSS* tlss, HANDLE tcb_handle)
 {
     TLSS_TCB* tcb;
     //message after close request
     if (tlss->tcpip == INVALID_HANDLE)
         return;
-    //no active handle? rx next
-    if (tlss->tcb_handle == INVALID_HANDLE)
-    {
-        tlss_tcp_rx(tlss);
-        return;
-    }
-    tcb = so_get(&tlss->tcbs, tlss->tcb_handle);
+    tcb = so_get(&tlss->tcbs, tcb_handle);
 
+    //each session is processed only on own events, so long handshake operations are not blocking other sessions
     for (;;)
     {
-        //can't process if user sending data on other connection at the same time
+        //can't process if user sending data at the same time
         //tcp_tx_complete will recall FSM
-        if (tlss->tx_busy)
+        if (tcb->tx_busy)
             return;
 
         switch (tcb->state)
         {
         case TLSS_STATE_GENERATE_SERVER_RANDOM:
-            io_read(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_GENERATE_RANDOM), tlss->tcb_handle, tlss->tx, TLS_RANDOM_SIZE);
+            tcb->tx_busy = true;
+            io_read(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_GENERATE_RANDOM), tcb_handle, tcb->tcp_tx, TLS_RANDOM_SIZE);
             return;
         case TLSS_STATE_GENERATE_SESSION_ID:
-            io_read(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_GENERATE_RANDOM), tlss->tcb_handle, tlss->tx, TLS_SESSION_ID_SIZE);
+            tcb->tx_busy = true;
+            io_read(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_GENERATE_RANDOM), tcb_handle, tcb->tcp_tx, TLS_SESSION_ID_SIZE);
             return;
         case TLSS_STATE_GENERATE_IV_SEED:
-            io_read(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_GENERATE_RANDOM), tlss->tcb_handle, tlss->tx, TLS_IV_SEED_SIZE);
+            tcb->tx_busy = true;
+            io_read(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_GENERATE_RANDOM), tcb_handle, tcb->tcp_tx, TLS_IV_SEED_SIZE);
             return;
         case TLSS_STATE_SERVER_HELLO:
             tlss_tx_server_hello(tlss, tcb);
             break;
         case TLSS_STATE_DECRYPT_PREMASTER:
-            io_write(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_PREMASTER_DECRYPT), tlss->tcb_handle, tlss->tx);
+            tcb->tx_busy = true;
+            io_reset(tcb->tcp_tx);
+            memcpy(io_data(tcb->tcp_tx), tcb->pending_data, TLS_RAW_PREMASTER_SIZE);
+            tcb->tcp_tx->data_size = TLS_RAW_PREMASTER_SIZE;
+            io_write(tlss->owner, HAL_IO_REQ(HAL_TLS, TLS_PREMASTER_DECRYPT), tcb_handle, tcb->tcp_tx);
             return;
         case TLSS_STATE_SERVER_CHANGE_CIPHER_SPEC:
-            tlss_tx_server_change_cipher_spec(tlss, tcb);
+            tlss_tx_server_change_cipher_spec(tlss, tcb_handle, tcb);
             break;
         case TLSS_STATE_PENDING:
             return;
         case TLSS_STATE_CLOSE_NOTIFY:
-            tlss_close_session(tlss, tlss->tcb_handle, true);
-            break;
+            tlss_close_session(tlss, tcb_handle, true);
+            return;
         default:
-            if (!tlss_rx_next(tlss, tcb))
+            //waiting for records or session closed on record processing
+            if (!tlss_rx_next(tlss, tcb_handle, tcb))
                 return;
         }
     }
@@ -1108,15 +1255,14 @@ static inline void tlss_init(TLSS* tlss)
     tlss->tcpip = INVALID_HANDLE;
     tlss->user = INVALID_HANDLE;
     tlss->owner = INVALID_HANDLE;
-    tlss->tcb_handle = INVALID_HANDLE;
-    tlss->rx = NULL;
-    tlss->tx = NULL;
-    tlss->tx_busy = tlss->rx_busy = false;
     tlss->cert = NULL;
     tlss->cert_len = 0;
-    tlss->offset = 0;
     //relative time will be set on first clientHello request
     so_create(&tlss->tcbs, sizeof(TLSS_TCB), 1);
+#if (TLS_SESSION_CACHE_SIZE)
+    memset(tlss->sessions, 0x00, sizeof(tlss->sessions));
+    tlss->sessions_stat.hits = tlss->sessions_stat.misses = 0;
+#endif //TLS_SESSION_CACHE_SIZE
 }
 
 static inline void tlss_open(TLSS* tlss, HANDLE tcpip, HANDLE owner)
@@ -1131,8 +1277,6 @@ static inline void tlss_open(TLSS* tlss, HANDLE tcpip, HANDLE owner)
         error(ERROR_NOT_CONFIGURED);
         return;
     }
-    tlss->rx = io_create(TLS_IO_SIZE + sizeof(TCP_STACK));
-    tlss->tx = io_create(TLS_IO_SIZE + sizeof(TCP_STACK));
     tlss->tcpip = tcpip;
     tlss->owner = owner;
 }
@@ -1149,58 +1293,61 @@ static inline void tlss_close(TLSS* tlss)
         tlss_close_session(tlss, tcb_handle, true);
     tlss->tcpip = INVALID_HANDLE;
     tlss->owner = INVALID_HANDLE;
-    io_destroy(tlss->rx);
-    io_destroy(tlss->tx);
-    tlss->rx = NULL;
-    tlss->tx = NULL;
 }
 
 static inline void tlss_generate_server_random(TLSS* tlss, TLSS_TCB* tcb, void* random)
 {
-    memcpy(tcb->tls_cipher.server_random, io_data(tlss->tx), TLS_RANDOM_SIZE);
-    tlss_set_state(tcb, TLSS_STATE_GENERATE_SESSION_ID);
+    memcpy(tcb->tls_cipher.server_random, random, TLS_RANDOM_SIZE);
+    //resumed session keeps id, IV seed is required before server finished
+    tlss_set_state(tcb, tcb->resumed ? TLSS_STATE_GENERATE_IV_SEED : TLSS_STATE_GENERATE_SESSION_ID);
 }
 
 static inline void tlss_generate_session_id(TLSS* tlss, TLSS_TCB* tcb, void* random)
 {
-    memcpy(tcb->session_id, io_data(tlss->tx), TLS_SESSION_ID_SIZE);
+    memcpy(tcb->session_id, random, TLS_SESSION_ID_SIZE);
     tlss_set_state(tcb, TLSS_STATE_SERVER_HELLO);
 }
 
 static inline void tlss_generate_iv_seed(TLSS* tlss, TLSS_TCB* tcb, void* random)
 {
-    memcpy(tcb->tls_cipher.iv_seed, io_data(tlss->tx), TLS_IV_SEED_SIZE);
-    tlss_set_state(tcb, TLSS_STATE_SERVER_CHANGE_CIPHER_SPEC);
+    memcpy(tcb->tls_cipher.iv_seed, random, TLS_IV_SEED_SIZE);
+    tlss_set_state(tcb, tcb->resumed ? TLSS_STATE_SERVER_HELLO : TLSS_STATE_SERVER_CHANGE_CIPHER_SPEC);
 }
 
-static inline void tlss_generate_random(TLSS* tlss, HANDLE tcb_handle)
+static TLSS_TCB* tlss_get_owner_tcb(TLSS* tlss, HANDLE tcb_handle, IO* io)
 {
-    TLSS_TCB* tcb;
-    do {
-        //closed already
-        if (tlss->tcb_handle != tcb_handle)
-            break;
-        tcb = so_get(&tlss->tcbs, tlss->tcb_handle);
-        if (tlss->tx->data_size < TLS_RANDOM_SIZE)
-            break;
+    TLSS_TCB* tcb = so_get(&tlss->tcbs, tcb_handle);
+    //closed already. IO is destroyed on return
+    if (tcb == NULL || tcb->tcp_tx != io)
+        return NULL;
+    tcb->tx_busy = false;
+    return tcb;
+}
+
+static inline void tlss_generate_random(TLSS* tlss, HANDLE tcb_handle, IO* io)
+{
+    TLSS_TCB* tcb = tlss_get_owner_tcb(tlss, tcb_handle, io);
+    if (tcb == NULL)
+        return;
+    if (io->data_size >= TLS_RANDOM_SIZE)
+    {
         switch (tcb->state)
         {
         case TLSS_STATE_GENERATE_SERVER_RANDOM:
-            tlss_generate_server_random(tlss, tcb, io_data(tlss->tx));
+            tlss_generate_server_random(tlss, tcb, io_data(io));
             break;
         case TLSS_STATE_GENERATE_SESSION_ID:
-            tlss_generate_session_id(tlss, tcb, io_data(tlss->tx));
+            tlss_generate_session_id(tlss, tcb, io_data(io));
             break;
         case TLSS_STATE_GENERATE_IV_SEED:
-            tlss_generate_iv_seed(tlss, tcb, io_data(tlss->tx));
+            tlss_generate_iv_seed(tlss, tcb, io_data(io));
             break;
         default:
             break;
         }
-    } while (false);
-    io_reset(tlss->tx);
-    tlss->tx_busy = false;
-    tlss_fsm(tlss);
+    }
+    io_reset(io);
+    tlss_fsm(tlss, tcb_handle);
 }
 
 static inline void tlss_register_certificate(TLSS* tlss, uint8_t* cert, unsigned int len)
@@ -1219,18 +1366,17 @@ static inline void tlss_register_certificate(TLSS* tlss, uint8_t* cert, unsigned
     tlss->cert_len = len;
 }
 
-static inline void tlss_premaster_decrypt(TLSS* tlss, HANDLE tcb_handle)
+static inline void tlss_premaster_decrypt(TLSS* tlss, HANDLE tcb_handle, IO* io)
 {
-    TLSS_TCB* tcb;
+    TLSS_TCB* tcb = tlss_get_owner_tcb(tlss, tcb_handle, io);
+    if (tcb == NULL)
+        return;
     do {
-        //closed already
-        if (tlss->tcb_handle != tcb_handle)
-            break;
-        tcb = so_get(&tlss->tcbs, tlss->tcb_handle);
-        if (tlss->tx->data_size < sizeof(TLS_RAW_PREMASTER_SIZE))
+        if (io->data_size < sizeof(TLS_RAW_PREMASTER_SIZE))
             break;
-        if (!tls_cipher_decode_key_block(io_data(tlss->tx), &tcb->tls_cipher))
+        if (!tls_cipher_decode_key_block(io_data(io), &tcb->tls_cipher))
         {
+            io_reset(io);
             tlss_fatal(tlss, tcb, TLS_ALERT_DECRYPTION_FAILED);
 #if (TLS_DEBUG_ERRORS)
             printf("TLS: premaster decryption failed\n");
@@ -1243,9 +1389,10 @@ static inline void tlss_premaster_decrypt(TLSS* tlss, HANDLE tcb_handle)
 #endif //TLS_DEBUG_SECRETS
         tlss_set_state(tcb, TLSS_STATE_CLIENT_CHANGE_CIPHER_SPEC);
     } while (false);
-    io_reset(tlss->tx);
-    tlss->tx_busy = false;
-    tlss_fsm(tlss);
+    //tlss_fatal may be already sending alert
+    if (!tcb->tx_busy)
+        io_reset(io);
+    tlss_fsm(tlss, tcb_handle);
 }
 
 static inline void tlss_request(TLSS* tlss, IPC* ipc)
@@ -1259,14 +1406,20 @@ static inline void tlss_request(TLSS* tlss, IPC* ipc)
         tlss_close(tlss);
         break;
     case TLS_GENERATE_RANDOM:
-        tlss_generate_random(tlss, (HANDLE)ipc->param1);
+        tlss_generate_random(tlss, (HANDLE)ipc->param1, (IO*)ipc->param2);
         break;
     case TLS_REGISTER_CERTIFICATE:
         tlss_register_certificate(tlss, (uint8_t*)ipc->param2, ipc->param3);
         break;
     case TLS_PREMASTER_DECRYPT:
-        tlss_premaster_decrypt(tlss, (HANDLE)ipc->param1);
+        tlss_premaster_decrypt(tlss, (HANDLE)ipc->param1, (IO*)ipc->param2);
+        break;
+#if (TLS_SESSION_CACHE_SIZE)
+    case TLS_GET_SESSION_CACHE_STAT:
+        ipc->param1 = tlss->sessions_stat.hits;
+        ipc->param2 = tlss->sessions_stat.misses;
         break;
+#endif //TLS_SESSION_CACHE_SIZE
     default:
         error(ERROR_NOT_SUPPORTED);
     }
@@ -1274,23 +1427,25 @@ static inline void tlss_request(TLSS* tlss, IPC* ipc)
 
 static inline void tlss_tcp_open(TLSS* tlss, HANDLE handle)
 {
-#if (TLS_DEBUG_REQUESTS)
+#if (TLS_DEBUG_REQUESTS) || (TLS_DEBUG_ERRORS)
     TLSS_TCB* tcb;
-#endif //TLS_DEBUG_REQUESTS
+#endif //(TLS_DEBUG_REQUESTS) || (TLS_DEBUG_ERRORS)
     HANDLE tcb_handle = tlss_create_tcb(tlss, handle);
     if (tcb_handle == INVALID_HANDLE)
     {
         tcp_close(tlss->tcpip, handle);
         return;
     }
-#if (TLS_DEBUG_REQUESTS)
+#if (TLS_DEBUG_REQUESTS) || (TLS_DEBUG_ERRORS)
     tcb = so_get(&tlss->tcbs, tcb_handle);
     tcp_get_remote_addr(tlss->tcpip, handle, &tcb->remote_addr);
+#endif //(TLS_DEBUG_REQUESTS) || (TLS_DEBUG_ERRORS)
+#if (TLS_DEBUG_REQUESTS)
     printf("TLS: new session from ");
     ip_print(&tcb->remote_addr);
     printf("\n");
 #endif //TLS_DEBUG_REQUESTS
-    tlss_fsm(tlss);
+    tlss_fsm(tlss, tcb_handle);
 }
 
 static inline void tlss_tcp_close(TLSS* tlss, HANDLE handle)
@@ -1315,38 +1470,49 @@ static inline void tlss_tcp_close(TLSS* tlss, HANDLE handle)
     }
 #endif //TLS_DEBUG_ERRORS
     tlss_close_session(tlss, tcb_handle, false);
-    tlss_fsm(tlss);
 }
 
-static void tlss_tcp_rx_complete(TLSS* tlss, HANDLE handle, int size)
+static void tlss_tcp_rx_complete(TLSS* tlss, HANDLE handle, IO* io, int size)
 {
-    tlss->rx_busy = false;
+    TLSS_TCB* tcb;
+    HANDLE tcb_handle = tlss_find_tcb_handle(tlss, handle);
+    //closed already. IO is destroyed on return
+    if (tcb_handle == INVALID_HANDLE)
+        return;
+    tcb = so_get(&tlss->tcbs, tcb_handle);
+    if (tcb->tcp_rx != io)
+        return;
+    tcb->rx_busy = false;
     if (size < 0)
     {
-        tlss_tcp_rx(tlss);
+        tlss_tcp_rx(tlss, tcb);
         return;
     }
-    tlss->tcb_handle = tlss_find_tcb_handle(tlss, handle);
-    tlss_fsm(tlss);
+    tlss_fsm(tlss, tcb_handle);
 }
 
-static inline void tlss_tcp_tx_complete(TLSS* tlss, HANDLE handle)
+static inline void tlss_tcp_tx_complete(TLSS* tlss, HANDLE handle, IO* io)
 {
     HANDLE tcb_handle;
     TLSS_TCB* tcb;
-    io_reset(tlss->tx);
-    tlss->tx_busy = false;
     tcb_handle = tlss_find_tcb_handle(tlss, handle);
+    //closed already. IO is destroyed on return
+    if (tcb_handle == INVALID_HANDLE)
+        return;
+    tcb = so_get(&tlss->tcbs, tcb_handle);
+    if (tcb->tcp_tx != io)
+        return;
+    io_reset(io);
+    tcb->tx_busy = false;
 
     //doesn't matter delivered close or closed by other side first
-    if (tcb_handle != INVALID_HANDLE)
+    if (tcb->state == TLSS_STATE_CLOSING)
     {
-        tcb = so_get(&tlss->tcbs, tcb_handle);
-        if (tcb->state == TLSS_STATE_CLOSING)
-            tlss_close_session(tlss, tlss->tcb_handle, true);
+        tlss_close_session(tlss, tcb_handle, true);
+        return;
     }
     //wakeup if some data write pending
-    tlss_fsm(tlss);
+    tlss_fsm(tlss, tcb_handle);
 }
 
 static inline void tlss_tcp_request(TLSS* tlss, IPC* ipc)
@@ -1360,10 +1526,10 @@ static inline void tlss_tcp_request(TLSS* tlss, IPC* ipc)
         tlss_tcp_close(tlss, (HANDLE)ipc->param1);
         break;
     case IPC_READ:
-        tlss_tcp_rx_complete(tlss, (HANDLE)ipc->param1, (int)ipc->param3);
+        tlss_tcp_rx_complete(tlss, (HANDLE)ipc->param1, (IO*)ipc->param2, (int)ipc->param3);
         break;
     case IPC_WRITE:
-        tlss_tcp_tx_complete(tlss, (HANDLE)ipc->param1);
+        tlss_tcp_tx_complete(tlss, (HANDLE)ipc->param1, (IO*)ipc->param2);
         break;
     default:
         error(ERROR_NOT_SUPPORTED);
@@ -1455,7 +1621,6 @@ static inline void tlss_user_close(TLSS* tlss, HANDLE tcb_handle)
     tlss_flush(tlss, tcb_handle);
     tlss_set_state(tcb, TLSS_STATE_CLOSE_NOTIFY);
     tlss_tx_alert(tlss, tcb, TLS_ALERT_LEVEL_WARNING, TLS_ALERT_CLOSE_NOTIFY);
-    tlss->tcb_handle = tcb_handle;
     error(ERROR_SYNC);
 }
 
@@ -1476,24 +1641,24 @@ static inline void tlss_user_read(TLSS* tlss, HANDLE tcb_handle, IO* io, unsigne
         size = io_get_free(io) - sizeof(TCP_STACK);
     if (tcb->state == TLSS_STATE_PENDING)
     {
-        to_read = tlss->pending_len;
+        to_read = tcb->pending_len;
         if (to_read > size)
             to_read = size;
-        memcpy(io_data(io), tlss->pending_data, to_read);
+        memcpy(io_data(io), tcb->pending_data, to_read);
         stack = io_push(io, sizeof(TCP_STACK));
         stack->flags = 0;
         io->data_size = to_read;
         io_complete(tlss->user, HAL_IO_CMD(HAL_TCP, IPC_READ), tcb_handle, io);
 
-        if (to_read == tlss->pending_len)
+        if (to_read == tcb->pending_len)
         {
             tlss_set_state(tcb, TLSS_STATE_READY);
-            tlss_fsm(tlss);
+            tlss_fsm(tlss, tcb_handle);
         }
         else
         {
-            tlss->pending_data = (uint8_t*)tlss->pending_data + to_read;
-            tlss->pending_len -= to_read;
+            tcb->pending_data = (uint8_t*)tcb->pending_data + to_read;
+            tcb->pending_len -= to_read;
         }
     }
     else
@@ -1516,7 +1681,7 @@ static inline void tlss_user_write(TLSS* tlss, HANDLE tcb_handle, IO* io)
     }
     tcb->tx_offset = 0;
     tcb->tx = io;
-    if (!tlss->tx_busy)
+    if (!tcb->tx_busy)
         tlss_user_tx(tlss, tcb_handle, tcb);
     error(ERROR_SYNC);
 }
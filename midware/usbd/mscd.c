@@ -157,6 +157,7 @@ static void mscd_release_io(MSCD* mscd)
 void mscd_host_cb(void* param, unsigned int id, SCSIS_RESPONSE response, unsigned int size)
 {
     MSCD* mscd = param;
+    IO* io;
 
     switch (response)
     {
@@ -164,14 +165,16 @@ void mscd_host_cb(void* param, unsigned int id, SCSIS_RESPONSE response, unsigne
         if (size > mscd->residue)
             size = mscd->residue;
         mscd->residue -= size;
+        io = scsis_get_host_io(MSCD_SCSI(mscd)[id]);
         //some hardware required to be multiple of MPS
-        usbd_usb_ep_read(mscd->usbd, mscd->ep_num, mscd->data, (size + mscd->ep_size - 1) & ~(mscd->ep_size - 1));
+        usbd_usb_ep_read(mscd->usbd, mscd->ep_num, io, (size + mscd->ep_size - 1) & ~(mscd->ep_size - 1));
         break;
     case SCSIS_RESPONSE_WRITE:
-        if (mscd->data->data_size > mscd->residue)
-            mscd->data->data_size = mscd->residue;
-        mscd->residue -= mscd->data->data_size;
-        usbd_usb_ep_write(mscd->usbd, mscd->ep_num, mscd->data);
+        io = scsis_get_host_io(MSCD_SCSI(mscd)[id]);
+        if (io->data_size > mscd->residue)
+            io->data_size = mscd->residue;
+        mscd->residue -= io->data_size;
+        usbd_usb_ep_write(mscd->usbd, mscd->ep_num, io);
         break;
     case SCSIS_RESPONSE_PASS:
         mscd->csw_status = MSC_CSW_COMMAND_PASSED;
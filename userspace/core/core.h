@@ -34,4 +34,17 @@
 #include "arm7/core_arm7.h"
 #endif
 
+//host core for off-target profiling
+#ifdef POSIX
+#ifndef SRAM_BASE
+#define SRAM_BASE                0x20000000
+#endif
+#ifndef SRAM_SIZE
+#define SRAM_SIZE                0x400000
+#endif
+#ifndef IRQ_VECTORS_COUNT
+#define IRQ_VECTORS_COUNT        16
+#endif
+#endif //POSIX
+
 #endif // CORE_H
@@ -18,17 +18,84 @@ void ip_print(const IP* ip)
     }
 }
 
-uint16_t ip_checksum(void* buf, unsigned int size)
+/*
+    Sum is in host byte order, 16 bit words are accumulated as 32 bit words with deferred carry.
+    One's complement sum is byte order independent (RFC 1071), swapped once on fold.
+*/
+uint32_t ip_checksum_add(uint32_t sum, const void* buf, unsigned int size)
 {
-    unsigned int i;
-    uint32_t sum = 0;
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
+    const uint8_t* p = buf;
+    const uint32_t* w;
+    uint64_t acc = sum;
+    union {
+        uint8_t u8[2];
+        uint16_t u16;
+    } tail;
+
+    if ((unsigned int)p & 1)
+    {
+        //odd address, bytewise
+        for (; size >= 2; size -= 2, p += 2)
+        {
+            tail.u8[0] = p[0];
+            tail.u8[1] = p[1];
+            acc += tail.u16;
+        }
+    }
+    else
+    {
+        if (((unsigned int)p & 2) && (size >= 2))
+        {
+            acc += *((const uint16_t*)p);
+            p += 2;
+            size -= 2;
+        }
+        w = (const uint32_t*)p;
+        for (; size >= 16; size -= 16, w += 4)
+            acc += (uint64_t)w[0] + w[1] + w[2] + w[3];
+        for (; size >= 4; size -= 4, ++w)
+            acc += *w;
+        p = (const uint8_t*)w;
+        if (size >= 2)
+        {
+            acc += *((const uint16_t*)p);
+            p += 2;
+            size -= 2;
+        }
+    }
     //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
+    if (size)
+    {
+        tail.u8[0] = *p;
+        tail.u8[1] = 0;
+        acc += tail.u16;
+    }
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    acc = (acc & 0xffffffff) + (acc >> 32);
+    return (uint32_t)acc;
+}
+
+uint16_t ip_checksum_fold(uint32_t sum)
+{
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+#if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    sum = ((sum & 0xff) << 8) | (sum >> 8);
+#endif //__ORDER_LITTLE_ENDIAN__
+    return ~((uint16_t)sum);
+}
+
+uint16_t ip_checksum(void* buf, unsigned int size)
+{
+    return ip_checksum_fold(ip_checksum_add(0, buf, size));
+}
+
+//RFC 1624: HC' = ~(~HC + ~m + m')
+uint16_t ip_checksum_update(uint16_t checksum, uint16_t from, uint16_t to)
+{
+    uint32_t sum = (uint16_t)~checksum + (uint16_t)~from + to;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
     return ~((uint16_t)sum);
 }
 
@@ -227,6 +227,11 @@ typedef enum {
 
 void ip_print(const IP* ip);
 uint16_t ip_checksum(void *buf, unsigned int size);
+//partial checksum of few buffers: sum = ip_checksum_add(sum, buf, size), checksum = ip_checksum_fold(sum)
+uint32_t ip_checksum_add(uint32_t sum, const void* buf, unsigned int size);
+uint16_t ip_checksum_fold(uint32_t sum);
+//update checksum on header field change without re-sum. Values in host order
+uint16_t ip_checksum_update(uint16_t checksum, uint16_t from, uint16_t to);
 bool ip_compare(const IP* ip1, const IP* ip2, const IP* mask);
 void ip_set(HANDLE tcpip, const IP* ip);
 void ip_get(HANDLE tcpip, IP* ip);
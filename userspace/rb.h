@@ -94,6 +94,54 @@ __STATIC_INLINE unsigned int rb_get(RB* rb)
     return offset;
 }
 
+/**
+    \brief get contiguous free items from head, before wrap
+    \param rb: pointer to initialized \ref RB structure
+    \retval items count, that can be put with single \ref rb_put_n
+*/
+__STATIC_INLINE unsigned int rb_put_span(RB* rb)
+{
+    if (rb->tail > rb->head)
+        return rb->tail - rb->head - 1;
+    return rb->size - rb->head - (rb->tail == 0 ? 1 : 0);
+}
+
+/**
+    \brief put items in ring buffer
+    \param rb: pointer to initialized \ref RB structure
+    \param count: items count. Must not exceed \ref rb_put_span
+    \retval index of first element from start, where need to put data
+*/
+__STATIC_INLINE unsigned int rb_put_n(RB* rb, unsigned int count)
+{
+    register int offset = rb->head;
+    rb->head = RB_ROUND(rb, rb->head + count);
+    return offset;
+}
+
+/**
+    \brief get contiguous used items from tail, before wrap
+    \param rb: pointer to initialized \ref RB structure
+    \retval items count, that can be get with single \ref rb_get_n
+*/
+__STATIC_INLINE unsigned int rb_get_span(RB* rb)
+{
+    return rb->tail > rb->head ? rb->size - rb->tail : rb->head - rb->tail;
+}
+
+/**
+    \brief get items from ring buffer
+    \param rb: pointer to initialized \ref RB structure
+    \param count: items count. Must not exceed \ref rb_get_span
+    \retval index of first element from where we can get data
+*/
+__STATIC_INLINE unsigned int rb_get_n(RB* rb, unsigned int count)
+{
+    register int offset = rb->tail;
+    rb->tail = RB_ROUND(rb, rb->tail + count);
+    return offset;
+}
+
 /**
     \brief get rb used size
     \param rb: pointer to initialized \ref RB structure
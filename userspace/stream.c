@@ -99,6 +99,54 @@ bool stream_read(HANDLE handle, char* buf, unsigned int size)
     return get_last_error() == ERROR_OK;
 }
 
+unsigned int stream_reserve(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    svc_call(SVC_STREAM_RESERVE, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+unsigned int stream_ireserve(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    __GLOBAL->svc_irq(SVC_STREAM_RESERVE, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+void stream_commit(HANDLE handle, unsigned int size)
+{
+    svc_call(SVC_STREAM_COMMIT, (unsigned int)handle, size, 0);
+}
+
+void stream_icommit(HANDLE handle, unsigned int size)
+{
+    __GLOBAL->svc_irq(SVC_STREAM_COMMIT, (unsigned int)handle, size, 0);
+}
+
+unsigned int stream_peek(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    svc_call(SVC_STREAM_PEEK, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+unsigned int stream_ipeek(HANDLE handle, char** buf)
+{
+    unsigned int size = 0;
+    __GLOBAL->svc_irq(SVC_STREAM_PEEK, (unsigned int)handle, (unsigned int)buf, (unsigned int)(&size));
+    return size;
+}
+
+void stream_consume(HANDLE handle, unsigned int size)
+{
+    svc_call(SVC_STREAM_CONSUME, (unsigned int)handle, size, 0);
+}
+
+void stream_iconsume(HANDLE handle, unsigned int size)
+{
+    __GLOBAL->svc_irq(SVC_STREAM_CONSUME, (unsigned int)handle, size, 0);
+}
+
 void stream_flush(HANDLE stream)
 {
     svc_call(SVC_STREAM_FLUSH, (unsigned int)stream, 0, 0);
@@ -129,6 +129,70 @@ unsigned int stream_iread_no_block(HANDLE handle, const char* buf, unsigned int
 */
 bool stream_read(HANDLE handle, char* buf, unsigned int size);
 
+/**
+    \brief reserve contiguous STREAM space to be filled in place. Only one producer is allowed
+    \param handle: handle of created stream
+    \param buf: pointer to reserved space
+    \retval reserved size. Less than free size, if space wraps around stream end
+*/
+unsigned int stream_reserve(HANDLE handle, char** buf);
+
+/**
+    \brief reserve contiguous STREAM space to be filled in place, ISR version
+    \param handle: handle of created stream
+    \param buf: pointer to reserved space
+    \retval reserved size
+*/
+unsigned int stream_ireserve(HANDLE handle, char** buf);
+
+/**
+    \brief commit data, filled in space from \ref stream_reserve
+    \param handle: handle of created stream
+    \param size: size of filled data. Must not exceed reserved size
+    \retval none
+*/
+void stream_commit(HANDLE handle, unsigned int size);
+
+/**
+    \brief commit data, filled in space from \ref stream_ireserve, ISR version
+    \param handle: handle of created stream
+    \param size: size of filled data. Must not exceed reserved size
+    \retval none
+*/
+void stream_icommit(HANDLE handle, unsigned int size);
+
+/**
+    \brief get contiguous STREAM data in place, without reading. Only one consumer is allowed
+    \param handle: handle of created stream
+    \param buf: pointer to data
+    \retval data size. Less than used size, if data wraps around stream end
+*/
+unsigned int stream_peek(HANDLE handle, char** buf);
+
+/**
+    \brief get contiguous STREAM data in place, without reading. ISR version
+    \param handle: handle of created stream
+    \param buf: pointer to data
+    \retval data size
+*/
+unsigned int stream_ipeek(HANDLE handle, char** buf);
+
+/**
+    \brief release data, received by \ref stream_peek
+    \param handle: handle of created stream
+    \param size: size of processed data. Must not exceed peeked size
+    \retval none
+*/
+void stream_consume(HANDLE handle, unsigned int size);
+
+/**
+    \brief release data, received by \ref stream_ipeek, ISR version
+    \param handle: handle of created stream
+    \param size: size of processed data. Must not exceed peeked size
+    \retval none
+*/
+void stream_iconsume(HANDLE handle, unsigned int size);
+
 /**
     \brief flush STREAM
     \param stream: created STREAM object
@@ -61,6 +61,10 @@ typedef enum {
     SVC_STREAM_READ,
     SVC_STREAM_WRITE_NO_BLOCK,
     SVC_STREAM_READ_NO_BLOCK,
+    SVC_STREAM_RESERVE,
+    SVC_STREAM_COMMIT,
+    SVC_STREAM_PEEK,
+    SVC_STREAM_CONSUME,
     SVC_STREAM_FLUSH,
     SVC_STREAM_DESTROY,
 
@@ -82,6 +86,10 @@ typedef void (*STDOUT)(const char *const buf, unsigned int size, void* param);
     \{
  */
 
+#ifdef POSIX
+extern void* posix_get_sp();
+#endif //POSIX
+
 /**
     \brief arch-dependent stack pointer query
     \details Same for every ARM, so defined here
@@ -89,9 +97,13 @@ typedef void (*STDOUT)(const char *const buf, unsigned int size, void* param);
 */
 __STATIC_INLINE void* get_sp()
 {
+#ifdef POSIX
+  return posix_get_sp();
+#else
   void* result;
   __ASM volatile ("mov %0, sp" : "=r" (result));
   return result;
+#endif //POSIX
 }
 
 /**
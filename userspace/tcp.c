@@ -20,24 +20,16 @@ typedef struct {
 uint16_t tcp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst)
 {
     TCP_PSEUDO_HEADER tph;
-    unsigned int i;
-    uint32_t sum = 0;
+    uint32_t sum;
     tph.src.u32.ip = src->u32.ip;
     tph.dst.u32.ip = dst->u32.ip;
     tph.zero = 0;
     tph.ptcl = PROTO_TCP;
     short2be(tph.length_be, size);
 
-    for (i = 0; i < (sizeof(TCP_PSEUDO_HEADER) >> 1); ++i)
-        sum += (((uint8_t*)&tph)[i << 1] << 8) | (((uint8_t*)&tph)[(i << 1) + 1]);
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
-    //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
-    return ~((uint16_t)sum);
+    sum = ip_checksum_add(0, &tph, sizeof(tph));
+    sum = ip_checksum_add(sum, buf, size);
+    return ip_checksum_fold(sum);
 }
 
 void tcp_get_remote_addr(HANDLE tcpip, HANDLE handle, IP* ip)
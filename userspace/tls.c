@@ -27,3 +27,14 @@ void tls_register_cerificate(HANDLE tls, const uint8_t* const cert, unsigned int
 {
     ack(tls, HAL_REQ(HAL_TLS, TLS_REGISTER_CERTIFICATE), 0, (unsigned int)cert, len);
 }
+
+void tls_get_session_cache_stat(HANDLE tls, TLS_SESSION_CACHE_STAT* stat)
+{
+    IPC ipc;
+    ipc.cmd = HAL_REQ(HAL_TLS, TLS_GET_SESSION_CACHE_STAT);
+    ipc.process = tls;
+    ipc.param1 = ipc.param2 = ipc.param3 = 0;
+    call(&ipc);
+    stat->hits = ipc.param1;
+    stat->misses = ipc.param2;
+}
@@ -21,13 +21,19 @@
 typedef enum {
     TLS_REGISTER_CERTIFICATE = IPC_USER,
     TLS_GENERATE_RANDOM,
-    TLS_PREMASTER_DECRYPT
+    TLS_PREMASTER_DECRYPT,
+    TLS_GET_SESSION_CACHE_STAT
 } TLS_IPCS;
 
+typedef struct {
+    unsigned int hits, misses;
+} TLS_SESSION_CACHE_STAT;
+
 HANDLE tls_create();
 bool tls_open(HANDLE tls, HANDLE tcpip);
 void tls_close(HANDLE tls);
 void tls_register_cerificate(HANDLE tls, const uint8_t* const cert, unsigned int len);
+void tls_get_session_cache_stat(HANDLE tls, TLS_SESSION_CACHE_STAT* stat);
 
 
 #endif // TLS_H
@@ -26,10 +26,16 @@
 #include <stddef.h>
 #include <stdarg.h>
 
+//size classes of small objects: 16, 32, 64, 128, 256
+#define POOL_SLAB_CLASSES                   5
+#define POOL_SLAB_MIN                       16
+
 typedef struct {
     void* free_slot;
     void* first_slot;
     void* last_slot;
+    //freed small objects, cached per size class
+    void* slab[POOL_SLAB_CLASSES];
 } POOL;
 
 typedef struct {
@@ -38,6 +44,9 @@ typedef struct {
     unsigned int free;
     unsigned int used;
     unsigned int largest_free;
+    //objects count per size class. Cached objects are not counted in used/free
+    unsigned int slab_used[POOL_SLAB_CLASSES];
+    unsigned int slab_free[POOL_SLAB_CLASSES];
 } POOL_STAT;
 
 #endif // TYPES_H
@@ -19,25 +19,17 @@ typedef struct {
 
 uint16_t udp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst)
 {
-    unsigned int i;
     UDP_PSEUDO_HEADER uph;
-    uint32_t sum = 0;
+    uint32_t sum;
     uph.src.u32.ip = src->u32.ip;
     uph.dst.u32.ip = dst->u32.ip;
     uph.zero = 0;
     uph.proto = PROTO_UDP;
     short2be(uph.length_be, size);
 
-    for (i = 0; i < (sizeof(UDP_PSEUDO_HEADER) >> 1); ++i)
-        sum += (((uint8_t*)&uph)[i << 1] << 8) | (((uint8_t*)&uph)[(i << 1) + 1]);
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
-    //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
-    return ~((uint16_t)sum);
+    sum = ip_checksum_add(0, &uph, sizeof(uph));
+    sum = ip_checksum_add(sum, buf, size);
+    return ip_checksum_fold(sum);
 }
 
 HANDLE udp_listen(HANDLE tcpip, unsigned short port)
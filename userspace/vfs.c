@@ -52,6 +52,16 @@ void vfs_close_volume(VFS_RECORD_TYPE* vfs_record)
     ack(vfs_record->vfs, HAL_REQ(HAL_VFS, IPC_CLOSE), VFS_VOLUME_HANDLE, 0, 0);
 }
 
+bool vfs_get_cache_stat(VFS_RECORD_TYPE* vfs_record, VFS_CACHE_STAT_TYPE* stat)
+{
+    memset(stat, 0x00, sizeof(VFS_CACHE_STAT_TYPE));
+    if (io_read_sync(vfs_record->vfs, HAL_IO_REQ(HAL_VFS, VFS_STAT), VFS_VOLUME_HANDLE, vfs_record->io, sizeof(VFS_CACHE_STAT_TYPE))
+            < (int)sizeof(VFS_CACHE_STAT_TYPE))
+        return false;
+    memcpy(stat, io_data(vfs_record->io), sizeof(VFS_CACHE_STAT_TYPE));
+    return true;
+}
+
 bool vfs_open_ber(VFS_RECORD_TYPE* vfs_record, unsigned int block_sectors)
 {
     return get_size(vfs_record->vfs, HAL_REQ(HAL_VFS, IPC_OPEN), VFS_BER_HANDLE, block_sectors, 0) >= 0;
@@ -85,6 +85,10 @@ typedef struct {
     unsigned int crc_blocks, bad_blocks, crc_errors_count;
 } VFS_BER_STAT_TYPE;
 
+typedef struct {
+    unsigned int hits, misses, write_backs;
+} VFS_CACHE_STAT_TYPE;
+
 typedef struct {
     unsigned int root_entries;
     unsigned short cluster_sectors, fat_count;
@@ -98,6 +102,7 @@ void vfs_record_destroy(VFS_RECORD_TYPE* vfs_record);
 
 bool vfs_open_volume(VFS_RECORD_TYPE* vfs_record, VFS_VOLUME_TYPE* volume);
 void vfs_close_volume(VFS_RECORD_TYPE* vfs_record);
+bool vfs_get_cache_stat(VFS_RECORD_TYPE* vfs_record, VFS_CACHE_STAT_TYPE* stat);
 
 bool vfs_open_ber(VFS_RECORD_TYPE* vfs_record, unsigned int block_sectors);
 void vfs_close_ber(VFS_RECORD_TYPE* vfs_record);
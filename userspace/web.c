@@ -50,6 +50,19 @@ HANDLE web_server_create_node(HANDLE web_server, HANDLE parent, const char* name
     return res;
 }
 
+HANDLE web_server_create_file_node(HANDLE web_server, HANDLE parent, const char* name, HANDLE vfs, unsigned int folder)
+{
+    HANDLE res = web_server_create_node(web_server, parent, name, WEB_FLAG(WEB_METHOD_GET) | WEB_FLAG(WEB_METHOD_HEAD) | WEB_FLAG_FILES);
+    if (res == INVALID_HANDLE)
+        return INVALID_HANDLE;
+    if (get_size(web_server, HAL_REQ(HAL_WEBS, WEBS_SET_FOLDER), res, vfs, folder) < 0)
+    {
+        web_server_destroy_node(web_server, res);
+        return INVALID_HANDLE;
+    }
+    return res;
+}
+
 void web_server_destroy_node(HANDLE web_server, HANDLE obj)
 {
     ack(web_server, HAL_REQ(HAL_WEBS, WEBS_DESTROY_NODE), obj, 0, 0);
@@ -65,6 +78,29 @@ void web_server_unregister_error(HANDLE web_server, WEB_RESPONSE code)
     ack(web_server, HAL_REQ(HAL_WEBS, WEBS_UNREGISTER_RESPONSE), (unsigned int)code, 0, 0);
 }
 
+bool web_server_register_handler(HANDLE web_server, HANDLE obj, HANDLE process)
+{
+    return get_size(web_server, HAL_REQ(HAL_WEBS, WEBS_REGISTER_HANDLER), obj, process, 0) >= 0;
+}
+
+void web_server_unregister_handler(HANDLE web_server, HANDLE obj, HANDLE process)
+{
+    ack(web_server, HAL_REQ(HAL_WEBS, WEBS_UNREGISTER_HANDLER), obj, process, 0);
+}
+
+bool web_server_get_node_stat(HANDLE web_server, HANDLE obj, WEB_NODE_STAT* stat)
+{
+    bool res;
+    IO* io = io_create(sizeof(WEB_NODE_STAT));
+    if (io == NULL)
+        return false;
+    res = io_read_sync(web_server, HAL_IO_REQ(HAL_WEBS, WEBS_GET_NODE_STAT), obj, io, sizeof(WEB_NODE_STAT)) >= (int)sizeof(WEB_NODE_STAT);
+    if (res)
+        memcpy(stat, io_data(io), sizeof(WEB_NODE_STAT));
+    io_destroy(io);
+    return res;
+}
+
 void web_server_read(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max)
 {
     io_read(web_server, HAL_REQ(HAL_WEBS, IPC_READ), session, io, size_max);
@@ -87,6 +123,18 @@ int web_server_write_sync(HANDLE web_server, HANDLE session, WEB_RESPONSE code,
     return io_write_sync(web_server, HAL_IO_REQ(HAL_WEBS, IPC_WRITE), session, io);
 }
 
+void web_server_write_chunk(HANDLE web_server, HANDLE session, WEB_RESPONSE code, IO* io)
+{
+    *((WEB_RESPONSE*)io_push(io, sizeof(WEB_RESPONSE))) = code;
+    io_write(web_server, HAL_IO_REQ(HAL_WEBS, WEBS_WRITE_CHUNK), session, io);
+}
+
+int web_server_write_chunk_sync(HANDLE web_server, HANDLE session, WEB_RESPONSE code, IO* io)
+{
+    *((WEB_RESPONSE*)io_push(io, sizeof(WEB_RESPONSE))) = code;
+    return io_write_sync(web_server, HAL_IO_REQ(HAL_WEBS, WEBS_WRITE_CHUNK), session, io);
+}
+
 char *web_server_get_param(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max, char *param)
 {
     unsigned int len = strlen(param);
@@ -26,7 +26,12 @@ typedef enum {
     WEBS_UNREGISTER_RESPONSE,
     WEBS_GET_PARAM,
     WEBS_SET_PARAM,
-    WEBS_GET_URL
+    WEBS_GET_URL,
+    WEBS_REGISTER_HANDLER,
+    WEBS_UNREGISTER_HANDLER,
+    WEBS_GET_NODE_STAT,
+    WEBS_WRITE_CHUNK,
+    WEBS_SET_FOLDER
 } WEBS_IPCS;
 
 typedef enum {
@@ -41,6 +46,8 @@ typedef enum {
 } WEB_METHOD;
 
 #define WEB_FLAG(method)           (1 << (method))
+//node is serving static files from vfs folder. Rest of URL is file path
+#define WEB_FLAG_FILES             (1 << 16)
 
 #define WEB_GENERIC_ERROR           0
 #define WEB_ROOT_NODE                INVALID_HANDLE
@@ -112,6 +119,14 @@ typedef struct {
     HANDLE obj;
 } HS_STACK;
 
+typedef struct {
+    unsigned int requests;
+    //time from request received till dispatched to handler, us
+    unsigned int queue_us_total, queue_us_max;
+    //time from dispatch till response, us
+    unsigned int service_us_total, service_us_max;
+} WEB_NODE_STAT;
+
 HANDLE web_server_create(unsigned int process_size, unsigned int priority);
 bool web_server_open(HANDLE web_server, uint16_t port, HANDLE tcpip);
 void web_server_close(HANDLE web_server);
@@ -120,11 +135,21 @@ void web_server_destroy_node(HANDLE web_server, HANDLE obj);
 //html must be located in flash
 void web_server_register_error(HANDLE web_server, WEB_RESPONSE code, const char *html);
 void web_server_unregister_error(HANDLE web_server, WEB_RESPONSE code);
+//requests to node are round-robined between registered handlers. Without handlers, requests are sent to server owner
+bool web_server_register_handler(HANDLE web_server, HANDLE obj, HANDLE process);
+void web_server_unregister_handler(HANDLE web_server, HANDLE obj, HANDLE process);
+bool web_server_get_node_stat(HANDLE web_server, HANDLE obj, WEB_NODE_STAT* stat);
+//GET/HEAD of node sub-path is served from vfs folder (f.e. from vfs_cd_path()) by server itself. Only one vfs per server
+HANDLE web_server_create_file_node(HANDLE web_server, HANDLE parent, const char* name, HANDLE vfs, unsigned int folder);
 
 void web_server_read(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max);
 int web_server_read_sync(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max);
 void web_server_write(HANDLE web_server, HANDLE session, WEB_RESPONSE code,  IO* io);
 int web_server_write_sync(HANDLE web_server, HANDLE session, WEB_RESPONSE code,  IO* io);
+//streaming response with chunked transfer encoding. Code is used only in first chunk, empty IO ends response.
+//Next chunk can be written only after previous is complete
+void web_server_write_chunk(HANDLE web_server, HANDLE session, WEB_RESPONSE code, IO* io);
+int web_server_write_chunk_sync(HANDLE web_server, HANDLE session, WEB_RESPONSE code, IO* io);
 char* web_server_get_param(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max, char* param);
 void web_server_set_param(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max, const char* param, const char* value);
 char* web_server_get_url(HANDLE web_server, HANDLE session, IO* io, unsigned int size_max);